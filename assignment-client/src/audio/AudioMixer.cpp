@@ -32,6 +32,8 @@
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/vector_angle.hpp>
 
+#include <QtCore/QStringList>
+
 #include <Logging.h>
 #include <NodeList.h>
 #include <Node.h>
@@ -48,9 +50,6 @@
 
 #include "AudioMixer.h"
 
-const short JITTER_BUFFER_MSECS = 12;
-const short JITTER_BUFFER_SAMPLES = JITTER_BUFFER_MSECS * (SAMPLE_RATE / 1000.0);
-
 const unsigned int BUFFER_SEND_INTERVAL_USECS = floorf((BUFFER_LENGTH_SAMPLES_PER_CHANNEL / SAMPLE_RATE) * 1000000);
 
 const int MAX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
@@ -58,18 +57,52 @@ const int MIN_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
 
 const char AUDIO_MIXER_LOGGING_TARGET_NAME[] = "audio-mixer";
 
+const uint64_t STREAM_STATS_INTERVAL_USECS = 10 * 1000 * 1000;
+
+// listeners only share a submix with a cluster leader that faces within this many degrees of them
+const float LISTENER_CLUSTER_MAX_ORIENTATION_DEGREES = 30.0f;
+const float DEFAULT_LISTENER_CLUSTER_DISTANCE_RATIO = 8.0f;
+
 void attachNewBufferToNode(Node *newNode) {
     if (!newNode->getLinkedData()) {
         newNode->setLinkedData(new AudioMixerClientData());
     }
 }
 
-AudioMixer::AudioMixer(const unsigned char* dataBuffer, int numBytes) : Assignment(dataBuffer, numBytes) {
+AudioMixer::AudioMixer(const unsigned char* dataBuffer, int numBytes) :
+    Assignment(dataBuffer, numBytes),
+    _listenerClusterRadius(0.0f),
+    _listenerClusterDistanceRatio(DEFAULT_LISTENER_CLUSTER_DISTANCE_RATIO)
+{
     
 }
 
+void AudioMixer::parsePayload() {
+    QString config((const char*) _payload);
+    QStringList configList = config.split(" ");
+    
+    // a listener cluster radius (in meters) turns on shared submixes for listeners standing that close together
+    const QString LISTENER_CLUSTER_RADIUS_OPTION = "--listenerClusterRadius";
+    int optionIndex = configList.indexOf(LISTENER_CLUSTER_RADIUS_OPTION);
+    if (optionIndex != -1 && optionIndex + 1 < configList.size()) {
+        _listenerClusterRadius = configList[optionIndex + 1].toFloat();
+    }
+    
+    // sources must be this many cluster radii away from the cluster leader to go into the shared submix, which bounds
+    // the distance error for any listener in the cluster to one part in (ratio - 1)
+    const QString LISTENER_CLUSTER_DISTANCE_RATIO_OPTION = "--listenerClusterDistanceRatio";
+    optionIndex = configList.indexOf(LISTENER_CLUSTER_DISTANCE_RATIO_OPTION);
+    if (optionIndex != -1 && optionIndex + 1 < configList.size()) {
+        _listenerClusterDistanceRatio = std::max(configList[optionIndex + 1].toFloat(), 2.0f);
+    }
+    
+    qDebug("listenerClusterRadius=%f listenerClusterDistanceRatio=%f\n",
+           _listenerClusterRadius, _listenerClusterDistanceRatio);
+}
+
 void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                          AvatarAudioRingBuffer* listeningNodeBuffer) {
+                                                          AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                          int16_t* mixSamples) {
     float bearingRelativeAngleToSource = 0.0f;
     float attenuationCoefficient = 1.0f;
     int numSamplesDelay = 0;
@@ -158,11 +191,11 @@ void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuf
     int16_t* sourceBuffer = bufferToAdd->getNextOutput();
     
     int16_t* goodChannel = (bearingRelativeAngleToSource > 0.0f)
-        ? _clientSamples
-        : _clientSamples + BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+        ? mixSamples
+        : mixSamples + BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
     int16_t* delayedChannel = (bearingRelativeAngleToSource > 0.0f)
-        ? _clientSamples + BUFFER_LENGTH_SAMPLES_PER_CHANNEL
-        : _clientSamples;
+        ? mixSamples + BUFFER_LENGTH_SAMPLES_PER_CHANNEL
+        : mixSamples;
     
     int16_t* delaySamplePointer = bufferToAdd->getNextOutput() == bufferToAdd->getBuffer()
         ? bufferToAdd->getBuffer() + RING_BUFFER_LENGTH_SAMPLES - numSamplesDelay
@@ -188,13 +221,32 @@ void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuf
     }
 }
 
-void AudioMixer::prepareMixForListeningNode(Node* node) {
+bool AudioMixer::prepareMixForListeningNode(Node* node) {
 	NodeList* nodeList = NodeList::getInstance();
+    bool hasMixedAudio = false;
+    
+    AudioMixerClientData* nodeClientData = (AudioMixerClientData*) node->getLinkedData();
+    AvatarAudioRingBuffer* nodeRingBuffer = nodeClientData->getAvatarAudioRingBuffer();
     
-    AvatarAudioRingBuffer* nodeRingBuffer = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer();
+    ListenerCluster* cluster = NULL;
     
-    // zero out the client mix for this node
-    memset(_clientSamples, 0, sizeof(_clientSamples));
+    if (nodeClientData->getListenerClusterIndex() != -1
+        && _listenerClusters[nodeClientData->getListenerClusterIndex()].numListeners > 1) {
+        cluster = &_listenerClusters[nodeClientData->getListenerClusterIndex()];
+    }
+    
+    if (cluster) {
+        // start from the shared submix of the distant sources, built by the first listener in the cluster that needs it
+        if (!cluster->hasBuiltSubmix) {
+            prepareSubmixForCluster(*cluster);
+        }
+        
+        memcpy(_clientSamples, cluster->submixSamples, sizeof(_clientSamples));
+        hasMixedAudio = cluster->hasSubmixAudio;
+    } else {
+        // zero out the client mix for this node
+        memset(_clientSamples, 0, sizeof(_clientSamples));
+    }
     
     // loop through all other nodes that have sufficient audio to mix
     for (NodeList::iterator otherNode = nodeList->begin(); otherNode != nodeList->end(); otherNode++) {
@@ -209,18 +261,156 @@ void AudioMixer::prepareMixForListeningNode(Node* node) {
                 if ((*otherNode != *node
                      || otherNodeBuffer->getType() != PositionalAudioRingBuffer::Microphone
                      || nodeRingBuffer->shouldLoopbackForNode())
-                    && otherNodeBuffer->willBeAddedToMix()) {
-                    addBufferToMixForListeningNodeWithBuffer(otherNodeBuffer, nodeRingBuffer);
+                    && otherNodeBuffer->willBeAddedToMix()
+                    && !otherNodeBuffer->isNextOutputSilent()
+                    && !(cluster && isBufferDistantFromCluster(otherNodeBuffer, *cluster))) {
+                    addBufferToMixForListeningNodeWithBuffer(otherNodeBuffer, nodeRingBuffer, _clientSamples);
+                    hasMixedAudio = true;
+                }
+            }
+        }
+    }
+    
+    return hasMixedAudio;
+}
+
+void AudioMixer::clusterListeningNodes() {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    const float MIN_ORIENTATION_DOT = cosf(glm::radians(LISTENER_CLUSTER_MAX_ORIENTATION_DEGREES) / 2.0f);
+    float clusterRadiusSquared = _listenerClusterRadius * _listenerClusterRadius;
+    
+    _listenerClusters.clear();
+    
+    // greedily put each listener in the first cluster whose leader is close enough and facing the same way,
+    // otherwise it leads a new cluster
+    for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
+        if (node->getType() == NODE_TYPE_AGENT && node->getActiveSocket() && node->getLinkedData()
+            && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
+            
+            AudioMixerClientData* clientData = (AudioMixerClientData*) node->getLinkedData();
+            AvatarAudioRingBuffer* listenerBuffer = clientData->getAvatarAudioRingBuffer();
+            
+            int clusterIndex = -1;
+            
+            for (int i = 0; i < _listenerClusters.size(); i++) {
+                AvatarAudioRingBuffer* leader = _listenerClusters[i].leader;
+                glm::vec3 offsetFromLeader = listenerBuffer->getPosition() - leader->getPosition();
+                
+                if (glm::dot(offsetFromLeader, offsetFromLeader) <= clusterRadiusSquared
+                    && fabsf(glm::dot(listenerBuffer->getOrientation(), leader->getOrientation())) >= MIN_ORIENTATION_DOT) {
+                    clusterIndex = i;
+                    break;
                 }
             }
+            
+            if (clusterIndex == -1) {
+                ListenerCluster newCluster;
+                newCluster.leader = listenerBuffer;
+                newCluster.numListeners = 0;
+                newCluster.hasBuiltSubmix = false;
+                newCluster.hasSubmixAudio = false;
+                
+                _listenerClusters.push_back(newCluster);
+                clusterIndex = _listenerClusters.size() - 1;
+            }
+            
+            _listenerClusters[clusterIndex].numListeners++;
+            clientData->setListenerClusterIndex(clusterIndex);
         }
     }
 }
 
+bool AudioMixer::isBufferDistantFromCluster(PositionalAudioRingBuffer* buffer, const ListenerCluster& cluster) const {
+    float minimumDistance = _listenerClusterRadius * _listenerClusterDistanceRatio;
+    glm::vec3 offsetFromLeader = buffer->getPosition() - cluster.leader->getPosition();
+    
+    return glm::dot(offsetFromLeader, offsetFromLeader) >= minimumDistance * minimumDistance;
+}
+
+void AudioMixer::prepareSubmixForCluster(ListenerCluster& cluster) {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    memset(cluster.submixSamples, 0, sizeof(cluster.submixSamples));
+    
+    for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
+        if (node->getLinkedData()) {
+            AudioMixerClientData* clientData = (AudioMixerClientData*) node->getLinkedData();
+            
+            for (int i = 0; i < clientData->getRingBuffers().size(); i++) {
+                PositionalAudioRingBuffer* buffer = clientData->getRingBuffers()[i];
+                
+                if (buffer->willBeAddedToMix() && !buffer->isNextOutputSilent()
+                    && isBufferDistantFromCluster(buffer, cluster)) {
+                    addBufferToMixForListeningNodeWithBuffer(buffer, cluster.leader, cluster.submixSamples);
+                    cluster.hasSubmixAudio = true;
+                }
+            }
+        }
+    }
+    
+    cluster.hasBuiltSubmix = true;
+}
+
+void AudioMixer::reportStreamStats() {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    int numStreams = 0;
+    int totalJitterBufferSamples = 0;
+    int totalStarves = 0;
+    
+    for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
+        if (node->getLinkedData()) {
+            AudioMixerClientData* clientData = (AudioMixerClientData*) node->getLinkedData();
+            
+            for (int i = 0; i < clientData->getRingBuffers().size(); i++) {
+                PositionalAudioRingBuffer* ringBuffer = clientData->getRingBuffers()[i];
+                
+                qDebug("%s %s stream - depth %d samples, target %d samples, jitter %.2f ms, "
+                       "%d starves, %d frames compressed, %d frames expanded\n",
+                       node->getUUID().toString().toLocal8Bit().constData(),
+                       ringBuffer->getType() == PositionalAudioRingBuffer::Microphone ? "microphone" : "injector",
+                       ringBuffer->diffLastWriteNextOutput(),
+                       ringBuffer->getJitterBufferSamples(),
+                       ringBuffer->getInterarrivalJitterUsecs() / 1000.0f,
+                       ringBuffer->getNumStarves(),
+                       ringBuffer->getNumFramesCompressed(),
+                       ringBuffer->getNumFramesExpanded());
+                
+                numStreams++;
+                totalJitterBufferSamples += ringBuffer->getJitterBufferSamples();
+                totalStarves += ringBuffer->getNumStarves();
+            }
+        }
+    }
+    
+    if (_listenerClusterRadius > 0.0f) {
+        int numListeners = 0;
+        for (int i = 0; i < _listenerClusters.size(); i++) {
+            numListeners += _listenerClusters[i].numListeners;
+        }
+        
+        qDebug("%d listeners mixed in %d clusters\n", numListeners, (int) _listenerClusters.size());
+    }
+    
+    if (Logging::shouldSendStats() && numStreams > 0) {
+        const char MIXER_LOGSTASH_JITTER_BUFFER_METRIC_NAME[] = "audio-mixer-average-jitter-buffer-msecs";
+        const char MIXER_LOGSTASH_STARVES_METRIC_NAME[] = "audio-mixer-stream-starves";
+        
+        Logging::stashValue(STAT_TYPE_GAUGE, MIXER_LOGSTASH_JITTER_BUFFER_METRIC_NAME,
+                            (totalJitterBufferSamples / (float) numStreams) / (SAMPLE_RATE / 1000.0f));
+        Logging::stashValue(STAT_TYPE_GAUGE, MIXER_LOGSTASH_STARVES_METRIC_NAME, totalStarves);
+    }
+}
+
 void AudioMixer::run() {
     // change the logging target name while this is running
     Logging::setTargetName(AUDIO_MIXER_LOGGING_TARGET_NAME);
     
+    if (getNumPayloadBytes() > 0) {
+        parsePayload();
+    }
+    
     NodeList *nodeList = NodeList::getInstance();
     nodeList->setOwnerType(NODE_TYPE_AUDIO_MIXER);
     
@@ -247,9 +437,17 @@ void AudioMixer::run() {
     unsigned char clientPacket[BUFFER_LENGTH_BYTES_STEREO + numBytesPacketHeader];
     populateTypeAndVersion(clientPacket, PACKET_TYPE_MIXED_AUDIO);
     
+    // when nothing audible was mixed for a listener we send them this marker instead of a full frame of zeros
+    int16_t numSilentSamples = BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2;
+    unsigned char silentFramePacket[MAX_PACKET_HEADER_BYTES + sizeof(numSilentSamples)];
+    int numBytesSilentFramePacket = populateTypeAndVersion(silentFramePacket, PACKET_TYPE_SILENT_AUDIO_FRAME);
+    memcpy(silentFramePacket + numBytesSilentFramePacket, &numSilentSamples, sizeof(numSilentSamples));
+    numBytesSilentFramePacket += sizeof(numSilentSamples);
+    
     gettimeofday(&startTime, NULL);
     
     timeval lastDomainServerCheckIn = {};
+    uint64_t lastStreamStatsReport = usecTimestampNow();
     
     timeval beginSendTime, endSendTime;
     float sumFrameTimePercentages = 0.0f;
@@ -286,22 +484,33 @@ void AudioMixer::run() {
             }
         }
         
+        if (usecTimestampNow() - lastStreamStatsReport >= STREAM_STATS_INTERVAL_USECS) {
+            lastStreamStatsReport = usecTimestampNow();
+            reportStreamStats();
+        }
+        
         // get the NodeList to ping any inactive nodes, for hole punching
         nodeList->possiblyPingInactiveNodes();
         
         for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
             if (node->getLinkedData()) {
-                ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend(JITTER_BUFFER_SAMPLES);
+                ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend();
             }
         }
         
+        if (_listenerClusterRadius > 0.0f) {
+            clusterListeningNodes();
+        }
+        
         for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
             if (node->getType() == NODE_TYPE_AGENT && node->getActiveSocket() && node->getLinkedData()
                 && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
-                prepareMixForListeningNode(&(*node));
-                
-                memcpy(clientPacket + numBytesPacketHeader, _clientSamples, sizeof(_clientSamples));
-                nodeList->getNodeSocket()->send(node->getActiveSocket(), clientPacket, sizeof(clientPacket));
+                if (prepareMixForListeningNode(&(*node))) {
+                    memcpy(clientPacket + numBytesPacketHeader, _clientSamples, sizeof(_clientSamples));
+                    nodeList->getNodeSocket()->send(node->getActiveSocket(), clientPacket, sizeof(clientPacket));
+                } else {
+                    nodeList->getNodeSocket()->send(node->getActiveSocket(), silentFramePacket, numBytesSilentFramePacket);
+                }
             }
         }
         
@@ -317,6 +526,7 @@ void AudioMixer::run() {
                packetVersionMatch(packetData)) {
             if (packetData[0] == PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO
                 || packetData[0] == PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO
+                || packetData[0] == PACKET_TYPE_SILENT_MICROPHONE_AUDIO
                 || packetData[0] == PACKET_TYPE_INJECT_AUDIO) {
                 
                 QUuid nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
@@ -9,6 +9,8 @@
 #ifndef __hifi__AudioMixer__
 #define __hifi__AudioMixer__
 
+#include <vector>
+
 #include <Assignment.h>
 #include <AudioRingBuffer.h>
 
@@ -23,15 +25,44 @@ public:
     /// runs the audio mixer
     void run();
 private:
-    /// adds one buffer to the mix for a listening node
+    /// a group of listeners close enough together, and facing close enough to the same way, to share a submix of the
+    /// sources that are far from all of them - spatialized for the cluster leader
+    struct ListenerCluster {
+        AvatarAudioRingBuffer* leader;
+        int numListeners;
+        bool hasBuiltSubmix;
+        bool hasSubmixAudio;
+        int16_t submixSamples[BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2];
+    };
+    
+    /// parses the mixer options from the assignment payload
+    void parsePayload();
+    
+    /// adds one buffer to a mix for a listening node
     void addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                  AvatarAudioRingBuffer* listeningNodeBuffer);
+                                                  AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                  int16_t* mixSamples);
+    
+    /// prepares a mix for one Node, returns false if there was nothing audible to add and the mix is all zeros
+    bool prepareMixForListeningNode(Node* node);
     
-    /// prepares and sends a mix to one Node
-    void prepareMixForListeningNode(Node* node);
+    /// groups the listening nodes into clusters for this frame
+    void clusterListeningNodes();
     
+    /// mixes the sources that are distant from a cluster into its shared submix
+    void prepareSubmixForCluster(ListenerCluster& cluster);
+    
+    /// true if the source is far enough from the cluster to be heard through its shared submix
+    bool isBufferDistantFromCluster(PositionalAudioRingBuffer* buffer, const ListenerCluster& cluster) const;
+    
+    /// logs the jitter buffer depth and starve counts of each stream, and stashes their totals if sending stats
+    void reportStreamStats();
     
     int16_t _clientSamples[BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2];
+    
+    float _listenerClusterRadius;
+    float _listenerClusterDistanceRatio;
+    std::vector<ListenerCluster> _listenerClusters;
 };
 
 #endif /* defined(__hifi__AudioMixer__) */
@@ -13,6 +13,13 @@
 
 #include "AudioMixerClientData.h"
 
+AudioMixerClientData::AudioMixerClientData() :
+    _ringBuffers(),
+    _listenerClusterIndex(-1)
+{
+    
+}
+
 AudioMixerClientData::~AudioMixerClientData() {
     for (int i = 0; i < _ringBuffers.size(); i++) {
         // delete this attached PositionalAudioRingBuffer
@@ -33,7 +40,8 @@ AvatarAudioRingBuffer* AudioMixerClientData::getAvatarAudioRingBuffer() const {
 
 int AudioMixerClientData::parseData(unsigned char* packetData, int numBytes) {
     if (packetData[0] == PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO
-        || packetData[0] == PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO) {
+        || packetData[0] == PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO
+        || packetData[0] == PACKET_TYPE_SILENT_MICROPHONE_AUDIO) {
         
         // grab the AvatarAudioRingBuffer from the vector (or create it if it doesn't exist)
         AvatarAudioRingBuffer* avatarRingBuffer = getAvatarAudioRingBuffer();
@@ -75,9 +83,9 @@ int AudioMixerClientData::parseData(unsigned char* packetData, int numBytes) {
     return 0;
 }
 
-void AudioMixerClientData::checkBuffersBeforeFrameSend(int jitterBufferLengthSamples) {
+void AudioMixerClientData::checkBuffersBeforeFrameSend() {
     for (int i = 0; i < _ringBuffers.size(); i++) {
-        if (_ringBuffers[i]->shouldBeAddedToMix(jitterBufferLengthSamples)) {
+        if (_ringBuffers[i]->shouldBeAddedToMix()) {
             // this is a ring buffer that is ready to go
             // set its flag so we know to push its buffer when all is said and done
             _ringBuffers[i]->setWillBeAddedToMix(true);
@@ -98,7 +106,9 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
             }
             
             audioBuffer->setWillBeAddedToMix(false);
-        } else if (audioBuffer->hasStarted() && audioBuffer->isStarved()) {
+        } else if (audioBuffer->getType() == PositionalAudioRingBuffer::Injector
+                   && audioBuffer->hasStarted() && audioBuffer->isStarved()) {
+            // a starved injected stream has finished - microphone streams are kept so their jitter history survives
             delete audioBuffer;
             _ringBuffers.erase(_ringBuffers.begin() + i);
         }
@@ -18,16 +18,21 @@
 
 class AudioMixerClientData : public NodeData {
 public:
+    AudioMixerClientData();
     ~AudioMixerClientData();
     
     const std::vector<PositionalAudioRingBuffer*> getRingBuffers() const { return _ringBuffers; }
     AvatarAudioRingBuffer* getAvatarAudioRingBuffer() const;
     
     int parseData(unsigned char* packetData, int numBytes);
-    void checkBuffersBeforeFrameSend(int jitterBufferLengthSamples);
+    void checkBuffersBeforeFrameSend();
     void pushBuffersAfterFrameSend();
+    
+    int getListenerClusterIndex() const { return _listenerClusterIndex; }
+    void setListenerClusterIndex(int listenerClusterIndex) { _listenerClusterIndex = listenerClusterIndex; }
 private:
     std::vector<PositionalAudioRingBuffer*> _ringBuffers;
+    int _listenerClusterIndex;
 };
 
 #endif /* defined(__hifi__AudioMixerClientData__) */
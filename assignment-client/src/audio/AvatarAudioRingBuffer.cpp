@@ -17,6 +17,9 @@ AvatarAudioRingBuffer::AvatarAudioRingBuffer() :
 }
 
 int AvatarAudioRingBuffer::parseData(unsigned char* sourceBuffer, int numBytes) {
-    _shouldLoopbackForNode = (sourceBuffer[0] == PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO);
+    if (sourceBuffer[0] != PACKET_TYPE_SILENT_MICROPHONE_AUDIO) {
+        // silent frames don't carry the echo flag, keep whatever the last audible frame asked for
+        _shouldLoopbackForNode = (sourceBuffer[0] == PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO);
+    }
     return PositionalAudioRingBuffer::parseData(sourceBuffer, numBytes);
 }
\ No newline at end of file
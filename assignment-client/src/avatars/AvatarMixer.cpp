@@ -8,92 +8,502 @@
 //  Original avatar-mixer main created by Leonardo Murillo on 03/25/13.
 //
 //  The avatar mixer receives head, hand and positional data from all connected
-//  nodes, and broadcasts that data back to them, every BROADCAST_INTERVAL ms.
+//  nodes, and broadcasts that data back to them, every AVATAR_BROADCAST_INTERVAL_USECS.
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include <QtCore/QStringList>
 
 #include <Logging.h>
 #include <NodeList.h>
+#include <NodeSpatialIndex.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <UUID.h>
 
-#include "AvatarData.h"
+#include "AvatarMixerClientData.h"
 
 #include "AvatarMixer.h"
 
 const char AVATAR_MIXER_LOGGING_NAME[] = "avatar-mixer";
 
-unsigned char* addNodeToBroadcastPacket(unsigned char *currentPosition, Node *nodeToAdd) {
-    QByteArray rfcUUID = nodeToAdd->getUUID().toRfc4122();
-    memcpy(currentPosition, rfcUUID.constData(), rfcUUID.size());
-    currentPosition += rfcUUID.size();
-    
-    AvatarData *nodeData = (AvatarData *)nodeToAdd->getLinkedData();
-    currentPosition += nodeData->getBroadcastData(currentPosition);
+const int AVATAR_BROADCAST_INTERVAL_USECS = 1000000 / 30;
+
+// the most avatar data each client is sent per broadcast tick
+const int AVATAR_BROADCAST_BYTES_PER_TICK = 4 * MAX_PACKET_SIZE;
+
+// avatars closer than this are sent every tick, each doubling of the distance past it halves the rate
+const float FULL_RATE_AVATAR_DISTANCE = 5.0f;
+const uint64_t MAX_AVATAR_BROADCAST_INTERVAL_TICKS = 16;
+
+// avatars outside of this angle from where the receiver is facing are sent at half the rate
+const float AVATAR_IN_VIEW_MIN_DOT = 0.5f;
+
+// per-client broadcast history for avatars not sent in this many ticks is dropped
+const uint64_t AVATAR_BROADCAST_HISTORY_TICKS = 30 * 30;
+
+// every avatar is sent in full this often, in case the receiver has dropped it and added it again since
+const uint64_t AVATAR_KEY_FRAME_INTERVAL_TICKS = 30 * 5;
+
+// a receiver that hasn't been sent an avatar for this long has killed it, so it needs to be sent in full
+const uint64_t AVATAR_SILENCE_TICKS = NODE_SILENCE_THRESHOLD_USECS / AVATAR_BROADCAST_INTERVAL_USECS;
+
+// receivers are only sent, and only relayed the URLs and face video of, avatars within this distance
+const float AVATAR_INTEREST_RADIUS = 160.0f;
+const float AVATAR_INDEX_CELL_SIZE = 20.0f;
+
+// face video is sent at the full frame rate to receivers this close to the sender, or facing them and closer than the
+// full rate distance, and only as key frames to receivers further away that are facing them
+const float FACE_VIDEO_NEAR_DISTANCE = 5.0f;
+const float FACE_VIDEO_FULL_RATE_DISTANCE = 15.0f;
+
+// where every avatar is, as of the last data it sent us
+NodeSpatialIndex avatarSpatialIndex(AVATAR_INDEX_CELL_SIZE);
+
+// how often the time spent building and sending the broadcast packets is reported
+const uint64_t BROADCAST_STATS_INTERVAL_USECS = 10 * 1000 * 1000;
+
+/// an avatar that is due to be sent to a receiver this tick
+struct AvatarBroadcastCandidate {
+    Node* node;
+    float overdueRatio;
+    float distance;
+};
+
+/// the scratch space for building a receiver's packets, each thread that builds them has its own
+struct AvatarBroadcastBuffers {
+    unsigned char packet[MAX_PACKET_SIZE];
+    std::vector<AvatarBroadcastCandidate> candidates;
+    std::vector<Node*> nearbyNodes;
+};
+
+// most overdue first, nearest first between those equally overdue
+bool isMoreDueForBroadcast(const AvatarBroadcastCandidate& first, const AvatarBroadcastCandidate& second) {
+    if (first.overdueRatio != second.overdueRatio) {
+        return first.overdueRatio > second.overdueRatio;
+    }
     
-    return currentPosition;
+    return first.distance < second.distance;
 }
 
 void attachAvatarDataToNode(Node* newNode) {
     if (newNode->getLinkedData() == NULL) {
-        newNode->setLinkedData(new AvatarData(newNode));
+        newNode->setLinkedData(new AvatarMixerClientData(newNode, &avatarSpatialIndex));
+    }
+}
+
+uint64_t broadcastIntervalForAvatar(float distance, bool isInView) {
+    uint64_t intervalTicks = 1;
+    
+    for (float fullRateDistance = FULL_RATE_AVATAR_DISTANCE;
+         distance > fullRateDistance && intervalTicks < MAX_AVATAR_BROADCAST_INTERVAL_TICKS;
+         fullRateDistance *= 2) {
+        intervalTicks *= 2;
+    }
+    
+    if (!isInView) {
+        intervalTicks = std::min(intervalTicks * 2, MAX_AVATAR_BROADCAST_INTERVAL_TICKS);
     }
+    
+    return intervalTicks;
 }
 
-// NOTE: some additional optimizations to consider.
-//    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
-//       if the avatar is not in view or in the keyhole.
-//    2) after culling for view frustum, sort order the avatars by distance, send the closest ones first.
-//    3) if we need to rate limit the amount of data we send, we can use a distance weighted "semi-random" function to
-//       determine which avatars are included in the packet stream
-//    4) we should optimize the avatar data format to be more compact (100 bytes is pretty wasteful).
-void broadcastAvatarData(NodeList* nodeList, const QUuid& receiverUUID, sockaddr* receiverAddress) {
-    static unsigned char broadcastPacketBuffer[MAX_PACKET_SIZE];
-    static unsigned char avatarDataBuffer[MAX_PACKET_SIZE];
-    unsigned char* broadcastPacket = (unsigned char*)&broadcastPacketBuffer[0];
+// sends the receiver the avatars due to them on this tick, only reading the other avatars so that receivers can be
+// handled on several threads at once
+void broadcastAvatarDataToNode(NodeList* nodeList, Node* receiver, uint64_t tick, AvatarBroadcastBuffers& buffers) {
+    std::vector<AvatarBroadcastCandidate>& candidates = buffers.candidates;
+    std::vector<Node*>& nearbyNodes = buffers.nearbyNodes;
+    
+    AvatarMixerClientData* receiverData = (AvatarMixerClientData*) receiver->getLinkedData();
+    glm::vec3 receiverPosition = receiverData->getPosition();
+    glm::vec3 receiverViewDirection = receiverData->getViewDirection();
+    
+    nearbyNodes.clear();
+    avatarSpatialIndex.findNodesInRadius(receiverPosition, AVATAR_INTEREST_RADIUS, nearbyNodes);
+    
+    // pick the avatars that are due for this receiver given their distance and whether they are in front of them
+    candidates.clear();
+    
+    for (std::vector<Node*>::iterator node = nearbyNodes.begin(); node != nearbyNodes.end(); node++) {
+        if ((*node)->getLinkedData() && (*node)->getUUID() != receiver->getUUID()) {
+            glm::vec3 offset = ((AvatarData*) (*node)->getLinkedData())->getPosition() - receiverPosition;
+            float distance = glm::length(offset);
+            bool isInView = distance < FULL_RATE_AVATAR_DISTANCE
+                || glm::dot(offset, receiverViewDirection) > AVATAR_IN_VIEW_MIN_DOT * distance;
+            
+            uint64_t intervalTicks = broadcastIntervalForAvatar(distance, isInView);
+            uint64_t ticksSinceBroadcast = receiverData->getTicksSinceBroadcast((*node)->getUUID(), tick);
+            
+            if (ticksSinceBroadcast >= intervalTicks) {
+                AvatarBroadcastCandidate candidate = { *node, 0.0f, distance };
+                candidate.overdueRatio = ticksSinceBroadcast == NEVER_BROADCAST_TICKS
+                    ? FLT_MAX
+                    : (float) ticksSinceBroadcast / intervalTicks;
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    
+    // avatars that don't fit in this tick's budget are more overdue on the next one, so everyone gets a turn
+    std::sort(candidates.begin(), candidates.end(), isMoreDueForBroadcast);
+    
+    unsigned char* broadcastPacket = buffers.packet;
     int numHeaderBytes = populateTypeAndVersion(broadcastPacket, PACKET_TYPE_BULK_AVATAR_DATA);
-    unsigned char* currentBufferPosition = broadcastPacket + numHeaderBytes;
-    int packetLength = currentBufferPosition - broadcastPacket;
-    int packetsSent = 0;
     
-    // send back a packet with other active node data to this node
+    // each packet carries a sequence number the receiver acknowledges, so we know which field versions they have
+    int numLeadingBytes = numHeaderBytes + sizeof(uint16_t);
+    uint16_t sequence = receiverData->beginBroadcastPacket();
+    memcpy(broadcastPacket + numHeaderBytes, &sequence, sizeof(sequence));
+    
+    unsigned char* currentBufferPosition = broadcastPacket + numLeadingBytes;
+    int packetLength = numLeadingBytes;
+    int bytesSent = 0;
+    
+    for (std::vector<AvatarBroadcastCandidate>::iterator candidate = candidates.begin();
+         candidate != candidates.end();
+         candidate++) {
+        AvatarMixerClientData* avatarData = (AvatarMixerClientData*) candidate->node->getLinkedData();
+        const QUuid& avatarUUID = candidate->node->getUUID();
+        
+        bool isKeyFrame = receiverData->getTicksSinceKeyFrame(avatarUUID, tick) >= AVATAR_KEY_FRAME_INTERVAL_TICKS
+            || receiverData->getTicksSinceBroadcast(avatarUUID, tick) >= AVATAR_SILENCE_TICKS;
+        AvatarFieldMask fieldMask = isKeyFrame
+            ? ALL_AVATAR_FIELDS
+            : avatarData->getChangedFields(receiverData->getAcknowledgedFieldVersions(avatarUUID));
+        
+        // an avatar with nothing new still gets an empty record, which keeps it alive on the receiver
+        int avatarDataLength = avatarData->getCompactRecordLength(fieldMask);
+        
+        if (bytesSent + packetLength + avatarDataLength > AVATAR_BROADCAST_BYTES_PER_TICK) {
+            break;
+        }
+        
+        if (avatarDataLength + packetLength > MAX_PACKET_SIZE) {
+            if (avatarDataLength + numLeadingBytes > MAX_PACKET_SIZE) {
+                // this one can never fit in a packet, skip it
+                continue;
+            }
+            
+            nodeList->getNodeSocket()->send(receiver->getActiveSocket(), broadcastPacket, packetLength);
+            bytesSent += packetLength;
+            
+            // reset the packet
+            sequence = receiverData->beginBroadcastPacket();
+            memcpy(broadcastPacket + numHeaderBytes, &sequence, sizeof(sequence));
+            currentBufferPosition = broadcastPacket + numLeadingBytes;
+            packetLength = numLeadingBytes;
+        }
+        
+        currentBufferPosition += avatarData->writeCompactRecord(currentBufferPosition, avatarUUID, fieldMask);
+        packetLength += avatarDataLength;
+        
+        receiverData->addBroadcastRecord(avatarUUID, avatarData, fieldMask, tick, isKeyFrame);
+    }
+    
+    if (packetLength > numLeadingBytes) {
+        nodeList->getNodeSocket()->send(receiver->getActiveSocket(), broadcastPacket, packetLength);
+    }
+    
+    if (tick > AVATAR_BROADCAST_HISTORY_TICKS) {
+        receiverData->removeBroadcastStatesBefore(tick - AVATAR_BROADCAST_HISTORY_TICKS);
+    }
+}
+
+FaceVideoForwardMode faceVideoForwardModeForReceiver(AvatarMixerClientData* receiverData,
+                                                     const glm::vec3& senderPosition) {
+    glm::vec3 offset = senderPosition - receiverData->getPosition();
+    float distance = glm::length(offset);
+    
+    if (distance < FACE_VIDEO_NEAR_DISTANCE) {
+        return FACE_VIDEO_ALL_FRAMES;
+    }
+    
+    if (glm::dot(offset, receiverData->getViewDirection()) <= AVATAR_IN_VIEW_MIN_DOT * distance) {
+        return FACE_VIDEO_NO_FRAMES;
+    }
+    
+    return distance < FACE_VIDEO_FULL_RATE_DISTANCE ? FACE_VIDEO_ALL_FRAMES : FACE_VIDEO_KEY_FRAMES;
+}
+
+// after the sender's UUID, a face video fragment has its frame's count, size and offset, then the frame flags
+const int FACE_VIDEO_FRAGMENT_HEADER_BYTES = 3 * sizeof(uint32_t) + sizeof(unsigned char);
+
+// relays a fragment of the sender's face video to the receivers near enough to or facing the sender, the decision for
+// each receiver is made on the first fragment of a frame and holds for the rest of it
+void forwardFaceVideo(NodeList* nodeList, Node* sender, unsigned char* packetData, int numBytes) {
+    static std::vector<Node*> nearbyNodes;
+    
+    unsigned char* fragmentPosition = packetData + numBytesForPacketHeader(packetData) + NUM_BYTES_RFC4122_UUID;
+    
+    uint32_t frameCount = *(uint32_t*) fragmentPosition;
+    fragmentPosition += sizeof(uint32_t);
+    
+    uint32_t frameSize = *(uint32_t*) fragmentPosition;
+    fragmentPosition += sizeof(uint32_t);
+    
+    uint32_t frameOffset = *(uint32_t*) fragmentPosition;
+    fragmentPosition += sizeof(uint32_t);
+    
+    bool isKeyFrame = *fragmentPosition & FACE_VIDEO_KEY_FRAME_FLAG;
+    
+    glm::vec3 senderPosition = ((AvatarData*) sender->getLinkedData())->getPosition();
+    
+    nearbyNodes.clear();
+    avatarSpatialIndex.findNodesInRadius(senderPosition, AVATAR_INTEREST_RADIUS, nearbyNodes);
+    
+    for (std::vector<Node*>::iterator node = nearbyNodes.begin(); node != nearbyNodes.end(); node++) {
+        if (!(*node)->getActiveSocket() || !(*node)->getLinkedData() || *node == sender) {
+            continue;
+        }
+        
+        AvatarMixerClientData* receiverData = (AvatarMixerClientData*) (*node)->getLinkedData();
+        
+        if (frameSize == 0) {
+            // the sender has stopped sending video, everyone who could see it needs to know
+            receiverData->removeFaceVideoForwardState(sender->getUUID());
+            nodeList->getNodeSocket()->send((*node)->getActiveSocket(), packetData, numBytes);
+            continue;
+        }
+        
+        FaceVideoForwardState& state = receiverData->getFaceVideoForwardState(sender->getUUID());
+        
+        if (frameOffset == 0) {
+            FaceVideoForwardMode wantedMode = faceVideoForwardModeForReceiver(receiverData, senderPosition);
+            
+            // the mode can drop at any frame, but can only go up on a key frame the receiver can start decoding from
+            if (isKeyFrame || wantedMode < state.mode) {
+                state.mode = wantedMode;
+            }
+            
+            state.frameCount = frameCount;
+            state.isForwardingFrame = state.mode == FACE_VIDEO_ALL_FRAMES
+                || (state.mode == FACE_VIDEO_KEY_FRAMES && isKeyFrame);
+            
+            if (state.isForwardingFrame && !receiverData->consumeFaceVideoBytes(frameSize)) {
+                // the frames after one we drop can't be decoded, so wait for the next key frame
+                state.isForwardingFrame = false;
+                state.mode = std::min(state.mode, FACE_VIDEO_KEY_FRAMES);
+            }
+        }
+        
+        if (state.isForwardingFrame && state.frameCount == frameCount) {
+            nodeList->getNodeSocket()->send((*node)->getActiveSocket(), packetData, numBytes);
+        }
+    }
+}
+
+// times building the broadcast data for every receiver from a crowd of numAvatars, re-packing each avatar in the full
+// format for every receiver as the mixer used to versus packing each once and copying compact records from the cache
+void benchmarkBroadcastBuild(int numAvatars) {
+    const float BENCHMARK_CROWD_SCALE = 100.0f;
+    
+    std::vector<AvatarMixerClientData*> avatars;
+    std::vector<QUuid> avatarUUIDs;
+    
+    for (int i = 0; i < numAvatars; i++) {
+        AvatarMixerClientData* avatar = new AvatarMixerClientData(NULL);
+        avatar->setPosition(glm::vec3(randFloat(), 0.0f, randFloat()) * BENCHMARK_CROWD_SCALE);
+        avatar->setBodyYaw(randFloatInRange(-180.0f, 180.0f));
+        avatar->setChatMessage(std::string("hello"));
+        
+        avatars.push_back(avatar);
+        avatarUUIDs.push_back(QUuid::createUuid());
+    }
+    
+    unsigned char packetBuffer[2 * MAX_PACKET_SIZE];
+    int numFullBytes = 0;
+    
+    uint64_t startTime = usecTimestampNow();
+    
+    for (int receiver = 0; receiver < numAvatars; receiver++) {
+        for (int i = 0; i < numAvatars; i++) {
+            if (i != receiver) {
+                QByteArray rfcUUID = avatarUUIDs[i].toRfc4122();
+                memcpy(packetBuffer, rfcUUID.constData(), rfcUUID.size());
+                numFullBytes = rfcUUID.size() + avatars[i]->getBroadcastData(packetBuffer + rfcUUID.size());
+            }
+        }
+    }
+    
+    uint64_t repackUsecs = usecTimestampNow() - startTime;
+    startTime = usecTimestampNow();
+    
+    // every cache starts out stale, so this includes packing each avatar once as if they had all just sent an update
+    int numCompactBytes = 0;
+    
+    for (int receiver = 0; receiver < numAvatars; receiver++) {
+        for (int i = 0; i < numAvatars; i++) {
+            if (i != receiver) {
+                avatars[i]->updateCompactFieldCache();
+                numCompactBytes = avatars[i]->writeCompactRecord(packetBuffer, avatarUUIDs[i], ALL_AVATAR_FIELDS);
+            }
+        }
+    }
+    
+    uint64_t cachedUsecs = usecTimestampNow() - startTime;
+    
+    // the usual update while walking around: moving, turning the body and head
+    AvatarFieldMask movingFields = (1 << AVATAR_FIELD_POSITION) | (1 << AVATAR_FIELD_BODY) | (1 << AVATAR_FIELD_HEAD);
+    
+    qDebug("Broadcast build for %d avatars: %llu usecs re-packing per receiver, %llu usecs from cache\n",
+           numAvatars, (long long unsigned int)repackUsecs, (long long unsigned int)cachedUsecs);
+    qDebug("Bytes per avatar: %d full format, %d compact, %d compact when moving, %d compact when unchanged\n",
+           numFullBytes, numCompactBytes, avatars[0]->getCompactRecordLength(movingFields),
+           avatars[0]->getCompactRecordLength(0));
+    
+    for (int i = 0; i < numAvatars; i++) {
+        delete avatars[i];
+    }
+}
+
+AvatarMixer::AvatarMixer(const unsigned char* dataBuffer, int numBytes) :
+    Assignment(dataBuffer, numBytes),
+    _broadcastWorkers(),
+    _broadcastReceivers(),
+    _broadcastTick(0),
+    _nextBroadcastReceiver(0),
+    _broadcastGeneration(0),
+    _broadcastWorkersStartGeneration(0),
+    _numBusyBroadcastWorkers(0),
+    _isStoppingBroadcastWorkers(false)
+{
+    // by default every core builds packets, the mixer thread is one of them
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    _numBroadcastWorkers = numCores > 1 ? numCores - 1 : 0;
+    
+    pthread_mutex_init(&_broadcastMutex, NULL);
+    pthread_cond_init(&_broadcastStarted, NULL);
+    pthread_cond_init(&_broadcastFinished, NULL);
+}
+
+void AvatarMixer::parsePayload() {
+    QString config((const char*) _payload);
+    QStringList configList = config.split(" ");
+    
+    // time how long building the broadcast packets takes for a crowd of the given size before starting up
+    const QString BROADCAST_BENCHMARK_OPTION = "--broadcastBenchmark";
+    int optionIndex = configList.indexOf(BROADCAST_BENCHMARK_OPTION);
+    if (optionIndex != -1 && optionIndex + 1 < configList.size()) {
+        benchmarkBroadcastBuild(configList[optionIndex + 1].toInt());
+    }
+    
+    // override the number of extra threads building receiver packets, for comparing tick times against core count
+    const QString BROADCAST_THREADS_OPTION = "--broadcastThreads";
+    optionIndex = configList.indexOf(BROADCAST_THREADS_OPTION);
+    if (optionIndex != -1 && optionIndex + 1 < configList.size()) {
+        _numBroadcastWorkers = std::max(configList[optionIndex + 1].toInt(), 0);
+    }
+}
+
+void AvatarMixer::startBroadcastWorkers() {
+    _isStoppingBroadcastWorkers = false;
+    _broadcastWorkers.resize(_numBroadcastWorkers);
+    
+    // the workers wait for the tick after this one, read here since the first tick can start before they're running
+    _broadcastWorkersStartGeneration = _broadcastGeneration;
+    
+    for (int i = 0; i < _numBroadcastWorkers; i++) {
+        pthread_create(&_broadcastWorkers[i], NULL, runBroadcastWorker, this);
+    }
+}
+
+void AvatarMixer::stopBroadcastWorkers() {
+    pthread_mutex_lock(&_broadcastMutex);
+    _isStoppingBroadcastWorkers = true;
+    pthread_cond_broadcast(&_broadcastStarted);
+    pthread_mutex_unlock(&_broadcastMutex);
+    
+    for (int i = 0; i < (int)_broadcastWorkers.size(); i++) {
+        pthread_join(_broadcastWorkers[i], NULL);
+    }
+    
+    _broadcastWorkers.clear();
+}
+
+void AvatarMixer::broadcastAvatarData(NodeList* nodeList, uint64_t tick, AvatarBroadcastBuffers& buffers) {
+    _broadcastReceivers.clear();
+    
+    // pack each avatar that has sent an update once, here, so that building the receivers' packets only reads avatars
     for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
-        if (node->getLinkedData() && node->getUUID() != receiverUUID) {
-            unsigned char* avatarDataEndpoint = addNodeToBroadcastPacket((unsigned char*)&avatarDataBuffer[0], &*node);
-            int avatarDataLength = avatarDataEndpoint - (unsigned char*)&avatarDataBuffer;
+        if (node->getLinkedData()) {
+            ((AvatarMixerClientData*) node->getLinkedData())->updateCompactFieldCache();
             
-            if (avatarDataLength + packetLength <= MAX_PACKET_SIZE) {
-                memcpy(currentBufferPosition, &avatarDataBuffer[0], avatarDataLength);
-                packetLength += avatarDataLength;
-                currentBufferPosition += avatarDataLength;
-            } else {
-                packetsSent++;
-                //printf("packetsSent=%d packetLength=%d\n", packetsSent, packetLength);
-                nodeList->getNodeSocket()->send(receiverAddress, broadcastPacket, currentBufferPosition - broadcastPacket);
-                
-                // reset the packet
-                currentBufferPosition = broadcastPacket + numHeaderBytes;
-                packetLength = currentBufferPosition - broadcastPacket;
-                
-                // copy the avatar that didn't fit into the next packet
-                memcpy(currentBufferPosition, &avatarDataBuffer[0], avatarDataLength);
-                packetLength += avatarDataLength;
-                currentBufferPosition += avatarDataLength;
+            if (node->getActiveSocket()) {
+                _broadcastReceivers.push_back(&*node);
             }
         }
     }
-    packetsSent++;
-    //printf("packetsSent=%d packetLength=%d\n", packetsSent, packetLength);
-    nodeList->getNodeSocket()->send(receiverAddress, broadcastPacket, currentBufferPosition - broadcastPacket);
+    
+    // wake the workers, the mutex makes everything written above visible to them
+    pthread_mutex_lock(&_broadcastMutex);
+    _broadcastTick = tick;
+    _nextBroadcastReceiver = 0;
+    _numBusyBroadcastWorkers = _broadcastWorkers.size();
+    _broadcastGeneration++;
+    pthread_cond_broadcast(&_broadcastStarted);
+    pthread_mutex_unlock(&_broadcastMutex);
+    
+    broadcastToReceivers(buffers);
+    
+    // the receive path can't touch avatar data until every receiver has been sent this tick's snapshot
+    pthread_mutex_lock(&_broadcastMutex);
+    while (_numBusyBroadcastWorkers > 0) {
+        pthread_cond_wait(&_broadcastFinished, &_broadcastMutex);
+    }
+    pthread_mutex_unlock(&_broadcastMutex);
 }
 
-AvatarMixer::AvatarMixer(const unsigned char* dataBuffer, int numBytes) : Assignment(dataBuffer, numBytes) {
+void AvatarMixer::broadcastToReceivers(AvatarBroadcastBuffers& buffers) {
+    NodeList* nodeList = NodeList::getInstance();
+    int numReceivers = _broadcastReceivers.size();
+    int receiverIndex = 0;
+    
+    while ((receiverIndex = __sync_fetch_and_add(&_nextBroadcastReceiver, 1)) < numReceivers) {
+        broadcastAvatarDataToNode(nodeList, _broadcastReceivers[receiverIndex], _broadcastTick, buffers);
+    }
+}
+
+void* AvatarMixer::runBroadcastWorker(void* args) {
+    AvatarMixer* mixer = (AvatarMixer*) args;
+    AvatarBroadcastBuffers buffers;
+    int lastGeneration = mixer->_broadcastWorkersStartGeneration;
+    
+    pthread_mutex_lock(&mixer->_broadcastMutex);
+    
+    while (true) {
+        while (mixer->_broadcastGeneration == lastGeneration && !mixer->_isStoppingBroadcastWorkers) {
+            pthread_cond_wait(&mixer->_broadcastStarted, &mixer->_broadcastMutex);
+        }
+        
+        if (mixer->_isStoppingBroadcastWorkers) {
+            break;
+        }
+        
+        lastGeneration = mixer->_broadcastGeneration;
+        pthread_mutex_unlock(&mixer->_broadcastMutex);
+        
+        mixer->broadcastToReceivers(buffers);
+        
+        pthread_mutex_lock(&mixer->_broadcastMutex);
+        if (--mixer->_numBusyBroadcastWorkers == 0) {
+            pthread_cond_signal(&mixer->_broadcastFinished);
+        }
+    }
     
+    pthread_mutex_unlock(&mixer->_broadcastMutex);
+    return NULL;
 }
 
 void AvatarMixer::run() {
     // change the logging target name while AvatarMixer is running
     Logging::setTargetName(AVATAR_MIXER_LOGGING_NAME);
     
+    if (getNumPayloadBytes() > 0) {
+        parsePayload();
+    }
+    
     NodeList* nodeList = NodeList::getInstance();
     nodeList->setOwnerType(NODE_TYPE_AVATAR_MIXER);
     
@@ -101,6 +511,9 @@ void AvatarMixer::run() {
     
     nodeList->linkedDataCreateCallback = attachAvatarDataToNode;
     
+    // have killed nodes dropped from the spatial index
+    nodeList->addHook(&avatarSpatialIndex);
+    
     nodeList->startSilentNodeRemovalThread();
     
     sockaddr nodeAddress = {};
@@ -111,8 +524,25 @@ void AvatarMixer::run() {
     QUuid nodeUUID;
     Node* avatarNode = NULL;
     
+    // the mixer thread builds receiver packets alongside the workers
+    AvatarBroadcastBuffers broadcastBuffers;
+    startBroadcastWorkers();
+    
+    uint64_t lastBroadcastStatsReport = usecTimestampNow();
+    uint64_t sumBroadcastUsecs = 0;
+    uint64_t maxBroadcastUsecs = 0;
+    int numBroadcastsTimed = 0;
+    std::vector<Node*> relayNodes;
+    
     timeval lastDomainServerCheckIn = {};
     
+    // make sure our node socket is non-blocking so that the broadcast tick isn't held up waiting for packets
+    nodeList->getNodeSocket()->setBlocking(false);
+    
+    uint64_t broadcastTick = 0;
+    timeval startTime;
+    gettimeofday(&startTime, NULL);
+    
     while (true) {
         
         if (NodeList::getInstance()->getNumNoReplyDomainCheckIns() == MAX_SILENT_DOMAIN_SERVER_CHECK_INS) {
@@ -127,8 +557,38 @@ void AvatarMixer::run() {
         
         nodeList->possiblyPingInactiveNodes();
         
-        if (nodeList->getNodeSocket()->receive(&nodeAddress, packetData, &receivedBytes) &&
-            packetVersionMatch(packetData)) {
+        // send every client the avatars that are due for them on this tick
+        broadcastTick++;
+        
+        uint64_t broadcastStart = usecTimestampNow();
+        broadcastAvatarData(nodeList, broadcastTick, broadcastBuffers);
+        uint64_t broadcastUsecs = usecTimestampNow() - broadcastStart;
+        
+        sumBroadcastUsecs += broadcastUsecs;
+        maxBroadcastUsecs = std::max(maxBroadcastUsecs, broadcastUsecs);
+        numBroadcastsTimed++;
+        
+        if (usecTimestampNow() - lastBroadcastStatsReport >= BROADCAST_STATS_INTERVAL_USECS) {
+            float averageBroadcastUsecs = (float) sumBroadcastUsecs / numBroadcastsTimed;
+            
+            qDebug("Broadcast to %d receivers on %d threads (%ld cores): %.0f usecs average, %llu usecs max\n",
+                   (int) _broadcastReceivers.size(), _numBroadcastWorkers + 1, sysconf(_SC_NPROCESSORS_ONLN),
+                   averageBroadcastUsecs, (long long unsigned int)maxBroadcastUsecs);
+            
+            if (Logging::shouldSendStats()) {
+                const char MIXER_LOGSTASH_METRIC_NAME[] = "avatar-mixer-broadcast-usecs";
+                Logging::stashValue(STAT_TYPE_TIMER, MIXER_LOGSTASH_METRIC_NAME, averageBroadcastUsecs);
+            }
+            
+            lastBroadcastStatsReport = usecTimestampNow();
+            sumBroadcastUsecs = 0;
+            maxBroadcastUsecs = 0;
+            numBroadcastsTimed = 0;
+        }
+        
+        // pull any new avatar data from nodes off of the network stack
+        while (nodeList->getNodeSocket()->receive(&nodeAddress, packetData, &receivedBytes) &&
+               packetVersionMatch(packetData)) {
             switch (packetData[0]) {
                 case PACKET_TYPE_HEAD_DATA:
                     nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
@@ -140,30 +600,88 @@ void AvatarMixer::run() {
                     if (avatarNode) {
                         // parse positional data from an node
                         nodeList->updateNodeWithData(avatarNode, &nodeAddress, packetData, receivedBytes);
-                    } else {
-                        break;
                     }
-                case PACKET_TYPE_INJECT_AUDIO:
-                    broadcastAvatarData(nodeList, nodeUUID, &nodeAddress);
+                    break;
+                case PACKET_TYPE_BULK_AVATAR_DATA_ACK:
+                    nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
+                                                             NUM_BYTES_RFC4122_UUID));
+                    avatarNode = nodeList->nodeWithUUID(nodeUUID);
+                    
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        uint16_t sequence;
+                        memcpy(&sequence, packetData + numBytesForPacketHeader(packetData) + NUM_BYTES_RFC4122_UUID,
+                               sizeof(sequence));
+                        ((AvatarMixerClientData*) avatarNode->getLinkedData())->acknowledgeBroadcastPacket(sequence);
+                    }
                     break;
                 case PACKET_TYPE_AVATAR_URLS:
-                case PACKET_TYPE_AVATAR_FACE_VIDEO:
                     nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
                                                              NUM_BYTES_RFC4122_UUID));
-                    // let everyone else know about the update
-                    for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
-                        if (node->getActiveSocket() && node->getUUID() != nodeUUID) {
-                            nodeList->getNodeSocket()->send(node->getActiveSocket(), packetData, receivedBytes);
+                    avatarNode = nodeList->nodeWithUUID(nodeUUID);
+                    
+                    // let everyone who is near enough to be sent this avatar know about the update
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        relayNodes.clear();
+                        avatarSpatialIndex.findNodesInRadius(((AvatarData*) avatarNode->getLinkedData())->getPosition(),
+                                                             AVATAR_INTEREST_RADIUS, relayNodes);
+                        
+                        for (std::vector<Node*>::iterator node = relayNodes.begin(); node != relayNodes.end(); node++) {
+                            if ((*node)->getActiveSocket() && (*node)->getUUID() != nodeUUID) {
+                                nodeList->getNodeSocket()->send((*node)->getActiveSocket(), packetData, receivedBytes);
+                            }
                         }
                     }
                     break;
+                case PACKET_TYPE_AVATAR_FACE_VIDEO:
+                    // a fragment too short for its header can't be parsed or relayed
+                    if (receivedBytes < numBytesForPacketHeader(packetData) + NUM_BYTES_RFC4122_UUID
+                        + FACE_VIDEO_FRAGMENT_HEADER_BYTES) {
+                        break;
+                    }
+                    nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
+                                                             NUM_BYTES_RFC4122_UUID));
+                    avatarNode = nodeList->nodeWithUUID(nodeUUID);
+                    
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        forwardFaceVideo(nodeList, avatarNode, packetData, receivedBytes);
+                    }
+                    break;
+                case PACKET_TYPE_AVATAR_FACE_VIDEO_MAX_BITRATE:
+                    if (receivedBytes < numBytesForPacketHeader(packetData) + NUM_BYTES_RFC4122_UUID
+                        + (int) sizeof(uint32_t)) {
+                        break;
+                    }
+                    nodeUUID = QUuid::fromRfc4122(QByteArray((char*) packetData + numBytesForPacketHeader(packetData),
+                                                             NUM_BYTES_RFC4122_UUID));
+                    avatarNode = nodeList->nodeWithUUID(nodeUUID);
+                    
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        uint32_t maxFaceVideoKbps;
+                        memcpy(&maxFaceVideoKbps,
+                               packetData + numBytesForPacketHeader(packetData) + NUM_BYTES_RFC4122_UUID,
+                               sizeof(maxFaceVideoKbps));
+                        ((AvatarMixerClientData*) avatarNode->getLinkedData())->setMaxFaceVideoKbps(maxFaceVideoKbps);
+                    }
+                    break;
                 default:
                     // hand this off to the NodeList
                     nodeList->processNodeData(&nodeAddress, packetData, receivedBytes);
                     break;
             }
         }
+        
+        int usecToSleep = usecTimestamp(&startTime) + (broadcastTick * AVATAR_BROADCAST_INTERVAL_USECS)
+            - usecTimestampNow();
+        
+        if (usecToSleep > 0) {
+            usleep(usecToSleep);
+        } else {
+            qDebug("Took too much time, not sleeping!\n");
+        }
     }
     
+    stopBroadcastWorkers();
+    
+    nodeList->removeHook(&avatarSpatialIndex);
     nodeList->stopSilentNodeRemovalThread();
 }
@@ -9,7 +9,13 @@
 #ifndef __hifi__AvatarMixer__
 #define __hifi__AvatarMixer__
 
+#include <pthread.h>
+#include <vector>
+
 #include <Assignment.h>
+#include <NodeList.h>
+
+struct AvatarBroadcastBuffers;
 
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public Assignment {
@@ -18,6 +24,38 @@ public:
     
     /// runs the avatar mixer
     void run();
+private:
+    /// parses the assignment payload, `--broadcastBenchmark 200` times building the broadcast data for 200 avatars and
+    /// `--broadcastThreads 3` builds the packets for receivers on three worker threads as well as the mixer thread
+    void parsePayload();
+    
+    void startBroadcastWorkers();
+    void stopBroadcastWorkers();
+    
+    /// packs every avatar's changed fields, then builds and sends every receiver's packets for this tick on the worker
+    /// threads and the calling thread, returning once they are all sent
+    void broadcastAvatarData(NodeList* nodeList, uint64_t tick, AvatarBroadcastBuffers& buffers);
+    
+    /// takes receivers for this tick until there are none left
+    void broadcastToReceivers(AvatarBroadcastBuffers& buffers);
+    
+    static void* runBroadcastWorker(void* args);
+    
+    int _numBroadcastWorkers;
+    std::vector<pthread_t> _broadcastWorkers;
+    
+    // the receivers for the current tick, the avatar data stays as it was when the tick started until all are sent
+    std::vector<Node*> _broadcastReceivers;
+    uint64_t _broadcastTick;
+    volatile int _nextBroadcastReceiver;
+    
+    int _broadcastGeneration;
+    int _broadcastWorkersStartGeneration;
+    int _numBusyBroadcastWorkers;
+    bool _isStoppingBroadcastWorkers;
+    pthread_mutex_t _broadcastMutex;
+    pthread_cond_t _broadcastStarted;
+    pthread_cond_t _broadcastFinished;
 };
 
 #endif /* defined(__hifi__AvatarMixer__) */
@@ -0,0 +1,258 @@
+//
+//  AvatarMixerClientData.cpp
+//  hifi
+//
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "AvatarMixerClientData.h"
+
+// field versions come from one counter for every avatar, so an avatar that leaves and comes back with the same UUID
+// can't be mistaken for the state a client acknowledged before
+uint32_t AvatarMixerClientData::_lastFieldVersion = 0;
+
+AvatarMixerClientData::AvatarMixerClientData(Node* owningNode, NodeSpatialIndex* spatialIndex) :
+    AvatarData(owningNode),
+    _spatialIndex(spatialIndex),
+    _isCompactFieldCacheStale(true),
+    _broadcastStates(),
+    _nextBroadcastSequence(0),
+    _faceVideoForwardStates(),
+    _maxFaceVideoKbps(0),
+    _faceVideoByteAllowance(0.0f),
+    _lastFaceVideoAllowanceUpdate(usecTimestampNow())
+{
+    memset(_compactFieldOffsets, 0, sizeof(_compactFieldOffsets));
+    memset(_fieldVersions, 0, sizeof(_fieldVersions));
+    
+    for (int i = 0; i < BROADCAST_PACKET_HISTORY_LENGTH; i++) {
+        _sentBroadcastPackets[i].isAcknowledged = true;
+    }
+}
+
+AvatarMixerClientData::~AvatarMixerClientData() {
+    if (_spatialIndex && _owningNode) {
+        _spatialIndex->removeNode(_owningNode);
+    }
+}
+
+int AvatarMixerClientData::parseData(unsigned char* sourceBuffer, int numBytes) {
+    _isCompactFieldCacheStale = true;
+    int numBytesParsed = AvatarData::parseData(sourceBuffer, numBytes);
+    
+    if (_spatialIndex && _owningNode) {
+        _spatialIndex->updateNode(_owningNode, _position);
+    }
+    
+    return numBytesParsed;
+}
+
+void AvatarMixerClientData::updateCompactFieldCache() {
+    if (!_isCompactFieldCacheStale) {
+        return;
+    }
+    
+    unsigned char packedFields[2 * MAX_PACKET_SIZE];
+    int packedFieldOffsets[NUM_AVATAR_FIELDS + 1];
+    packedFieldOffsets[0] = 0;
+    
+    for (int field = 0; field < NUM_AVATAR_FIELDS; field++) {
+        packedFieldOffsets[field + 1] = packedFieldOffsets[field]
+            + packCompactField((AvatarDataField) field, packedFields + packedFieldOffsets[field]);
+        
+        int numFieldBytes = packedFieldOffsets[field + 1] - packedFieldOffsets[field];
+        int numCachedFieldBytes = _compactFieldOffsets[field + 1] - _compactFieldOffsets[field];
+        
+        if (_fieldVersions[field] == 0 || numFieldBytes != numCachedFieldBytes
+            || memcmp(packedFields + packedFieldOffsets[field], _compactFields + _compactFieldOffsets[field],
+                      numFieldBytes) != 0) {
+            _fieldVersions[field] = ++_lastFieldVersion;
+        }
+    }
+    
+    memcpy(_compactFields, packedFields, packedFieldOffsets[NUM_AVATAR_FIELDS]);
+    memcpy(_compactFieldOffsets, packedFieldOffsets, sizeof(_compactFieldOffsets));
+    
+    _isCompactFieldCacheStale = false;
+}
+
+AvatarFieldMask AvatarMixerClientData::getChangedFields(const uint32_t* acknowledgedFieldVersions) const {
+    AvatarFieldMask changedFields = 0;
+    
+    for (int field = 0; field < NUM_AVATAR_FIELDS; field++) {
+        if (_fieldVersions[field] > acknowledgedFieldVersions[field]) {
+            changedFields |= (1 << field);
+        }
+    }
+    
+    return changedFields;
+}
+
+int AvatarMixerClientData::getCompactRecordLength(AvatarFieldMask fieldMask) const {
+    int recordLength = NUM_BYTES_RFC4122_UUID + sizeof(fieldMask);
+    
+    for (int field = 0; field < NUM_AVATAR_FIELDS; field++) {
+        if (fieldMask & (1 << field)) {
+            recordLength += _compactFieldOffsets[field + 1] - _compactFieldOffsets[field];
+        }
+    }
+    
+    return recordLength;
+}
+
+int AvatarMixerClientData::writeCompactRecord(unsigned char* destinationBuffer, const QUuid& nodeUUID,
+                                              AvatarFieldMask fieldMask) const {
+    unsigned char* bufferStart = destinationBuffer;
+    
+    memcpy(destinationBuffer, nodeUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    destinationBuffer += NUM_BYTES_RFC4122_UUID;
+    
+    memcpy(destinationBuffer, &fieldMask, sizeof(fieldMask));
+    destinationBuffer += sizeof(fieldMask);
+    
+    for (int field = 0; field < NUM_AVATAR_FIELDS; field++) {
+        if (fieldMask & (1 << field)) {
+            int numFieldBytes = _compactFieldOffsets[field + 1] - _compactFieldOffsets[field];
+            memcpy(destinationBuffer, _compactFields + _compactFieldOffsets[field], numFieldBytes);
+            destinationBuffer += numFieldBytes;
+        }
+    }
+    
+    return destinationBuffer - bufferStart;
+}
+
+glm::vec3 AvatarMixerClientData::getViewDirection() const {
+    float viewYaw = glm::radians(_bodyYaw + (_headData ? _headData->getYaw() : 0.0f));
+    return glm::vec3(-sinf(viewYaw), 0.0f, -cosf(viewYaw));
+}
+
+uint64_t AvatarMixerClientData::getTicksSinceBroadcast(const QUuid& avatarUUID, uint64_t currentTick) const {
+    std::map<QUuid, AvatarBroadcastState>::const_iterator state = _broadcastStates.find(avatarUUID);
+    return state == _broadcastStates.end() ? NEVER_BROADCAST_TICKS : currentTick - state->second.lastBroadcastTick;
+}
+
+uint64_t AvatarMixerClientData::getTicksSinceKeyFrame(const QUuid& avatarUUID, uint64_t currentTick) const {
+    std::map<QUuid, AvatarBroadcastState>::const_iterator state = _broadcastStates.find(avatarUUID);
+    return state == _broadcastStates.end() ? NEVER_BROADCAST_TICKS : currentTick - state->second.lastKeyFrameTick;
+}
+
+const uint32_t* AvatarMixerClientData::getAcknowledgedFieldVersions(const QUuid& avatarUUID) {
+    static const uint32_t NO_ACKNOWLEDGED_FIELD_VERSIONS[NUM_AVATAR_FIELDS] = {};
+    
+    std::map<QUuid, AvatarBroadcastState>::const_iterator state = _broadcastStates.find(avatarUUID);
+    return state == _broadcastStates.end() ? NO_ACKNOWLEDGED_FIELD_VERSIONS : state->second.acknowledgedFieldVersions;
+}
+
+uint16_t AvatarMixerClientData::beginBroadcastPacket() {
+    SentBroadcastPacket& sentPacket = _sentBroadcastPackets[_nextBroadcastSequence % BROADCAST_PACKET_HISTORY_LENGTH];
+    sentPacket.sequence = _nextBroadcastSequence;
+    sentPacket.isAcknowledged = false;
+    sentPacket.records.clear();
+    
+    return _nextBroadcastSequence++;
+}
+
+void AvatarMixerClientData::addBroadcastRecord(const QUuid& avatarUUID, AvatarMixerClientData* avatar,
+                                               AvatarFieldMask fieldMask, uint64_t tick, bool isKeyFrame) {
+    std::map<QUuid, AvatarBroadcastState>::iterator state = _broadcastStates.find(avatarUUID);
+    
+    if (state == _broadcastStates.end()) {
+        AvatarBroadcastState newState = {};
+        state = _broadcastStates.insert(std::pair<QUuid, AvatarBroadcastState>(avatarUUID, newState)).first;
+    }
+    
+    state->second.lastBroadcastTick = tick;
+    
+    if (isKeyFrame) {
+        state->second.lastKeyFrameTick = tick;
+    }
+    
+    if (fieldMask) {
+        SentAvatarRecord sentRecord;
+        sentRecord.avatarUUID = avatarUUID;
+        sentRecord.fieldMask = fieldMask;
+        memcpy(sentRecord.fieldVersions, avatar->getFieldVersions(), sizeof(sentRecord.fieldVersions));
+        
+        _sentBroadcastPackets[(uint16_t) (_nextBroadcastSequence - 1) % BROADCAST_PACKET_HISTORY_LENGTH]
+            .records.push_back(sentRecord);
+    }
+}
+
+void AvatarMixerClientData::acknowledgeBroadcastPacket(uint16_t sequence) {
+    SentBroadcastPacket& sentPacket = _sentBroadcastPackets[sequence % BROADCAST_PACKET_HISTORY_LENGTH];
+    
+    // ignore acknowledgements for packets that have already aged out of the history
+    if (sentPacket.sequence != sequence || sentPacket.isAcknowledged) {
+        return;
+    }
+    
+    for (std::vector<SentAvatarRecord>::iterator record = sentPacket.records.begin();
+         record != sentPacket.records.end();
+         record++) {
+        std::map<QUuid, AvatarBroadcastState>::iterator state = _broadcastStates.find(record->avatarUUID);
+        
+        if (state != _broadcastStates.end()) {
+            for (int field = 0; field < NUM_AVATAR_FIELDS; field++) {
+                if (record->fieldMask & (1 << field)) {
+                    state->second.acknowledgedFieldVersions[field] = std::max(state->second.acknowledgedFieldVersions[field],
+                                                                              record->fieldVersions[field]);
+                }
+            }
+        }
+    }
+    
+    sentPacket.isAcknowledged = true;
+}
+
+void AvatarMixerClientData::removeBroadcastStatesBefore(uint64_t oldestTick) {
+    std::map<QUuid, AvatarBroadcastState>::iterator state = _broadcastStates.begin();
+    
+    while (state != _broadcastStates.end()) {
+        if (state->second.lastBroadcastTick < oldestTick) {
+            _broadcastStates.erase(state++);
+        } else {
+            ++state;
+        }
+    }
+}
+
+FaceVideoForwardState& AvatarMixerClientData::getFaceVideoForwardState(const QUuid& avatarUUID) {
+    std::map<QUuid, FaceVideoForwardState>::iterator state = _faceVideoForwardStates.find(avatarUUID);
+    
+    if (state == _faceVideoForwardStates.end()) {
+        FaceVideoForwardState newState = { FACE_VIDEO_KEY_FRAMES, 0, false };
+        state = _faceVideoForwardStates.insert(std::pair<QUuid, FaceVideoForwardState>(avatarUUID, newState)).first;
+    }
+    
+    return state->second;
+}
+
+bool AvatarMixerClientData::consumeFaceVideoBytes(int numBytes) {
+    if (_maxFaceVideoKbps == 0) {
+        return true;
+    }
+    
+    // the allowance refills at the client's rate, holding at most a second's worth
+    const float BYTES_PER_KILOBIT = 1000.0f / 8.0f;
+    float bytesPerSecond = _maxFaceVideoKbps * BYTES_PER_KILOBIT;
+    
+    uint64_t now = usecTimestampNow();
+    _faceVideoByteAllowance = std::min(bytesPerSecond, _faceVideoByteAllowance
+                                       + bytesPerSecond * (now - _lastFaceVideoAllowanceUpdate) / 1000000.0f);
+    _lastFaceVideoAllowanceUpdate = now;
+    
+    // a frame is let through as long as there is any allowance left, so that frames bigger than a second's worth of
+    // allowance still get through now and then
+    if (_faceVideoByteAllowance <= 0.0f) {
+        return false;
+    }
+    
+    _faceVideoByteAllowance -= numBytes;
+    return true;
+}
@@ -0,0 +1,136 @@
+//
+//  AvatarMixerClientData.h
+//  hifi
+//
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+
+#ifndef __hifi__AvatarMixerClientData__
+#define __hifi__AvatarMixerClientData__
+
+#include <map>
+#include <vector>
+
+#include <QtCore/QUuid>
+
+#include <AvatarData.h>
+#include <NodeList.h>
+#include <NodeSpatialIndex.h>
+
+/// returned by getTicksSinceBroadcast for an avatar that has never been sent to this client
+const uint64_t NEVER_BROADCAST_TICKS = (uint64_t) -1;
+
+/// how many sent bulk avatar data packets each client can acknowledge
+const int BROADCAST_PACKET_HISTORY_LENGTH = 64;
+
+/// which of another avatar's face video frames a client is sent, in order of increasing bandwidth
+enum FaceVideoForwardMode {
+    FACE_VIDEO_NO_FRAMES,
+    FACE_VIDEO_KEY_FRAMES,
+    FACE_VIDEO_ALL_FRAMES
+};
+
+/// how a client is being sent another avatar's face video, the mode only goes up at key frames so that the client's
+/// decoder is never handed a frame that depends on one it didn't get
+struct FaceVideoForwardState {
+    FaceVideoForwardMode mode;
+    uint32_t frameCount;
+    bool isForwardingFrame;
+};
+
+/// The avatar mixer's data for a client. Holds their own avatar, with its compact fields cached between updates, and
+/// for every other avatar the broadcast tick it was last sent on and the field versions this client has acknowledged.
+class AvatarMixerClientData : public AvatarData {
+public:
+    AvatarMixerClientData(Node* owningNode, NodeSpatialIndex* spatialIndex = NULL);
+    ~AvatarMixerClientData();
+    
+    /// parses an update from the client, marks the cached compact fields as stale and moves the owning node to the
+    /// parsed position in the spatial index
+    int parseData(unsigned char* sourceBuffer, int numBytes);
+    
+    /// re-packs the compact fields if an update has come in since last time, bumping the version of the ones that changed
+    void updateCompactFieldCache();
+    
+    /// the fields whose current version is newer than the given acknowledged versions
+    AvatarFieldMask getChangedFields(const uint32_t* acknowledgedFieldVersions) const;
+    
+    const uint32_t* getFieldVersions() const { return _fieldVersions; }
+    
+    /// size of a record with the given fields: node UUID, field mask and the fields
+    int getCompactRecordLength(AvatarFieldMask fieldMask) const;
+    
+    /// writes a record with the given fields, returns the number of bytes written
+    int writeCompactRecord(unsigned char* destinationBuffer, const QUuid& nodeUUID, AvatarFieldMask fieldMask) const;
+    
+    /// the direction this client's avatar is facing, from its body and head yaw
+    glm::vec3 getViewDirection() const;
+    
+    uint64_t getTicksSinceBroadcast(const QUuid& avatarUUID, uint64_t currentTick) const;
+    uint64_t getTicksSinceKeyFrame(const QUuid& avatarUUID, uint64_t currentTick) const;
+    
+    /// the field versions of that avatar this client is known to have
+    const uint32_t* getAcknowledgedFieldVersions(const QUuid& avatarUUID);
+    
+    /// starts logging the records going into the next bulk avatar data packet, returns its sequence number
+    uint16_t beginBroadcastPacket();
+    
+    /// logs a record that was added to the current packet
+    void addBroadcastRecord(const QUuid& avatarUUID, AvatarMixerClientData* avatar, AvatarFieldMask fieldMask,
+                            uint64_t tick, bool isKeyFrame);
+    
+    /// the client has received the packet with this sequence number, so it has the field versions sent in it
+    void acknowledgeBroadcastPacket(uint16_t sequence);
+    
+    /// forgets avatars that haven't been sent since oldestTick, so that nodes that have left don't pile up here
+    void removeBroadcastStatesBefore(uint64_t oldestTick);
+    
+    /// the face video forwarding state for that avatar, starting out waiting for a key frame
+    FaceVideoForwardState& getFaceVideoForwardState(const QUuid& avatarUUID);
+    void removeFaceVideoForwardState(const QUuid& avatarUUID) { _faceVideoForwardStates.erase(avatarUUID); }
+    
+    /// the most face video this client wants to be sent, zero for no limit
+    void setMaxFaceVideoKbps(int maxFaceVideoKbps) { _maxFaceVideoKbps = maxFaceVideoKbps; }
+    int getMaxFaceVideoKbps() const { return _maxFaceVideoKbps; }
+    
+    /// takes numBytes out of this client's face video allowance, returns false if it is used up
+    bool consumeFaceVideoBytes(int numBytes);
+private:
+    struct AvatarBroadcastState {
+        uint64_t lastBroadcastTick;
+        uint64_t lastKeyFrameTick;
+        uint32_t acknowledgedFieldVersions[NUM_AVATAR_FIELDS];
+    };
+    
+    struct SentAvatarRecord {
+        QUuid avatarUUID;
+        AvatarFieldMask fieldMask;
+        uint32_t fieldVersions[NUM_AVATAR_FIELDS];
+    };
+    
+    struct SentBroadcastPacket {
+        uint16_t sequence;
+        bool isAcknowledged;
+        std::vector<SentAvatarRecord> records;
+    };
+    
+    static uint32_t _lastFieldVersion;
+    
+    NodeSpatialIndex* _spatialIndex;
+    
+    unsigned char _compactFields[2 * MAX_PACKET_SIZE];
+    int _compactFieldOffsets[NUM_AVATAR_FIELDS + 1];
+    uint32_t _fieldVersions[NUM_AVATAR_FIELDS];
+    bool _isCompactFieldCacheStale;
+    
+    std::map<QUuid, AvatarBroadcastState> _broadcastStates;
+    SentBroadcastPacket _sentBroadcastPackets[BROADCAST_PACKET_HISTORY_LENGTH];
+    uint16_t _nextBroadcastSequence;
+    
+    std::map<QUuid, FaceVideoForwardState> _faceVideoForwardStates;
+    int _maxFaceVideoKbps;
+    float _faceVideoByteAllowance;
+    uint64_t _lastFaceVideoAllowanceUpdate;
+};
+
+#endif /* defined(__hifi__AvatarMixerClientData__) */
@@ -1205,7 +1205,7 @@ void Application::sendPingPackets() {
                                               nodesToPing, sizeof(nodesToPing));
 }
 
-void Application::sendAvatarFaceVideoMessage(int frameCount, const QByteArray& data) {
+void Application::sendAvatarFaceVideoMessage(int frameCount, const QByteArray& data, bool isKeyFrame) {
     unsigned char packet[MAX_PACKET_SIZE];
     unsigned char* packetPosition = packet;
     
@@ -1224,6 +1224,9 @@ void Application::sendAvatarFaceVideoMessage(int frameCount, const QByteArray& d
     uint32_t* offsetPosition = (uint32_t*)packetPosition;
     packetPosition += sizeof(uint32_t);
     
+    // lets the avatar mixer thin the video for distant receivers by only sending them key frames
+    *packetPosition++ = isKeyFrame ? FACE_VIDEO_KEY_FRAME_FLAG : 0;
+    
     int headerSize = packetPosition - packet;
     
     // break the data up into submessages of the maximum size (at least one, for zero-length packets)
@@ -2334,6 +2337,7 @@ void Application::updateAvatar(float deltaTime) {
     const float AVATAR_URLS_SEND_INTERVAL = 1.0f; // seconds
     if (shouldDo(AVATAR_URLS_SEND_INTERVAL, deltaTime)) {
         Avatar::sendAvatarURLsMessage(_myAvatar.getVoxels()->getVoxelURL());
+        Avatar::sendFaceVideoMaxBitrateMessage(Menu::getInstance()->getMaxFaceVideoKbps());
     }
 
     // Update _viewFrustum with latest camera and view frustum data...
@@ -2363,6 +2367,17 @@ void Application::queryVoxels() {
     _voxelQuery.setCameraNearClip(_viewFrustum.getNearClip());
     _voxelQuery.setCameraFarClip(_viewFrustum.getFarClip());
     _voxelQuery.setCameraEyeOffsetPosition(_viewFrustum.getEyeOffsetPosition());
+    
+    // the servers size the voxels they send for our screen, and we draw them with the same level of detail
+    _voxelQuery.setScreenHeight(_glWidget->height());
+    _voxelQuery.setLODQuality(Menu::getInstance()->getVoxelLODQuality());
+    _voxels.setLODScale(_voxelQuery.getLODScale());
+    
+    // a newly arrived view fills in coarse to fine rather than a piece at a time
+    _voxelQuery.setWantProgressive(Menu::getInstance()->isOptionChecked(MenuOption::ProgressiveVoxelSending));
+    
+    // voxels sent ahead of where we're looking are only worth it if we don't remove them for being out of view
+    _voxelQuery.setWantPrefetch(!Menu::getInstance()->isOptionChecked(MenuOption::RemoveOutOfView));
 
     unsigned char voxelQueryPacket[MAX_PACKET_SIZE];
 
@@ -2439,6 +2454,15 @@ void Application::queryVoxels() {
                 memcpy(endOfVoxelQueryPacket, ownerUUID.constData(), ownerUUID.size());
                 endOfVoxelQueryPacket += ownerUUID.size();
 
+                // acknowledge the voxel packets we've had from this server for its rate control, ask for any we missed
+                _voxelPacketAcksMutex.lock();
+                _voxelPacketAcks[nodeUUID].acknowledgeInQuery(_voxelQuery);
+                
+                // any voxels we dropped or never received mean the server can't count on what it has sent us
+                _voxelQuery.setLocalVoxelsGeneration(_voxels.getLocalVoxelsGeneration()
+                                                     + _voxelPacketAcks[nodeUUID].getNumPacketsAbandoned());
+                _voxelPacketAcksMutex.unlock();
+                
                 // encode the query data...
                 endOfVoxelQueryPacket += _voxelQuery.getBroadcastData(endOfVoxelQueryPacket);
         
@@ -3856,6 +3880,10 @@ void Application::nodeKilled(Node* node) {
             fade.voxelDetails.s = fade.voxelDetails.s * slightly_smaller;
             _voxelFades.push_back(fade);
         }
+        
+        _voxelPacketAcksMutex.lock();
+        _voxelPacketAcks.erase(nodeUUID);
+        _voxelPacketAcksMutex.unlock();
     } else if (node->getLinkedData() == _lookatTargetAvatar) {
         _lookatTargetAvatar = NULL;
     }
@@ -3924,6 +3952,7 @@ void* Application::networkReceive(void* args) {
                         
                         break;
                     case PACKET_TYPE_MIXED_AUDIO:
+                    case PACKET_TYPE_SILENT_AUDIO_FRAME:
                         app->_audio.addReceivedAudioToBuffer(app->_incomingPacket, bytesReceived);
                         break;
                     case PACKET_TYPE_VOXEL_DATA:
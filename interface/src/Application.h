@@ -18,10 +18,12 @@
 #include <QSettings>
 #include <QTouchEvent>
 #include <QList>
+#include <QMutex>
 
 #include <NetworkPacket.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
+#include <VoxelPacketAcks.h>
 #include <VoxelQuery.h>
 
 #ifndef _WIN32
@@ -162,7 +164,7 @@ public:
     VoxelShader& getVoxelShader() { return _voxelShader; }
 
 public slots:
-    void sendAvatarFaceVideoMessage(int frameCount, const QByteArray& data);
+    void sendAvatarFaceVideoMessage(int frameCount, const QByteArray& data, bool isKeyFrame);
     void exportVoxels();
     void importVoxels();
     void cutVoxels();
@@ -415,6 +417,10 @@ private:
     
     NodeToJurisdictionMap _voxelServerJurisdictions;
     
+    // the packets received from each voxel server, written by the voxel packet processor and read by queryVoxels()
+    NodeToVoxelPacketAcksMap _voxelPacketAcks;
+    QMutex _voxelPacketAcksMutex;
+    
     std::vector<VoxelFade> _voxelFades;
 };
 
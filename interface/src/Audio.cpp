@@ -70,12 +70,93 @@ static const int   PING_FRAMES_TO_RECORD = AEC_BUFFERED_FRAMES;
 static const int   PING_SAMPLES_TO_ANALYZE = AEC_BUFFERED_SAMPLES_PER_CHANNEL;  // Samples to analyze (reusing AEC buffer)
 static const int   PING_BUFFER_OFFSET = BUFFER_LENGTH_SAMPLES_PER_CHANNEL - PING_PERIOD * 2.0f; // Signal start
 
+// Silence gate configuration (frames under the gate are sent as compact silence markers instead of PCM)
+static const float SILENCE_GATE_MIN_LOUDNESS = 8.f;                             // Loudness that is always silence
+static const float SILENCE_GATE_NOISE_FLOOR_RATIO = 2.f;                        // Loudness over noise floor that is voice
+static const float SILENCE_GATE_NOISE_FLOOR_RISE = 0.001f;                      // Rate the noise floor estimate rises
+static const int   SILENCE_GATE_HANGOVER_FRAMES = 10;                           // Frames sent after voice stops
+
+// Handoff between the audio callback and the worker thread
+static const int   AUDIO_FRAME_QUEUE_LENGTH = 4;                                // Frames each way between callback and worker
+static const int   RECEIVED_AUDIO_QUEUE_LENGTH = 16;                            // Mixer packets waiting to be parsed
+static const float CALLBACK_USECS_AVERAGE_RATE = 0.01f;                         // Weight of each callback in its average
+
 // Mute icon configration
 static const int ICON_SIZE = 24;
 static const int ICON_LEFT = 20;
 static const int BOTTOM_PADDING = 110;
 
 inline void Audio::performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* outputRight) {
+    uint64_t callbackStart = usecTimestampNow();
+
+    // hand the microphone frame to the worker, if it has fallen this far behind the frame is lost
+    if (!_inputFrames.write(inputLeft)) {
+        _numInputOverruns++;
+    }
+    
+    // the worker only holds the lock to check for a frame before it waits, so this doesn't keep the callback waiting
+    pthread_mutex_lock(&_workerMutex);
+    pthread_cond_signal(&_hasInputFrame);
+    pthread_mutex_unlock(&_workerMutex);
+
+    // play the frame the worker rendered for the previous callback
+    int16_t* outputFrame = _outputFrames.getFrameToRead();
+    if (outputFrame) {
+        memcpy(outputLeft, outputFrame, PACKET_LENGTH_BYTES_PER_CHANNEL);
+        memcpy(outputRight, outputFrame + PACKET_LENGTH_SAMPLES_PER_CHANNEL, PACKET_LENGTH_BYTES_PER_CHANNEL);
+        _outputFrames.commitRead();
+    } else {
+        memset(outputLeft, 0, PACKET_LENGTH_BYTES_PER_CHANNEL);
+        memset(outputRight, 0, PACKET_LENGTH_BYTES_PER_CHANNEL);
+        _numCallbackUnderruns++;
+    }
+
+    gettimeofday(&_lastCallbackTime, NULL);
+
+    int callbackUsecs = usecTimestampNow() - callbackStart;
+    _maxCallbackUsecs = std::max(_maxCallbackUsecs, callbackUsecs);
+    _averageCallbackUsecs += (callbackUsecs - _averageCallbackUsecs) * CALLBACK_USECS_AVERAGE_RATE;
+}
+
+bool Audio::process() {
+    // sleep until the callback hands over the next frame
+    pthread_mutex_lock(&_workerMutex);
+    while (!_inputFrames.getFrameToRead() && !_isStoppingWorker) {
+        pthread_cond_wait(&_hasInputFrame, &_workerMutex);
+    }
+    bool isStoppingWorker = _isStoppingWorker;
+    pthread_mutex_unlock(&_workerMutex);
+    
+    if (isStoppingWorker) {
+        return false;
+    }
+    
+    if (_isResetPending) {
+        _packetsReceivedThisPlayback = 0;
+        _ringBuffer.reset();
+        _isResetPending = false;
+    }
+
+    // parse everything the mixer has sent since the last frame
+    ReceivedAudioPacket* receivedPacket;
+    while ((receivedPacket = _receivedPackets.getFrameToRead())) {
+        parseReceivedAudio(receivedPacket->data, receivedPacket->numBytes, receivedPacket->receivedTime);
+        _receivedPackets.commitRead();
+    }
+
+    int16_t* inputLeft = _inputFrames.getFrameToRead();
+
+    int16_t* outputFrame = _outputFrames.getFrameToWrite();
+    if (outputFrame) {
+        processAudioFrame(inputLeft, outputFrame, outputFrame + PACKET_LENGTH_SAMPLES_PER_CHANNEL);
+        _outputFrames.commitWrite();
+    }
+
+    _inputFrames.commitRead();
+    return isStillRunning();
+}
+
+void Audio::processAudioFrame(int16_t* inputLeft, int16_t* outputLeft, int16_t* outputRight) {
 
     NodeList* nodeList = NodeList::getInstance();
     Application* interface = Application::getInstance();
@@ -102,6 +183,8 @@ inline void Audio::performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* o
     
         loudness /= BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
         _lastInputLoudness = loudness;
+        
+        bool isInputSilent = updateSilenceGate(loudness);
     
         // add input (@microphone) data to the scope
         _scope->addSamples(0, inputLeft, BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
@@ -124,6 +207,10 @@ inline void Audio::performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* o
                     ? PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO
                     : PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO;
                 
+                if (isInputSilent) {
+                    packetType = PACKET_TYPE_SILENT_MICROPHONE_AUDIO;
+                }
+                
                 unsigned char* currentPacketPtr = dataPacket + populateTypeAndVersion(dataPacket, packetType);
                 
                 // pack Source Data
@@ -140,14 +227,24 @@ inline void Audio::performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* o
                 memcpy(currentPacketPtr, &headOrientation, sizeof(headOrientation));
                 currentPacketPtr += sizeof(headOrientation);
                 
-                // copy the audio data to the last BUFFER_LENGTH_BYTES bytes of the data packet
-                memcpy(currentPacketPtr, inputLeft, BUFFER_LENGTH_BYTES_PER_CHANNEL);
+                int numAudioBytes = 0;
+                
+                if (isInputSilent) {
+                    // in place of the audio data send the number of samples of silence this packet stands for
+                    int16_t numSilentSamples = BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+                    memcpy(currentPacketPtr, &numSilentSamples, sizeof(numSilentSamples));
+                    numAudioBytes = sizeof(numSilentSamples);
+                } else {
+                    // copy the audio data to the last BUFFER_LENGTH_BYTES bytes of the data packet
+                    memcpy(currentPacketPtr, inputLeft, BUFFER_LENGTH_BYTES_PER_CHANNEL);
+                    numAudioBytes = BUFFER_LENGTH_BYTES_PER_CHANNEL;
+                }
                 
                 nodeList->getNodeSocket()->send(audioMixer->getActiveSocket(),
                                                 dataPacket,
-                                                BUFFER_LENGTH_BYTES_PER_CHANNEL + leadingBytes);
+                                                numAudioBytes + leadingBytes);
                 
-                interface->getBandwidthMeter()->outputStream(BandwidthMeter::AUDIO).updateValue(BUFFER_LENGTH_BYTES_PER_CHANNEL
+                interface->getBandwidthMeter()->outputStream(BandwidthMeter::AUDIO).updateValue(numAudioBytes
                                                                                                 + leadingBytes);
             } else {
                 nodeList->pingPublicAndLocalSocketsForInactiveNode(audioMixer);
@@ -287,8 +384,6 @@ inline void Audio::performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* o
     // add output (@speakers) data just written to the scope
     _scope->addSamples(1, outputLeft, BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
     _scope->addSamples(2, outputRight, BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
-
-    gettimeofday(&_lastCallbackTime, NULL);
 }
 
 // inputBuffer  A pointer to an internal portaudio data buffer containing data read by portaudio.
@@ -326,8 +421,8 @@ static void outputPortAudioError(PaError error) {
 }
 
 void Audio::reset() {
-    _packetsReceivedThisPlayback = 0;
-    _ringBuffer.reset();
+    // the ring buffer belongs to the worker, let it do the reset between frames
+    _isResetPending = true;
 }
 
 Audio::Audio(Oscilloscope* scope, int16_t initialJitterBufferSamples) :
@@ -360,8 +455,22 @@ Audio::Audio(Oscilloscope* scope, int16_t initialJitterBufferSamples) :
     _collisionSoundDuration(0.0f),
     _proceduralEffectSample(0),
     _heartbeatMagnitude(0.0f),
-    _muted(false)
+    _noiseFloorLoudness(SILENCE_GATE_MIN_LOUDNESS),
+    _silenceGateHangoverFrames(0),
+    _muted(false),
+    _inputFrames(BUFFER_LENGTH_SAMPLES_PER_CHANNEL, AUDIO_FRAME_QUEUE_LENGTH),
+    _outputFrames(PACKET_LENGTH_SAMPLES, AUDIO_FRAME_QUEUE_LENGTH),
+    _receivedPackets(1, RECEIVED_AUDIO_QUEUE_LENGTH),
+    _isResetPending(false),
+    _isStoppingWorker(false),
+    _averageCallbackUsecs(0.0f),
+    _maxCallbackUsecs(0),
+    _numCallbackUnderruns(0),
+    _numInputOverruns(0)
 {
+    pthread_mutex_init(&_workerMutex, NULL);
+    pthread_cond_init(&_hasInputFrame, NULL);
+    
     outputPortAudioError(Pa_Initialize());
     
     //  NOTE:  Portaudio documentation is unclear as to whether it is safe to specify the
@@ -407,6 +516,16 @@ Audio::Audio(Oscilloscope* scope, int16_t initialJitterBufferSamples) :
  
     _echoSamplesLeft = new int16_t[AEC_BUFFERED_SAMPLES + AEC_TMP_BUFFER_SIZE];
     memset(_echoSamplesLeft, 0, AEC_BUFFERED_SAMPLES * sizeof(int16_t));
+
+    // the worker renders the output for a frame while the next one is being captured, so start one frame ahead
+    int16_t* firstOutputFrame = _outputFrames.getFrameToWrite();
+    memset(firstOutputFrame, 0, PACKET_LENGTH_BYTES);
+    _outputFrames.commitWrite();
+
+    gettimeofday(&_lastReceiveTime, NULL);
+
+    // start the worker thread before the callback begins handing it frames
+    initialize();
     
     // start the stream now that sources are good to go
     outputPortAudioError(Pa_StartStream(_stream));
@@ -419,8 +538,6 @@ Audio::Audio(Oscilloscope* scope, int16_t initialJitterBufferSamples) :
     const PaStreamInfo* streamInfo = Pa_GetStreamInfo(_stream);
     qDebug("Started audio with reported latency msecs In/Out: %.0f, %.0f\n", streamInfo->inputLatency * 1000.f,
              streamInfo->outputLatency * 1000.f);
-
-    gettimeofday(&_lastReceiveTime, NULL);
 }
 
 void Audio::shutdown() {
@@ -428,15 +545,37 @@ void Audio::shutdown() {
         outputPortAudioError(Pa_CloseStream(_stream));
         outputPortAudioError(Pa_Terminate());
     }
+
+    // stop the worker before the buffers it uses go away, waking it since the callback no longer will
+    pthread_mutex_lock(&_workerMutex);
+    _isStoppingWorker = true;
+    pthread_cond_signal(&_hasInputFrame);
+    pthread_mutex_unlock(&_workerMutex);
+    terminate();
+    
+    qDebug("Audio callback msecs average: %.3f max: %.3f, underruns: %d, input overruns: %d\n",
+           _averageCallbackUsecs / 1000.f, _maxCallbackUsecs / 1000.f, _numCallbackUnderruns, _numInputOverruns);
+    
     delete[] _echoSamplesLeft;
 }
 
 void Audio::addReceivedAudioToBuffer(unsigned char* receivedData, int receivedBytes) {
+    ReceivedAudioPacket* receivedPacket = _receivedPackets.getFrameToWrite();
+    
+    if (receivedPacket && receivedBytes <= MAX_PACKET_SIZE) {
+        gettimeofday(&receivedPacket->receivedTime, NULL);
+        receivedPacket->numBytes = receivedBytes;
+        memcpy(receivedPacket->data, receivedData, receivedBytes);
+        _receivedPackets.commitWrite();
+    }
+    
+    Application::getInstance()->getBandwidthMeter()->inputStream(BandwidthMeter::AUDIO).updateValue(receivedBytes);
+}
+
+void Audio::parseReceivedAudio(unsigned char* receivedData, int receivedBytes, timeval& currentReceiveTime) {
     const int NUM_INITIAL_PACKETS_DISCARD = 3;
     const int STANDARD_DEVIATION_SAMPLE_COUNT = 500;
     
-    timeval currentReceiveTime;
-    gettimeofday(&currentReceiveTime, NULL);
     _totalPacketsReceived++;
     
     double timeDiff = diffclock(&_lastReceiveTime, &currentReceiveTime);
@@ -465,7 +604,7 @@ void Audio::addReceivedAudioToBuffer(unsigned char* receivedData, int receivedBy
     }
     
     if (_packetsReceivedThisPlayback == 1) {
-        gettimeofday(&_firstPacketReceivedTime, NULL);
+        _firstPacketReceivedTime = currentReceiveTime;
     }
     
     if (_ringBuffer.diffLastWriteNextOutput() + PACKET_LENGTH_SAMPLES >
@@ -483,9 +622,6 @@ void Audio::addReceivedAudioToBuffer(unsigned char* receivedData, int receivedBy
     //printf("Got audio packet %d\n", _packetsReceivedThisPlayback);
     
     _ringBuffer.parseData((unsigned char*) receivedData, receivedBytes);
-   
-    Application::getInstance()->getBandwidthMeter()->inputStream(BandwidthMeter::AUDIO)
-            .updateValue(PACKET_LENGTH_BYTES + sizeof(PACKET_TYPE));
  
     _lastReceiveTime = currentReceiveTime;
 }
@@ -591,10 +727,36 @@ void Audio::render(int screenWidth, int screenHeight) {
         glVertex2f(startX + jitterBufferPels - 2, bottomY + 2);
         glEnd();
 
+        //  Show how long the audio callback takes and how often it had nothing to play
+        sprintf(out, "cb %.0f/%d us, %d under\n", _averageCallbackUsecs, _maxCallbackUsecs, _numCallbackUnderruns);
+        drawtext(startX, bottomY + 24, 0.10, 0, 1, 0, out, 1, 0, 0);
+
     }
     renderToolIcon(screenHeight);
 }
 
+//
+//  Tracks the noise floor of the microphone and returns true if this frame should be sent as silence.
+//  Keeps the gate open for a few frames after voice activity so that trailing syllables aren't clipped.
+//
+bool Audio::updateSilenceGate(float loudness) {
+    if (loudness < _noiseFloorLoudness) {
+        _noiseFloorLoudness = loudness;
+    } else {
+        _noiseFloorLoudness += (loudness - _noiseFloorLoudness) * SILENCE_GATE_NOISE_FLOOR_RISE;
+    }
+    
+    if (loudness > std::max(SILENCE_GATE_MIN_LOUDNESS, _noiseFloorLoudness * SILENCE_GATE_NOISE_FLOOR_RATIO)) {
+        _silenceGateHangoverFrames = SILENCE_GATE_HANGOVER_FRAMES;
+        return false;
+    } else if (_silenceGateHangoverFrames > 0) {
+        _silenceGateHangoverFrames--;
+        return false;
+    }
+    
+    return true;
+}
+
 //
 //  Very Simple LowPass filter which works by averaging a bunch of samples with a moving window
 //
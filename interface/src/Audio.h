@@ -19,6 +19,9 @@
 #include <portaudio.h>
 
 #include <AudioRingBuffer.h>
+#include <GenericThread.h>
+#include <LockFreeFrameQueue.h>
+#include <NodeList.h>
 #include <StdDev.h>
 
 #include "Oscilloscope.h"
@@ -32,7 +35,9 @@ static const int PACKET_LENGTH_BYTES_PER_CHANNEL = PACKET_LENGTH_BYTES / 2;
 static const int PACKET_LENGTH_SAMPLES = PACKET_LENGTH_BYTES / sizeof(int16_t);
 static const int PACKET_LENGTH_SAMPLES_PER_CHANNEL = PACKET_LENGTH_SAMPLES / 2;
 
-class Audio : public QObject {
+/// Client audio I/O. The PortAudio callback only copies frames to and from lock free queues, the network send, the
+/// parsing of received audio and all the effects run on a worker thread that processes one frame per captured frame.
+class Audio : public QObject, public GenericThread {
     Q_OBJECT
 public:
     // initializes audio I/O
@@ -43,6 +48,7 @@ public:
     void reset(); 
     void render(int screenWidth, int screenHeight);
     
+    /// queues audio from the mixer to be parsed on the audio worker thread
     void addReceivedAudioToBuffer(unsigned char* receivedData, int receivedBytes);
 
     float getLastInputLoudness() const { return _lastInputLoudness; }
@@ -68,8 +74,22 @@ public:
     // in which case 'true' is returned - otherwise the return value is 'false'.
     // The results of the analysis are written to the log.
     bool eventuallyAnalyzePing();
+
+    float getAverageCallbackUsecs() const { return _averageCallbackUsecs; }
+    int getMaxCallbackUsecs() const { return _maxCallbackUsecs; }
+    int getNumCallbackUnderruns() const { return _numCallbackUnderruns; }
+    int getNumInputOverruns() const { return _numInputOverruns; }
+
+    /// audio worker thread, processes each frame captured by the callback
+    virtual bool process();
 private:
-    
+    /// a packet from the audio mixer waiting to be parsed by the worker, with the time it was received
+    struct ReceivedAudioPacket {
+        timeval receivedTime;
+        int numBytes;
+        unsigned char data[MAX_PACKET_SIZE];
+    };
+
     PaStream* _stream;
     AudioRingBuffer _ringBuffer;
     Oscilloscope* _scope;
@@ -104,22 +124,48 @@ private:
     float _collisionSoundDuration;
     int _proceduralEffectSample;
     float _heartbeatMagnitude;
+    float _noiseFloorLoudness;
+    int _silenceGateHangoverFrames;
 
     bool _muted;
     GLuint _micTextureId;
     GLuint _muteTextureId;
     QRect _iconBounds;
+
+    // Handoff between the real-time callback, the worker and the network receive thread.
+    LockFreeFrameQueue<int16_t> _inputFrames;
+    LockFreeFrameQueue<int16_t> _outputFrames;
+    LockFreeFrameQueue<ReceivedAudioPacket> _receivedPackets;
+    volatile bool _isResetPending;
+    // The worker waits on _hasInputFrame for the callback's next frame instead of polling.
+    pthread_mutex_t _workerMutex;
+    pthread_cond_t _hasInputFrame;
+    bool _isStoppingWorker;
+    // Callback instrumentation, only written by the callback
+    float _averageCallbackUsecs;
+    int _maxCallbackUsecs;
+    int _numCallbackUnderruns;
+    int _numInputOverruns;
     
-    // Audio callback in class context.
+    // Audio callback in class context, moves one frame in and one frame out.
     inline void performIO(int16_t* inputLeft, int16_t* outputLeft, int16_t* outputRight);
 
+    // Processes one microphone frame on the worker and renders the matching output frame.
+    void processAudioFrame(int16_t* inputLeft, int16_t* outputLeft, int16_t* outputRight);
+
+    // Parses a packet from the audio mixer into the ring buffer. Called from the worker.
+    void parseReceivedAudio(unsigned char* receivedData, int receivedBytes, timeval& receivedTime);
+
     // When requested, sends/receives a signal for round trip time determination.
-    // Called from 'performIO'.
+    // Called from 'processAudioFrame'.
     inline void eventuallySendRecvPing(int16_t* inputLeft, int16_t* outputLeft, int16_t* outputRight);
 
     // Determines round trip time of the audio system. Called from 'eventuallyAnalyzePing'.
     inline void analyzePing();
 
+    // Updates the noise floor estimate with the loudness of this frame, returns true if the frame is silent
+    bool updateSilenceGate(float loudness);
+
     // Add sounds that we want the user to not hear themselves, by adding on top of mic input signal
     void addProceduralSounds(int16_t* inputBuffer, int16_t* outputLeft, int16_t* outputRight, int numSamples);
 
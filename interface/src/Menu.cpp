@@ -53,7 +53,9 @@ Menu::Menu() :
     _viewFrustumOffset(DEFAULT_FRUSTUM_OFFSET),
     _voxelModeActionsGroup(NULL),
     _voxelStatsDialog(NULL),
-    _maxVoxels(DEFAULT_MAX_VOXELS_PER_SYSTEM)
+    _maxVoxels(DEFAULT_MAX_VOXELS_PER_SYSTEM),
+    _maxFaceVideoKbps(0),
+    _voxelLODQuality(DEFAULT_LOD_SCALE)
 {
     Application *appInstance = Application::getInstance();
     
@@ -495,6 +497,8 @@ Menu::Menu() :
                                            appInstance->getAvatar(),
                                            SLOT(setWantOcclusionCulling(bool)));
 
+    addCheckableActionToQMenuAndActionHash(voxelProtoOptionsMenu, MenuOption::ProgressiveVoxelSending, 0, true);
+
     addCheckableActionToQMenuAndActionHash(voxelProtoOptionsMenu, MenuOption::DestructiveAddVoxel);
     
 #ifndef Q_OS_MAC
@@ -518,6 +522,8 @@ void Menu::loadSettings(QSettings* settings) {
     _audioJitterBufferSamples = loadSetting(settings, "audioJitterBufferSamples", 0);
     _fieldOfView = loadSetting(settings, "fieldOfView", DEFAULT_FIELD_OF_VIEW_DEGREES);
     _maxVoxels = loadSetting(settings, "maxVoxels", DEFAULT_MAX_VOXELS_PER_SYSTEM);
+    _maxFaceVideoKbps = loadSetting(settings, "maxFaceVideoKbps", 0);
+    _voxelLODQuality = loadSetting(settings, "voxelLODQuality", DEFAULT_LOD_SCALE);
     
     settings->beginGroup("View Frustum Offset Camera");
     // in case settings is corrupt or missing loadSetting() will check for NaN
@@ -544,6 +550,8 @@ void Menu::saveSettings(QSettings* settings) {
     settings->setValue("audioJitterBufferSamples", _audioJitterBufferSamples);
     settings->setValue("fieldOfView", _fieldOfView);
     settings->setValue("maxVoxels", _maxVoxels);
+    settings->setValue("maxFaceVideoKbps", _maxFaceVideoKbps);
+    settings->setValue("voxelLODQuality", _voxelLODQuality);
     settings->beginGroup("View Frustum Offset Camera");
     settings->setValue("viewFrustumOffsetYaw", _viewFrustumOffset.yaw);
     settings->setValue("viewFrustumOffsetPitch", _viewFrustumOffset.pitch);
@@ -848,6 +856,24 @@ void Menu::editPreferences() {
     maxVoxels->setValue(_maxVoxels);
     form->addRow("Maximum Voxels:", maxVoxels);
     
+    QSpinBox* maxFaceVideoKbps = new QSpinBox();
+    const int MAX_MAX_FACE_VIDEO_KBPS = 100000;
+    const int STEP_MAX_FACE_VIDEO_KBPS = 100;
+    maxFaceVideoKbps->setMaximum(MAX_MAX_FACE_VIDEO_KBPS);
+    maxFaceVideoKbps->setMinimum(0);
+    maxFaceVideoKbps->setSingleStep(STEP_MAX_FACE_VIDEO_KBPS);
+    maxFaceVideoKbps->setValue(_maxFaceVideoKbps);
+    form->addRow("Maximum Face Video Kbps (0 for no limit):", maxFaceVideoKbps);
+    
+    QDoubleSpinBox* voxelLODQuality = new QDoubleSpinBox();
+    const double STEP_VOXEL_LOD_QUALITY = 0.25;
+    voxelLODQuality->setMaximum(MAX_LOD_QUALITY);
+    voxelLODQuality->setMinimum(MIN_LOD_QUALITY);
+    voxelLODQuality->setSingleStep(STEP_VOXEL_LOD_QUALITY);
+    voxelLODQuality->setDecimals(3);
+    voxelLODQuality->setValue(_voxelLODQuality);
+    form->addRow("Voxel Level of Detail Quality (1 for default):", voxelLODQuality);
+    
     QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
     dialog.connect(buttons, SIGNAL(accepted()), SLOT(accept()));
     dialog.connect(buttons, SIGNAL(rejected()), SLOT(reject()));
@@ -891,6 +917,11 @@ void Menu::editPreferences() {
     _maxVoxels = maxVoxels->value();
     applicationInstance->getVoxels()->setMaxVoxels(_maxVoxels);
     
+    _maxFaceVideoKbps = maxFaceVideoKbps->value();
+    Avatar::sendFaceVideoMaxBitrateMessage(_maxFaceVideoKbps);
+    
+    _voxelLODQuality = voxelLODQuality->value();
+    
     applicationInstance->getAvatar()->setLeanScale(leanScale->value());
     
     _audioJitterBufferSamples = audioJitterBufferSamples->value();
@@ -54,6 +54,8 @@ public:
     ViewFrustumOffset getViewFrustumOffset() const { return _viewFrustumOffset; }
     VoxelStatsDialog* getVoxelStatsDialog() const { return _voxelStatsDialog; }
     int getMaxVoxels() const { return _maxVoxels; }
+    int getMaxFaceVideoKbps() const { return _maxFaceVideoKbps; }
+    float getVoxelLODQuality() const { return _voxelLODQuality; }
     QAction* getUseVoxelShader() const { return _useVoxelShader; }
 
     
@@ -121,6 +123,8 @@ private:
     QActionGroup* _voxelModeActionsGroup;
     VoxelStatsDialog* _voxelStatsDialog;
     int _maxVoxels;
+    int _maxFaceVideoKbps; /// the most face video the avatar mixer should send us, zero for no limit
+    float _voxelLODQuality; /// how much finer than the default level of detail to ask the voxel servers for
     QAction* _useVoxelShader;
 };
 
@@ -194,6 +198,7 @@ namespace MenuOption {
     const QString Oscilloscope = "Audio Oscilloscope";
     const QString Pair = "Pair";
     const QString PasteVoxels = "Paste";
+    const QString ProgressiveVoxelSending = "Progressive Voxel Sending";
     const QString PipelineWarnings = "Show Render Pipeline Warnings";
     const QString Preferences = "Preferences...";
     const QString RandomizeVoxelColors = "Randomize Voxel TRUE Colors";
@@ -19,6 +19,8 @@
 #include <glm/gtc/quaternion.hpp>
 #include <QSettings>
 
+#include <SharedUtil.h>
+
 // the standard sans serif font family
 #define SANS_FONT_FAMILY "Helvetica"
 
@@ -51,8 +53,6 @@ float angleBetween(const glm::vec3& v1, const glm::vec3& v2);
 
 glm::quat rotationBetween(const glm::vec3& v1, const glm::vec3& v2);
 
-glm::vec3 safeEulerAngles(const glm::quat& q);
-
 glm::quat safeMix(const glm::quat& q1, const glm::quat& q2, float alpha);
 
 glm::vec3 extractTranslation(const glm::mat4& matrix);
@@ -55,6 +55,17 @@ void VoxelPacketProcessor::processPacket(sockaddr& senderAddress, unsigned char*
             if (packetData[0] == PACKET_TYPE_ENVIRONMENT_DATA) {
                 app->_environment.parseData(&senderAddress, packetData, messageLength);
             } else {
+                // note the sequence number for the acknowledgement in our next query to this server, only the voxel
+                // data packets have one, the others it relays, like Z commands, don't
+                if (packetData[0] == PACKET_TYPE_VOXEL_DATA || packetData[0] == PACKET_TYPE_VOXEL_DATA_MONOCHROME) {
+                    VOXEL_PACKET_SEQUENCE sequence;
+                    memcpy(&sequence, packetData + numBytesForPacketHeader(packetData), sizeof(sequence));
+                    
+                    app->_voxelPacketAcksMutex.lock();
+                    app->_voxelPacketAcks[voxelServer->getUUID()].packetReceived(sequence);
+                    app->_voxelPacketAcksMutex.unlock();
+                }
+                
                 app->_voxels.setDataSourceUUID(voxelServer->getUUID());
                 app->_voxels.parseData(packetData, messageLength);
                 app->_voxels.setDataSourceUUID(QUuid());
@@ -16,6 +16,7 @@
 #include <iostream> // to load voxels from file
 #include <fstream> // to load voxels from file
 #include <pthread.h>
+#include <vector>
 
 #include <OctalCode.h>
 #include <PacketHeaders.h>
@@ -67,7 +68,8 @@ VoxelSystem::VoxelSystem(float treeScale, int maxVoxels)
     : NodeData(NULL),
       _treeScale(treeScale),
       _maxVoxels(maxVoxels),
-      _initialized(false) {
+      _initialized(false),
+      _lodScale(DEFAULT_LOD_SCALE) {
 
     _voxelsInReadArrays = _voxelsInWriteArrays = _voxelsUpdated = 0;
     _writeRenderFullVBO = true;
@@ -109,6 +111,7 @@ VoxelSystem::VoxelSystem(float treeScale, int maxVoxels)
     _useFastVoxelPipeline = false;
     
     _culledOnce = false;
+    _localVoxelsGeneration = 0;
 }
 
 void VoxelSystem::voxelDeleted(VoxelNode* node) {
@@ -139,7 +142,7 @@ void VoxelSystem::voxelUpdated(VoxelNode* node) {
     if (node->getVoxelSystem() == this) {
         bool shouldRender = false; // assume we don't need to render it
         // if it's colored, we might need to render it!
-        shouldRender = node->calculateShouldRender(_viewFrustum);
+        shouldRender = node->calculateShouldRender(_viewFrustum, NO_BOUNDARY_ADJUST, _lodScale);
 
         if (node->getShouldRender() != shouldRender) {
             node->setShouldRender(shouldRender);
@@ -155,7 +158,7 @@ void VoxelSystem::voxelUpdated(VoxelNode* node) {
                 VoxelNode* childNode = node->getChildAtIndex(i);
                 if (childNode) {
                     bool wasShouldRender = childNode->getShouldRender();
-                    bool isShouldRender = childNode->calculateShouldRender(_viewFrustum);
+                    bool isShouldRender = childNode->calculateShouldRender(_viewFrustum, NO_BOUNDARY_ADJUST, _lodScale);
                     if (wasShouldRender && !isShouldRender) {
                         childrenGotHiddenCount++;
                     }
@@ -578,7 +581,10 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
 
     unsigned char command = *sourceBuffer;
     int numBytesPacketHeader = numBytesForPacketHeader(sourceBuffer);
-    unsigned char* voxelData = sourceBuffer + numBytesPacketHeader;
+    
+    // voxel data has the server's sequence number between the header and the voxels
+    int numBytesBeforeVoxels = numBytesPacketHeader + sizeof(VOXEL_PACKET_SEQUENCE);
+    unsigned char* voxelData = sourceBuffer + numBytesBeforeVoxels;
 
     switch(command) {
         case PACKET_TYPE_VOXEL_DATA: {
@@ -587,7 +593,7 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
             // ask the VoxelTree to read the bitstream into the tree
             ReadBitstreamToTreeParams args(WANT_COLOR, WANT_EXISTS_BITS, NULL, getDataSourceUUID());
             pthread_mutex_lock(&_treeLock);
-            _tree->readBitstreamToTree(voxelData, numBytes - numBytesPacketHeader, args);
+            _tree->readBitstreamToTree(voxelData, numBytes - numBytesBeforeVoxels, args);
             pthread_mutex_unlock(&_treeLock);
         }
             break;
@@ -597,7 +603,7 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
             // ask the VoxelTree to read the MONOCHROME bitstream into the tree
             ReadBitstreamToTreeParams args(NO_COLOR, WANT_EXISTS_BITS, NULL, getDataSourceUUID());
             pthread_mutex_lock(&_treeLock);
-            _tree->readBitstreamToTree(voxelData, numBytes - numBytesPacketHeader, args);
+            _tree->readBitstreamToTree(voxelData, numBytes - numBytesBeforeVoxels, args);
             pthread_mutex_unlock(&_treeLock);
         }
             break;
@@ -923,7 +929,7 @@ int VoxelSystem::newTreeToArrays(VoxelNode* node) {
     int   voxelsUpdated   = 0;
     bool  shouldRender    = false; // assume we don't need to render it
     // if it's colored, we might need to render it!
-    shouldRender = node->calculateShouldRender(_viewFrustum);
+    shouldRender = node->calculateShouldRender(_viewFrustum, NO_BOUNDARY_ADJUST, _lodScale);
 
     node->setShouldRender(shouldRender);
     // let children figure out their renderness
@@ -1378,6 +1384,7 @@ int VoxelSystem::_nodeCount = 0;
 void VoxelSystem::killLocalVoxels() {
     pthread_mutex_lock(&_treeLock);
     _tree->eraseAllVoxels();
+    _localVoxelsGeneration++;
     pthread_mutex_unlock(&_treeLock);
     clearFreeBufferIndexes();    
     _voxelsInReadArrays = 0; // do we need to do this?
@@ -1385,31 +1392,43 @@ void VoxelSystem::killLocalVoxels() {
 }
 
 
-bool VoxelSystem::clearAllNodesBufferIndexOperation(VoxelNode* node, void* extraData) {
+class VoxelSystem::ClearAllNodesBufferIndexOperation : public VoxelTreeOperation {
+public:
+    Result visit(VoxelNode* node);
+};
+
+VoxelTreeOperation::Result VoxelSystem::ClearAllNodesBufferIndexOperation::visit(VoxelNode* node) {
     _nodeCount++;
     node->setBufferIndex(GLBUFFER_INDEX_UNKNOWN);
-    return true;
+    return VISIT_CHILDREN;
 }
 
 void VoxelSystem::clearAllNodesBufferIndex() {
     _nodeCount = 0;
     pthread_mutex_lock(&_treeLock);                                  
-    _tree->recurseTreeWithOperation(clearAllNodesBufferIndexOperation);
+    ClearAllNodesBufferIndexOperation operation;
+    _tree->traverseTree(operation);
     pthread_mutex_unlock(&_treeLock);
     if (Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings)) {
         qDebug("clearing buffer index of %d nodes\n", _nodeCount);
     }
 }
 
-bool VoxelSystem::forceRedrawEntireTreeOperation(VoxelNode* node, void* extraData) {
+class VoxelSystem::ForceRedrawEntireTreeOperation : public VoxelTreeOperation {
+public:
+    Result visit(VoxelNode* node);
+};
+
+VoxelTreeOperation::Result VoxelSystem::ForceRedrawEntireTreeOperation::visit(VoxelNode* node) {
     _nodeCount++;
     node->setDirtyBit();
-    return true;
+    return VISIT_CHILDREN;
 }
 
 void VoxelSystem::forceRedrawEntireTree() {
     _nodeCount = 0;
-    _tree->recurseTreeWithOperation(forceRedrawEntireTreeOperation);
+    ForceRedrawEntireTreeOperation operation;
+    _tree->traverseTree(operation);
     qDebug("forcing redraw of %d nodes\n", _nodeCount);
     _tree->setDirtyBit();
     setupNewVoxelsForDrawing();
@@ -1650,24 +1669,31 @@ void VoxelSystem::cancelImport() {
 
 // "Remove" voxels from the tree that are not in view. We don't actually delete them,
 // we remove them from the tree and place them into a holding area for later deletion
-bool VoxelSystem::removeOutOfViewOperation(VoxelNode* node, void* extraData) {
-    removeOutOfViewArgs* args = (removeOutOfViewArgs*)extraData;
+class VoxelSystem::RemoveOutOfViewOperation : public VoxelTreeOperation {
+public:
+    RemoveOutOfViewOperation(removeOutOfViewArgs* args) : args(args) { }
+    Result visit(VoxelNode* node);
+    removeOutOfViewArgs* args;
+};
 
-    // If our node was previously added to the don't recurse bag, then return false to
+VoxelTreeOperation::Result VoxelSystem::RemoveOutOfViewOperation::visit(VoxelNode* node) {
+    // If our node was previously added to the don't recurse bag, then skip its children to
     // stop the further recursion. This means that the whole node and it's children are
     // known to be in view, so don't recurse them
     if (args->dontRecurseBag.contains(node)) {
         args->dontRecurseBag.remove(node);
-        return false; // stop recursion
+        return SKIP_CHILDREN; // stop recursion
     }
     
     VoxelSystem* thisVoxelSystem = args->thisVoxelSystem;
     args->nodesScanned++;
+    ChildrenLocations childLocations;
+    node->childrenInFrustum(args->thisViewFrustum, childLocations);
     // Need to operate on our child nodes, so we can remove them
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         VoxelNode* childNode = node->getChildAtIndex(i);
         if (childNode) {
-            ViewFrustum::location inFrustum = childNode->inFrustum(args->thisViewFrustum);
+            ViewFrustum::location inFrustum = childLocations.getLocation(i);
             switch (inFrustum) {
                 case ViewFrustum::OUTSIDE: {
                     args->nodesOutside++;
@@ -1693,7 +1719,7 @@ bool VoxelSystem::removeOutOfViewOperation(VoxelNode* node, void* extraData) {
             }
         }
     }
-    return true; // keep going!
+    return VISIT_CHILDREN; // keep going!
 }
 
 bool VoxelSystem::isViewChanging() {
@@ -1726,10 +1752,12 @@ bool VoxelSystem::hasViewChanged() {
 void VoxelSystem::removeOutOfView() {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), "removeOutOfView()");
     removeOutOfViewArgs args(this);
-    _tree->recurseTreeWithOperation(removeOutOfViewOperation,(void*)&args);
+    RemoveOutOfViewOperation operation(&args);
+    _tree->traverseTree(operation);
 
     if (args.nodesRemoved) {
         _tree->setDirtyBit();
+        _localVoxelsGeneration++;
     }
     bool showRemoveDebugDetails = false;
     if (showRemoveDebugDetails) {
@@ -1755,10 +1783,18 @@ public:
     }
 };
 
+class VoxelSystem::ShowAllLocalVoxelsOperation : public VoxelTreeOperation {
+public:
+    ShowAllLocalVoxelsOperation(showAllLocalVoxelsArgs* args) : args(args) { }
+    Result visit(VoxelNode* node);
+    showAllLocalVoxelsArgs* args;
+};
+
 void VoxelSystem::showAllLocalVoxels() {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), "showAllLocalVoxels()");
     showAllLocalVoxelsArgs args(this);
-    _tree->recurseTreeWithOperation(showAllLocalVoxelsOperation,(void*)&args);
+    ShowAllLocalVoxelsOperation operation(&args);
+    _tree->traverseTree(operation);
 
     bool showRemoveDebugDetails = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     if (showRemoveDebugDetails) {
@@ -1766,9 +1802,7 @@ void VoxelSystem::showAllLocalVoxels() {
     }
 }
 
-bool VoxelSystem::showAllLocalVoxelsOperation(VoxelNode* node, void* extraData) {
-    showAllLocalVoxelsArgs* args = (showAllLocalVoxelsArgs*)extraData;
-
+VoxelTreeOperation::Result VoxelSystem::ShowAllLocalVoxelsOperation::visit(VoxelNode* node) {
     args->nodesScanned++;
 
     bool shouldRender = true; // node->calculateShouldRender(&args->thisViewFrustum);
@@ -1784,7 +1818,7 @@ bool VoxelSystem::showAllLocalVoxelsOperation(VoxelNode* node, void* extraData)
         node->markWithChangedTime();
     }
 
-    return true; // keep recursing!
+    return VISIT_CHILDREN; // keep recursing!
 }
 
 
@@ -1837,6 +1871,86 @@ public:
     }
 };
 
+// Each node whose children are visited locates all of them at once, in this frustum and the last one, and the children
+// look up their locations when they're visited. The post order visits drop them when the node's subtree is done.
+class VoxelSystem::HideOutOfViewOperation : public VoxelTreeOperation {
+public:
+    enum { WANTS_POST_ORDER = true };
+
+    HideOutOfViewOperation(hideOutOfViewArgs* args) : args(args), parents() { }
+    Result visit(VoxelNode* node);
+    void postVisit(VoxelNode* node);
+    hideOutOfViewArgs* args;
+
+private:
+    class ParentLocations {
+    public:
+        VoxelNode* parent;
+        VoxelNode* children[NUMBER_OF_CHILDREN];
+        ChildrenLocations childLocations;
+        ChildrenLocations lastChildLocations;
+    };
+
+    void locate(VoxelNode* node, ViewFrustum::location& inFrustum, ViewFrustum::location& inLastCulledFrustum);
+    void locateChildren(VoxelNode* node);
+
+    std::vector<ParentLocations> parents;
+};
+
+void VoxelSystem::HideOutOfViewOperation::locate(VoxelNode* node, ViewFrustum::location& inFrustum,
+                                                 ViewFrustum::location& inLastCulledFrustum) {
+    bool wantLastCulledFrustum = args->culledOnce && args->wantDeltaFrustums;
+    if (parents.empty()) {
+        inFrustum = node->inFrustum(args->thisViewFrustum);
+        if (wantLastCulledFrustum) {
+            inLastCulledFrustum = node->inFrustum(args->lastViewFrustum);
+        }
+        return;
+    }
+    const ParentLocations& parentLocations = parents.back();
+    int childIndex = 0;
+    while (parentLocations.children[childIndex] != node) {
+        childIndex++;
+    }
+    inFrustum = parentLocations.childLocations.getLocation(childIndex);
+    if (wantLastCulledFrustum) {
+        inLastCulledFrustum = parentLocations.lastChildLocations.getLocation(childIndex);
+    }
+}
+
+void VoxelSystem::HideOutOfViewOperation::locateChildren(VoxelNode* node) {
+    parents.push_back(ParentLocations());
+    ParentLocations& parentLocations = parents.back();
+    parentLocations.parent = node;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        parentLocations.children[i] = node->getChildAtIndex(i);
+    }
+    node->childrenInFrustum(args->thisViewFrustum, parentLocations.childLocations);
+    if (args->culledOnce && args->wantDeltaFrustums) {
+        node->childrenInFrustum(args->lastViewFrustum, parentLocations.lastChildLocations);
+    }
+}
+
+void VoxelSystem::HideOutOfViewOperation::postVisit(VoxelNode* node) {
+    if (!parents.empty() && parents.back().parent == node) {
+        parents.pop_back();
+    }
+}
+
+class VoxelSystem::HideAllSubTreeOperation : public VoxelTreeOperation {
+public:
+    HideAllSubTreeOperation(hideOutOfViewArgs* args) : args(args) { }
+    Result visit(VoxelNode* node);
+    hideOutOfViewArgs* args;
+};
+
+class VoxelSystem::ShowAllSubTreeOperation : public VoxelTreeOperation {
+public:
+    ShowAllSubTreeOperation(hideOutOfViewArgs* args) : args(args) { }
+    Result visit(VoxelNode* node);
+    hideOutOfViewArgs* args;
+};
+
 void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
     bool showDebugDetails = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showDebugDetails, "hideOutOfView()", showDebugDetails);
@@ -1872,7 +1986,8 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
         return;
     }
     
-    _tree->recurseTreeWithOperation(hideOutOfViewOperation,(void*)&args);
+    HideOutOfViewOperation operation(&args);
+    _tree->traverseTree(operation);
     _lastCulledViewFrustum = args.thisViewFrustum; // save last stable
     _culledOnce = true;
 
@@ -1892,9 +2007,7 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
     }
 }
 
-bool VoxelSystem::hideAllSubTreeOperation(VoxelNode* node, void* extraData) {
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-
+VoxelTreeOperation::Result VoxelSystem::HideAllSubTreeOperation::visit(VoxelNode* node) {
     // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
     // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
     // consider that case.
@@ -1906,7 +2019,7 @@ bool VoxelSystem::hideAllSubTreeOperation(VoxelNode* node, void* extraData) {
         // if this node is fully OUTSIDE our last culled view frustum, then we don't need to recurse further
         if (inLastCulledFrustum == ViewFrustum::OUTSIDE) {
             args->nodesOutsideOutside++;
-            return false;
+            return SKIP_CHILDREN;
         }
     }
 
@@ -1924,12 +2037,10 @@ bool VoxelSystem::hideAllSubTreeOperation(VoxelNode* node, void* extraData) {
 
     }
     
-    return true;
+    return VISIT_CHILDREN;
 }
 
-bool VoxelSystem::showAllSubTreeOperation(VoxelNode* node, void* extraData) {
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-
+VoxelTreeOperation::Result VoxelSystem::ShowAllSubTreeOperation::visit(VoxelNode* node) {
     // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
     // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
     // consider that case.
@@ -1941,13 +2052,14 @@ bool VoxelSystem::showAllSubTreeOperation(VoxelNode* node, void* extraData) {
         // if this node is fully inside our last culled view frustum, then we don't need to recurse further
         if (inLastCulledFrustum == ViewFrustum::INSIDE) {
             args->nodesInsideInside++;
-            return false;
+            return SKIP_CHILDREN;
         }
     }
 
     args->nodesInside++;
 
-    bool shouldRender = node->calculateShouldRender(&args->thisViewFrustum);
+    bool shouldRender = node->calculateShouldRender(&args->thisViewFrustum, NO_BOUNDARY_ADJUST,
+                                                    args->thisVoxelSystem->getLODScale());
     node->setShouldRender(shouldRender);
 
     if (shouldRender && !node->isKnownBufferIndex()) {
@@ -1960,27 +2072,22 @@ bool VoxelSystem::showAllSubTreeOperation(VoxelNode* node, void* extraData) {
         node->markWithChangedTime();
     }
 
-    return true; // keep recursing!
+    return VISIT_CHILDREN; // keep recursing!
 }
 
 // "hide" voxels in the VBOs that are still in the tree that but not in view. 
 // We don't remove them from the tree, we don't delete them, we do remove them
 // from the VBOs and mark them as such in the tree.
-bool VoxelSystem::hideOutOfViewOperation(VoxelNode* node, void* extraData) {
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-
+VoxelTreeOperation::Result VoxelSystem::HideOutOfViewOperation::visit(VoxelNode* node) {
     // If we're still recursing the tree using this operator, then we don't know if we're inside or outside... 
     // so before we move forward we need to determine our frustum location
-    ViewFrustum::location inFrustum = node->inFrustum(args->thisViewFrustum);
-    
+    //
     // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
     // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
     // consider that case.
+    ViewFrustum::location inFrustum;
     ViewFrustum::location inLastCulledFrustum;
-    
-    if (args->culledOnce && args->wantDeltaFrustums) {
-        inLastCulledFrustum = node->inFrustum(args->lastViewFrustum);
-    }
+    locate(node, inFrustum, inLastCulledFrustum);
         
     // ok, now do some processing for this node...
     switch (inFrustum) {
@@ -1992,15 +2099,16 @@ bool VoxelSystem::hideOutOfViewOperation(VoxelNode* node, void* extraData) {
             if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::OUTSIDE) {
                 args->nodesScanned++;
                 args->nodesOutsideOutside++;
-                return false; // stop recursing this branch!
+                return SKIP_CHILDREN; // stop recursing this branch!
             }
             
             // if this node is fully OUTSIDE the view, but previously intersected and/or was inside the last view, then
             // we need to hide it. Additionally we know that ALL of it's children are also fully OUTSIDE so we can recurse 
             // the children and simply mark them as hidden
-            args->tree->recurseNodeWithOperation(node, hideAllSubTreeOperation, args );
+            HideAllSubTreeOperation hideAllSubTree(args);
+            traverseVoxelNode(node, hideAllSubTree);
             
-            return false;
+            return SKIP_CHILDREN;
             
         } break;
         case ViewFrustum::INSIDE: {
@@ -2011,15 +2119,16 @@ bool VoxelSystem::hideOutOfViewOperation(VoxelNode* node, void* extraData) {
             if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::INSIDE) {
                 args->nodesScanned++;
                 args->nodesInsideInside++;
-                return false; // stop recursing this branch!
+                return SKIP_CHILDREN; // stop recursing this branch!
             }
         
             // if this node is fully INSIDE the view, but previously INTERSECTED and/or was OUTSIDE the last view, then
             // we need to show it. Additionally we know that ALL of it's children are also fully INSIDE so we can recurse 
             // the children and simply mark them as visible (as appropriate based on LOD)
-            args->tree->recurseNodeWithOperation(node, showAllSubTreeOperation, args);
+            ShowAllSubTreeOperation showAllSubTree(args);
+            traverseVoxelNode(node, showAllSubTree);
 
-            return false;    
+            return SKIP_CHILDREN;    
         } break;
         case ViewFrustum::INTERSECT: {
             args->nodesScanned++;
@@ -2029,7 +2138,7 @@ bool VoxelSystem::hideOutOfViewOperation(VoxelNode* node, void* extraData) {
             // previously INSIDE and visible. So in this case stop recursing
             if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::INSIDE) {
                 args->nodesIntersectInside++;
-                return false; // stop recursing this branch!
+                return SKIP_CHILDREN; // stop recursing this branch!
             }
 
             args->nodesIntersect++;
@@ -2039,19 +2148,21 @@ bool VoxelSystem::hideOutOfViewOperation(VoxelNode* node, void* extraData) {
             // here because we know will block any children anyway
             if (node->getShouldRender() && !node->isKnownBufferIndex()) {
                 node->setDirtyBit(); // will this make it draw?
-                return false;
+                return SKIP_CHILDREN;
             }
 
             // If it INTERSECTS but shouldn't be displayed, then it's probably a parent and it is at least partially in view.
             // So we DO want to recurse the children because some of them may not be in view... nothing specifically to do, 
             // just keep iterating the children
-            return true;            
+            locateChildren(node);
+            return VISIT_CHILDREN;            
 
         } break;
     } // switch
     
 
-    return true; // keep going!
+    locateChildren(node);
+    return VISIT_CHILDREN; // keep going!
 }
 
 
@@ -2576,8 +2687,14 @@ void VoxelSystem::nodeAdded(Node* node) {
     }
 }
 
-bool VoxelSystem::killSourceVoxelsOperation(VoxelNode* node, void* extraData) {
-    QUuid killedNodeID = *(QUuid*)extraData;
+class VoxelSystem::KillSourceVoxelsOperation : public VoxelTreeOperation {
+public:
+    KillSourceVoxelsOperation(const QUuid& killedNodeID) : killedNodeID(killedNodeID) { }
+    Result visit(VoxelNode* node);
+    QUuid killedNodeID;
+};
+
+VoxelTreeOperation::Result VoxelSystem::KillSourceVoxelsOperation::visit(VoxelNode* node) {
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         VoxelNode* childNode = node->getChildAtIndex(i);
         if (childNode) {
@@ -2586,7 +2703,7 @@ bool VoxelSystem::killSourceVoxelsOperation(VoxelNode* node, void* extraData) {
             }
         }
     }
-    return true;
+    return VISIT_CHILDREN;
 }
 
 void VoxelSystem::nodeKilled(Node* node) {
@@ -2601,7 +2718,9 @@ void VoxelSystem::nodeKilled(Node* node) {
             // Kill any voxels from the local tree that match this nodeID
             // commenting out for removal of 16 bit node IDs
             pthread_mutex_lock(&_treeLock);
-            _tree->recurseTreeWithOperation(killSourceVoxelsOperation, &nodeUUID);
+            KillSourceVoxelsOperation operation(nodeUUID);
+            _tree->traverseTree(operation);
+            _localVoxelsGeneration++;
             pthread_mutex_unlock(&_treeLock);
             _tree->setDirtyBit();
             setupNewVoxelsForDrawing();
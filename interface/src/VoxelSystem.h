@@ -57,6 +57,10 @@ public:
     VoxelTree* getTree() const { return _tree; }
     ViewFrustum* getViewFrustum() const { return _viewFrustum; }
     void setViewFrustum(ViewFrustum* viewFrustum) { _viewFrustum = viewFrustum; }
+
+    /// scales the distances voxels of each level are drawn within, to match the detail the servers are asked for
+    float getLODScale() const { return _lodScale; }
+    void setLODScale(float lodScale) { _lodScale = lodScale; }
     unsigned long  getVoxelsUpdated() const { return _voxelsUpdated; }
     unsigned long  getVoxelsRendered() const { return _voxelsInReadArrays; }
     unsigned long  getVoxelsWritten() const { return _voxelsInWriteArrays; }
@@ -83,6 +87,9 @@ public:
     float getVoxelsBytesReadPerSecondAverage();
 
     void killLocalVoxels();
+    
+    /// bumped each time voxels the servers sent are dropped, the servers then stop assuming we still have them
+    uint16_t getLocalVoxelsGeneration() const { return _localVoxelsGeneration; }
 
     virtual void removeOutOfView();
     virtual void hideOutOfView(bool forceFullFrustum = false);
@@ -182,20 +189,22 @@ private:
     static bool falseColorizeInViewOperation(VoxelNode* node, void* extraData);
     static bool falseColorizeDistanceFromViewOperation(VoxelNode* node, void* extraData);
     static bool getDistanceFromViewRangeOperation(VoxelNode* node, void* extraData);
-    static bool removeOutOfViewOperation(VoxelNode* node, void* extraData);
     static bool falseColorizeRandomEveryOtherOperation(VoxelNode* node, void* extraData);
     static bool collectStatsForTreesAndVBOsOperation(VoxelNode* node, void* extraData);
     static bool falseColorizeOccludedOperation(VoxelNode* node, void* extraData);
     static bool falseColorizeSubTreeOperation(VoxelNode* node, void* extraData);
     static bool falseColorizeOccludedV2Operation(VoxelNode* node, void* extraData);
     static bool falseColorizeBySourceOperation(VoxelNode* node, void* extraData);
-    static bool killSourceVoxelsOperation(VoxelNode* node, void* extraData);
-    static bool forceRedrawEntireTreeOperation(VoxelNode* node, void* extraData);
-    static bool clearAllNodesBufferIndexOperation(VoxelNode* node, void* extraData);
-    static bool hideOutOfViewOperation(VoxelNode* node, void* extraData);
-    static bool hideAllSubTreeOperation(VoxelNode* node, void* extraData);
-    static bool showAllSubTreeOperation(VoxelNode* node, void* extraData);
-    static bool showAllLocalVoxelsOperation(VoxelNode* node, void* extraData);
+
+    // Operations for VoxelTree::traverseTree(), for the passes made while rendering
+    class KillSourceVoxelsOperation;
+    class ForceRedrawEntireTreeOperation;
+    class ClearAllNodesBufferIndexOperation;
+    class RemoveOutOfViewOperation;
+    class HideOutOfViewOperation;
+    class HideAllSubTreeOperation;
+    class ShowAllSubTreeOperation;
+    class ShowAllLocalVoxelsOperation;
 
     int updateNodeInArrays(VoxelNode* node, bool reuseIndex, bool forceDraw);
     int forceRemoveNodeFromArrays(VoxelNode* node);
@@ -232,6 +241,7 @@ private:
     uint64_t _lastAudit;
     int _lastViewCullingElapsed;
     bool _hasRecentlyChanged;
+    uint16_t _localVoxelsGeneration;
     
     void initVoxelMemory();
     void cleanupVoxelMemory();
@@ -261,6 +271,7 @@ private:
     ViewFrustum _lastKnownViewFrustum;
     ViewFrustum _lastStableViewFrustum;
     ViewFrustum* _viewFrustum;
+    float _lodScale;
 
     ViewFrustum _lastCulledViewFrustum; // used for hide/show visible passes
     bool _culledOnce;
@@ -15,6 +15,7 @@
 #include <NodeTypes.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
+#include <UUID.h>
 
 #include "Application.h"
 #include "Avatar.h"
@@ -75,6 +76,22 @@ void Avatar::sendAvatarURLsMessage(const QUrl& voxelURL) {
     Application::controlledBroadcastToNodes((unsigned char*)message.data(), message.size(), &NODE_TYPE_AVATAR_MIXER, 1);
 }
 
+void Avatar::sendFaceVideoMaxBitrateMessage(int maxKbps) {
+    unsigned char packet[MAX_PACKET_HEADER_BYTES + NUM_BYTES_RFC4122_UUID + sizeof(uint32_t)];
+    unsigned char* packetPosition = packet;
+    
+    packetPosition += populateTypeAndVersion(packetPosition, PACKET_TYPE_AVATAR_FACE_VIDEO_MAX_BITRATE);
+    
+    QByteArray rfcUUID = NodeList::getInstance()->getOwnerUUID().toRfc4122();
+    memcpy(packetPosition, rfcUUID.constData(), rfcUUID.size());
+    packetPosition += rfcUUID.size();
+    
+    *(uint32_t*)packetPosition = maxKbps;
+    packetPosition += sizeof(uint32_t);
+    
+    Application::controlledBroadcastToNodes(packet, packetPosition - packet, &NODE_TYPE_AVATAR_MIXER, 1);
+}
+
 Avatar::Avatar(Node* owningNode) :
     AvatarData(owningNode),
     _head(this),
@@ -132,6 +132,9 @@ class Avatar : public AvatarData {
 public:
     static void sendAvatarURLsMessage(const QUrl& voxelURL);
     
+    /// tells the avatar mixer the most face video to send us, zero for no limit
+    static void sendFaceVideoMaxBitrateMessage(int maxKbps);
+    
     Avatar(Node* owningNode = NULL);
     ~Avatar();
     
@@ -85,6 +85,9 @@ int VideoFace::processVideoMessage(unsigned char* packetData, size_t dataBytes)
     int frameOffset = *(uint32_t*)packetPosition;
     packetPosition += sizeof(uint32_t);
     
+    // the flags are only for the avatar mixer
+    packetPosition += sizeof(unsigned char);
+    
     if (frameCount < _frameCount) { // old frame; ignore
         return dataBytes; 
     
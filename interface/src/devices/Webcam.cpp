@@ -535,7 +535,7 @@ void FrameGrabber::shutdown() {
 
     // send an empty video message to indicate that we're no longer sending
     QMetaObject::invokeMethod(Application::getInstance(), "sendAvatarFaceVideoMessage",
-            Q_ARG(int, ++_frameCount), Q_ARG(QByteArray, QByteArray()));
+            Q_ARG(int, ++_frameCount), Q_ARG(QByteArray, QByteArray()), Q_ARG(bool, true));
 
     thread()->quit();
 }
@@ -754,7 +754,14 @@ void FrameGrabber::grabFrame() {
     // increment the frame count that identifies frames
     _frameCount++;
     
-    QByteArray payload;    
+    QByteArray payload;
+    
+    // force key frames at a steady rate so that the avatar mixer can thin the video for distant receivers by only
+    // forwarding those, the frame is only flagged as a key frame if every codec that encoded it made one
+    const int FACE_VIDEO_KEY_FRAME_INTERVAL = 15;
+    vpx_enc_frame_flags_t encodeFlags = (_frameCount % FACE_VIDEO_KEY_FRAME_INTERVAL == 0) ? VPX_EFLAG_FORCE_KF : 0;
+    bool isKeyFrame = true;
+    
     if (!_ledTrackingOn && _videoSendMode != NO_VIDEO) {
         // start the payload off with the aspect ratio (zero for full frame)
         payload.append((const char*)&aspectRatio, sizeof(float));
@@ -838,7 +845,7 @@ void FrameGrabber::grabFrame() {
             }
 
             // encode the frame
-            vpx_codec_encode(&_colorCodec, &vpxImage, _frameCount, 1, 0, VPX_DL_REALTIME);
+            vpx_codec_encode(&_colorCodec, &vpxImage, _frameCount, 1, encodeFlags, VPX_DL_REALTIME);
 
             // extract the encoded frame
             vpx_codec_iter_t iterator = 0;
@@ -848,6 +855,7 @@ void FrameGrabber::grabFrame() {
                     // prepend the length, which will indicate whether there's a depth frame too
                     payload.append((const char*)&packet->data.frame.sz, sizeof(packet->data.frame.sz));
                     payload.append((const char*)packet->data.frame.buf, packet->data.frame.sz);
+                    isKeyFrame = isKeyFrame && (packet->data.frame.flags & VPX_FRAME_IS_KEY);
                 }
             }
         } else {
@@ -910,7 +918,7 @@ void FrameGrabber::grabFrame() {
             }
 
             // encode the frame
-            vpx_codec_encode(&_depthCodec, &vpxImage, _frameCount, 1, 0, VPX_DL_REALTIME);
+            vpx_codec_encode(&_depthCodec, &vpxImage, _frameCount, 1, encodeFlags, VPX_DL_REALTIME);
 
             // extract the encoded frame
             vpx_codec_iter_t iterator = 0;
@@ -918,13 +926,14 @@ void FrameGrabber::grabFrame() {
             while ((packet = vpx_codec_get_cx_data(&_depthCodec, &iterator)) != 0) {
                 if (packet->kind == VPX_CODEC_CX_FRAME_PKT) {
                     payload.append((const char*)packet->data.frame.buf, packet->data.frame.sz);
+                    isKeyFrame = isKeyFrame && (packet->data.frame.flags & VPX_FRAME_IS_KEY);
                 }
             }
         }
     }
 
     QMetaObject::invokeMethod(Application::getInstance(), "sendAvatarFaceVideoMessage",
-            Q_ARG(int, _frameCount), Q_ARG(QByteArray, payload));
+            Q_ARG(int, _frameCount), Q_ARG(QByteArray, payload), Q_ARG(bool, isKeyFrame));
 
     QMetaObject::invokeMethod(Application::getInstance()->getWebcam(), "setFrame",
         Q_ARG(cv::Mat, color), Q_ARG(int, format), Q_ARG(cv::Mat, _grayDepthFrame), Q_ARG(float, _smoothedMidFaceDepth),
@@ -19,17 +19,44 @@
 UDPSocket* AudioInjectionManager::_injectorSocket = NULL;
 sockaddr AudioInjectionManager::_destinationSocket;
 bool AudioInjectionManager::_isDestinationSocketExplicit = false;
-AudioInjector* AudioInjectionManager::_injectors[50] = {};
+AudioInjector* AudioInjectionManager::_injectors[MAX_CONCURRENT_INJECTORS] = {};
+bool AudioInjectionManager::_isPooledInjectorInUse[MAX_CONCURRENT_INJECTORS] = {};
+AudioInjectionManager::ScheduledInjection AudioInjectionManager::_scheduledInjections[MAX_CONCURRENT_INJECTORS];
+bool AudioInjectionManager::_isScheduledInjectionInUse[MAX_CONCURRENT_INJECTORS] = {};
+int AudioInjectionManager::_numScheduledInjections = 0;
+uint64_t AudioInjectionManager::_currentTick = 0;
+bool AudioInjectionManager::_isSchedulerRunning = false;
+pthread_t AudioInjectionManager::_schedulerThread;
+pthread_mutex_t AudioInjectionManager::_schedulerMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t AudioInjectionManager::_hasScheduledInjections = PTHREAD_COND_INITIALIZER;
 
 AudioInjector* AudioInjectionManager::injectorWithCapacity(int capacity) {
-    for (int i = 0; i < MAX_CONCURRENT_INJECTORS; i++) {
-        if (!_injectors[i]) {
+    pthread_mutex_lock(&_schedulerMutex);
+
+    AudioInjector* injector = NULL;
+
+    // prefer handing out a finished injector from the pool that is big enough for this injection
+    for (int i = 0; i < MAX_CONCURRENT_INJECTORS && !injector; i++) {
+        if (_injectors[i] && !_isPooledInjectorInUse[i] && _injectors[i]->getSampleCapacity() >= capacity) {
+            _injectors[i]->prepareForReuse(capacity);
+            _isPooledInjectorInUse[i] = true;
+            injector = _injectors[i];
+        }
+    }
+
+    // otherwise fill an empty spot in the pool, or replace a finished injector that was too small
+    for (int i = 0; i < MAX_CONCURRENT_INJECTORS && !injector; i++) {
+        if (!_injectors[i] || !_isPooledInjectorInUse[i]) {
+            delete _injectors[i];
             _injectors[i] = new AudioInjector(capacity);
-            return _injectors[i];
+            _isPooledInjectorInUse[i] = true;
+            injector = _injectors[i];
         }
     }
-    
-    return NULL;
+
+    pthread_mutex_unlock(&_schedulerMutex);
+
+    return injector;
 }
 
 void AudioInjectionManager::setDestinationSocket(sockaddr& destinationSocket) {
@@ -37,41 +64,133 @@ void AudioInjectionManager::setDestinationSocket(sockaddr& destinationSocket) {
     _isDestinationSocketExplicit = true;
 }
 
-void* AudioInjectionManager::injectAudioViaThread(void* args) {
-    AudioInjector* injector = (AudioInjector*) args;
-    
+void AudioInjectionManager::threadInjector(AudioInjector* injector) {
+    pthread_mutex_lock(&_schedulerMutex);
+
+    if (!_isSchedulerRunning) {
+        pthread_create(&_schedulerThread, NULL, runScheduler, NULL);
+        _isSchedulerRunning = true;
+    }
+
+    int injectionIndex = -1;
+
+    for (int i = 0; i < MAX_CONCURRENT_INJECTORS; i++) {
+        if (!_isScheduledInjectionInUse[i]) {
+            injectionIndex = i;
+            break;
+        }
+    }
+
+    if (injectionIndex == -1) {
+        qDebug("AudioInjectionManager has %d injections in progress, dropping this one.\n", MAX_CONCURRENT_INJECTORS);
+    } else {
+        ScheduledInjection& injection = _scheduledInjections[injectionIndex];
+        _isScheduledInjectionInUse[injectionIndex] = true;
+
+        // start on the next tick so that all injections stay aligned to the same frame boundaries
+        injection.injector = injector;
+        injection.nextSampleIndex = 0;
+        injection.numLeadingBytes = injector->populateLeadingBytes(injection.packet);
+
+        injector->setIsInjectingAudio(true);
+
+        if (_numScheduledInjections++ == 0) {
+            pthread_cond_signal(&_hasScheduledInjections);
+        }
+    }
+
+    pthread_mutex_unlock(&_schedulerMutex);
+}
+
+void* AudioInjectionManager::runScheduler(void* args) {
+    uint64_t startTime = usecTimestampNow();
+
+    pthread_mutex_lock(&_schedulerMutex);
+
+    while (true) {
+        if (_numScheduledInjections == 0) {
+            // nothing to send, sleep until something is scheduled rather than waking up every frame
+            pthread_cond_wait(&_hasScheduledInjections, &_schedulerMutex);
+            startTime = usecTimestampNow() - (_currentTick * INJECT_INTERVAL_USECS);
+        }
+
+        sendInjectionFrames();
+        _currentTick++;
+
+        pthread_mutex_unlock(&_schedulerMutex);
+
+        int usecToSleep = startTime + (_currentTick * INJECT_INTERVAL_USECS) - usecTimestampNow();
+        if (usecToSleep > 0) {
+            usleep(usecToSleep);
+        }
+
+        pthread_mutex_lock(&_schedulerMutex);
+    }
+
+    return NULL;
+}
+
+void AudioInjectionManager::sendInjectionFrames() {
     // if we don't have an injectorSocket then grab the one from the node list
     if (!_injectorSocket) {
         _injectorSocket = NodeList::getInstance()->getNodeSocket();
     }
-    
+
     // if we don't have an explicit destination socket then pull active socket for current audio mixer from node list
-    if (!_isDestinationSocketExplicit) {
+    sockaddr* destinationSocket = NULL;
+
+    if (_isDestinationSocketExplicit) {
+        destinationSocket = &_destinationSocket;
+    } else {
         Node* audioMixer = NodeList::getInstance()->soloNodeOfType(NODE_TYPE_AUDIO_MIXER);
         if (audioMixer && audioMixer->getActiveSocket()) {
-            _destinationSocket = *audioMixer->getActiveSocket();
-        } else {
-            pthread_exit(0);
+            destinationSocket = audioMixer->getActiveSocket();
         }
     }
-    
-    injector->injectAudio(_injectorSocket, &_destinationSocket);
-    
-    // if this an injector inside the injection manager's array we're responsible for deletion
+
+    int dueInjections[MAX_CONCURRENT_INJECTORS];
+    int numDueInjections = 0;
+
+    // every injection in progress sends a frame each tick, fill them all before sending any
     for (int i = 0; i < MAX_CONCURRENT_INJECTORS; i++) {
-        if (_injectors[i] == injector) {
-            // pointer matched - delete this injector
-            delete injector;
-            
-            // set the pointer to NULL so we can reuse this spot
-            _injectors[i] = NULL;
+        if (_isScheduledInjectionInUse[i]) {
+            ScheduledInjection& injection = _scheduledInjections[i];
+            injection.injector->populateFrameSamples(injection.packet + injection.numLeadingBytes,
+                                                     injection.nextSampleIndex);
+            dueInjections[numDueInjections++] = i;
+        }
+    }
+
+    // send this tick's frames back to back
+    if (destinationSocket) {
+        for (int i = 0; i < numDueInjections; i++) {
+            ScheduledInjection& injection = _scheduledInjections[dueInjections[i]];
+            _injectorSocket->send(destinationSocket, injection.packet,
+                                  injection.numLeadingBytes + BUFFER_LENGTH_BYTES_PER_CHANNEL);
+        }
+    }
+
+    for (int i = 0; i < numDueInjections; i++) {
+        ScheduledInjection& injection = _scheduledInjections[dueInjections[i]];
+        injection.nextSampleIndex += BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+        if (injection.nextSampleIndex >= injection.injector->getNumTotalSamples()) {
+            finishInjection(dueInjections[i]);
         }
     }
-    
-    pthread_exit(0);
 }
 
-void AudioInjectionManager::threadInjector(AudioInjector* injector) {
-    pthread_t audioInjectThread;
-    pthread_create(&audioInjectThread, NULL, injectAudioViaThread, (void*) injector);
-}
\ No newline at end of file
+void AudioInjectionManager::finishInjection(int injectionIndex) {
+    AudioInjector* injector = _scheduledInjections[injectionIndex].injector;
+    injector->setIsInjectingAudio(false);
+
+    // if this an injector from the injection manager's pool it can now be handed out again
+    for (int i = 0; i < MAX_CONCURRENT_INJECTORS; i++) {
+        if (_injectors[i] == injector) {
+            _isPooledInjectorInUse[i] = false;
+        }
+    }
+
+    _isScheduledInjectionInUse[injectionIndex] = false;
+    _numScheduledInjections--;
+}
@@ -10,27 +10,56 @@
 #define __hifi__AudioInjectionManager__
 
 #include <iostream>
+#include <pthread.h>
 
 #include "UDPSocket.h"
 #include "AudioInjector.h"
 
 const int MAX_CONCURRENT_INJECTORS = 50;
 
+/// Hands out pooled injectors and sends the frames of every active injection from one scheduler thread, which wakes
+/// once per frame interval and sends all the frames due on that tick as a batch.
 class AudioInjectionManager {
 public:
     static AudioInjector* injectorWithCapacity(int capacity);
-    
+
+    /// schedules the injector to start sending on the next tick of the scheduler thread
     static void threadInjector(AudioInjector* injector);
-    
+
     static void setInjectorSocket(UDPSocket* injectorSocket) { _injectorSocket = injectorSocket;}
     static void setDestinationSocket(sockaddr& destinationSocket);
 private:
-    static void* injectAudioViaThread(void* args);
-    
+    /// an injection in progress, with a packet buffer whose leading bytes are filled once when it is scheduled
+    struct ScheduledInjection {
+        AudioInjector* injector;
+        int nextSampleIndex;
+        int numLeadingBytes;
+        unsigned char packet[MAX_INJECT_AUDIO_PACKET_BYTES];
+    };
+
+    static void* runScheduler(void* args);
+
+    /// sends the next frame of every injection in progress, finishing the ones that have no frames left
+    static void sendInjectionFrames();
+
+    static void finishInjection(int injectionIndex);
+
     static UDPSocket* _injectorSocket;
     static sockaddr _destinationSocket;
     static bool _isDestinationSocketExplicit;
+
     static AudioInjector* _injectors[MAX_CONCURRENT_INJECTORS];
+    static bool _isPooledInjectorInUse[MAX_CONCURRENT_INJECTORS];
+
+    static ScheduledInjection _scheduledInjections[MAX_CONCURRENT_INJECTORS];
+    static bool _isScheduledInjectionInUse[MAX_CONCURRENT_INJECTORS];
+    static int _numScheduledInjections;
+    static uint64_t _currentTick;
+
+    static bool _isSchedulerRunning;
+    static pthread_t _schedulerThread;
+    static pthread_mutex_t _schedulerMutex;
+    static pthread_cond_t _hasScheduledInjections;
 };
 
 #endif /* defined(__hifi__AudioInjectionManager__) */
@@ -19,6 +19,7 @@
 
 AudioInjector::AudioInjector(int maxNumSamples) :
     _streamIdentifier(QUuid::createUuid()),
+    _sampleCapacity(maxNumSamples),
     _numTotalSamples(maxNumSamples),
     _position(0.0f, 0.0f, 0.0f),
     _orientation(),
@@ -41,40 +42,8 @@ void AudioInjector::injectAudio(UDPSocket* injectorSocket, sockaddr* destination
         
         timeval startTime;
         
-        // calculate the number of bytes required for additional data
-        int leadingBytes = numBytesForPacketHeader((unsigned char*) &PACKET_TYPE_INJECT_AUDIO)
-            + NUM_BYTES_RFC4122_UUID
-            + NUM_BYTES_RFC4122_UUID
-            + sizeof(_position)
-            + sizeof(_orientation)
-            + sizeof(_radius)
-            + sizeof(_volume);
-        
-        unsigned char dataPacket[(BUFFER_LENGTH_SAMPLES_PER_CHANNEL * sizeof(int16_t)) + leadingBytes];
-        
-        unsigned char* currentPacketPtr = dataPacket + populateTypeAndVersion(dataPacket, PACKET_TYPE_INJECT_AUDIO);
-        
-        // copy the UUID for the owning node
-        QByteArray rfcUUID = NodeList::getInstance()->getOwnerUUID().toRfc4122();
-        memcpy(currentPacketPtr, rfcUUID.constData(), rfcUUID.size());
-        currentPacketPtr += rfcUUID.size();
-        
-        // copy the stream identifier
-        QByteArray rfcStreamIdentifier = _streamIdentifier.toRfc4122();
-        memcpy(currentPacketPtr, rfcStreamIdentifier.constData(), rfcStreamIdentifier.size());
-        currentPacketPtr += rfcStreamIdentifier.size();
-        
-        memcpy(currentPacketPtr, &_position, sizeof(_position));
-        currentPacketPtr += sizeof(_position);
-        
-        memcpy(currentPacketPtr, &_orientation, sizeof(_orientation));
-        currentPacketPtr += sizeof(_orientation);
-        
-        memcpy(currentPacketPtr, &_radius, sizeof(_radius));
-        currentPacketPtr += sizeof(_radius);
-        
-        *currentPacketPtr = _volume;
-        currentPacketPtr++;        
+        unsigned char dataPacket[MAX_INJECT_AUDIO_PACKET_BYTES];
+        int leadingBytes = populateLeadingBytes(dataPacket);
         
         gettimeofday(&startTime, NULL);
         int nextFrame = 0;
@@ -85,24 +54,71 @@ void AudioInjector::injectAudio(UDPSocket* injectorSocket, sockaddr* destination
                 usleep(usecToSleep);
             }
             
-            int numSamplesToCopy = BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+            populateFrameSamples(dataPacket + leadingBytes, i);
             
-            if (_numTotalSamples - i < BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
-                numSamplesToCopy = _numTotalSamples - i;
-                memset(currentPacketPtr + numSamplesToCopy,
-                       0,
-                       BUFFER_LENGTH_BYTES_PER_CHANNEL - (numSamplesToCopy * sizeof(int16_t)));
-            }
-            
-            memcpy(currentPacketPtr, _audioSampleArray + i, numSamplesToCopy * sizeof(int16_t));
-            
-            injectorSocket->send(destinationSocket, dataPacket, sizeof(dataPacket));
+            injectorSocket->send(destinationSocket, dataPacket, leadingBytes + BUFFER_LENGTH_BYTES_PER_CHANNEL);
         }
         
         _isInjectingAudio = false;
     }
 }
 
+int AudioInjector::populateLeadingBytes(unsigned char* dataPacket) const {
+    unsigned char* currentPacketPtr = dataPacket + populateTypeAndVersion(dataPacket, PACKET_TYPE_INJECT_AUDIO);
+    
+    // copy the UUID for the owning node
+    QByteArray rfcUUID = NodeList::getInstance()->getOwnerUUID().toRfc4122();
+    memcpy(currentPacketPtr, rfcUUID.constData(), rfcUUID.size());
+    currentPacketPtr += rfcUUID.size();
+    
+    // copy the stream identifier
+    QByteArray rfcStreamIdentifier = _streamIdentifier.toRfc4122();
+    memcpy(currentPacketPtr, rfcStreamIdentifier.constData(), rfcStreamIdentifier.size());
+    currentPacketPtr += rfcStreamIdentifier.size();
+    
+    memcpy(currentPacketPtr, &_position, sizeof(_position));
+    currentPacketPtr += sizeof(_position);
+    
+    memcpy(currentPacketPtr, &_orientation, sizeof(_orientation));
+    currentPacketPtr += sizeof(_orientation);
+    
+    memcpy(currentPacketPtr, &_radius, sizeof(_radius));
+    currentPacketPtr += sizeof(_radius);
+    
+    *currentPacketPtr = _volume;
+    currentPacketPtr++;
+    
+    return currentPacketPtr - dataPacket;
+}
+
+void AudioInjector::populateFrameSamples(unsigned char* destination, int sampleIndex) const {
+    int numSamplesToCopy = BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+    
+    if (_numTotalSamples - sampleIndex < BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
+        numSamplesToCopy = _numTotalSamples - sampleIndex;
+        memset(destination + (numSamplesToCopy * sizeof(int16_t)),
+               0,
+               BUFFER_LENGTH_BYTES_PER_CHANNEL - (numSamplesToCopy * sizeof(int16_t)));
+    }
+    
+    memcpy(destination, _audioSampleArray + sampleIndex, numSamplesToCopy * sizeof(int16_t));
+}
+
+void AudioInjector::prepareForReuse(int maxNumSamples) {
+    assert(maxNumSamples <= _sampleCapacity);
+    
+    // a new stream identifier keeps the mixer from appending this injection to the finished one
+    _streamIdentifier = QUuid::createUuid();
+    _numTotalSamples = maxNumSamples;
+    _position = glm::vec3(0.0f, 0.0f, 0.0f);
+    _orientation = glm::quat();
+    _radius = 0.0f;
+    _volume = MAX_INJECTOR_VOLUME;
+    _isInjectingAudio = false;
+    
+    clear();
+}
+
 void AudioInjector::addSample(const int16_t sample) {
     if (_indexOfNextSlot != _numTotalSamples) {
         // only add this sample if we actually have space for it
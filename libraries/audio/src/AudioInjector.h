@@ -15,8 +15,10 @@
 #include <QtCore/QObject>
 #include <QtCore/QUuid>
 
+#include <PacketHeaders.h>
 #include <RegisteredMetaTypes.h>
 #include <UDPSocket.h>
+#include <UUID.h>
 
 #include "AudioRingBuffer.h"
 
@@ -24,6 +26,14 @@ const int MAX_INJECTOR_VOLUME = 0xFF;
 
 const int INJECT_INTERVAL_USECS = floorf((BUFFER_LENGTH_SAMPLES_PER_CHANNEL / SAMPLE_RATE) * 1000000);
 
+const int MAX_INJECT_AUDIO_PACKET_BYTES = MAX_PACKET_HEADER_BYTES
+    + (NUM_BYTES_RFC4122_UUID * 2)
+    + sizeof(glm::vec3)
+    + sizeof(glm::quat)
+    + sizeof(float)
+    + sizeof(unsigned char)
+    + BUFFER_LENGTH_BYTES_PER_CHANNEL;
+
 class AudioInjector : public QObject {
     Q_OBJECT
     
@@ -35,7 +45,20 @@ public:
 
     void injectAudio(UDPSocket* injectorSocket, sockaddr* destinationSocket);
     
+    /// writes the packet header and the details of this injection that lead every frame, returns the bytes written
+    int populateLeadingBytes(unsigned char* dataPacket) const;
+    
+    /// writes one frame of samples starting at sampleIndex, padding with silence past the end of the injection
+    void populateFrameSamples(unsigned char* destination, int sampleIndex) const;
+    
+    /// readies a finished injector to be handed out again for an injection of up to maxNumSamples
+    void prepareForReuse(int maxNumSamples);
+    
     bool isInjectingAudio() const { return _isInjectingAudio; }
+    void setIsInjectingAudio(bool isInjectingAudio) { _isInjectingAudio = isInjectingAudio; }
+    
+    int getNumTotalSamples() const { return _numTotalSamples; }
+    int getSampleCapacity() const { return _sampleCapacity; }
     
     unsigned char getVolume() const  { return _volume; }
     void setVolume(unsigned char volume) { _volume = volume; }
@@ -61,6 +84,7 @@ public slots:
 private:
     QUuid _streamIdentifier;
     int16_t* _audioSampleArray;
+    int _sampleCapacity;
     int _numTotalSamples;
     glm::vec3 _position;
     glm::quat _orientation;
@@ -22,6 +22,7 @@ AudioRingBuffer::AudioRingBuffer(bool isStereo) :
 {
     _buffer = new int16_t[RING_BUFFER_LENGTH_SAMPLES];
     _nextOutput = _buffer;
+    memset(_silentFrames, 0, sizeof(_silentFrames));
 };
 
 AudioRingBuffer::~AudioRingBuffer() {
@@ -33,42 +34,84 @@ void AudioRingBuffer::reset() {
     _nextOutput = _buffer;
     _isStarved = true;
     _hasStarted = false;
+    memset(_silentFrames, 0, sizeof(_silentFrames));
 }
 
 int AudioRingBuffer::parseData(unsigned char* sourceBuffer, int numBytes) {
     int numBytesPacketHeader = numBytesForPacketHeader(sourceBuffer);
-    return parseAudioSamples(sourceBuffer + numBytesPacketHeader, numBytes - numBytesPacketHeader);
+    
+    if (sourceBuffer[0] == PACKET_TYPE_SILENT_AUDIO_FRAME) {
+        return parseSilentSamples(sourceBuffer + numBytesPacketHeader, numBytes - numBytesPacketHeader);
+    } else {
+        return parseAudioSamples(sourceBuffer + numBytesPacketHeader, numBytes - numBytesPacketHeader);
+    }
 }
 
 int AudioRingBuffer::parseAudioSamples(unsigned char* sourceBuffer, int numBytes) {
     // make sure we have enough bytes left for this to be the right amount of audio
     // otherwise we should not copy that data, and leave the buffer pointers where they are
-    int samplesToCopy = BUFFER_LENGTH_SAMPLES_PER_CHANNEL * (_isStereo ? 2 : 1);
-    
-    if (numBytes == samplesToCopy * sizeof(int16_t)) {
-        
-        if (!_endOfLastWrite) {
-            _endOfLastWrite = _buffer;
-        } else if (diffLastWriteNextOutput() > RING_BUFFER_LENGTH_SAMPLES - samplesToCopy) {
-            _endOfLastWrite = _buffer;
-            _nextOutput = _buffer;
-            _isStarved = true;
-        }
-        
-        memcpy(_endOfLastWrite, sourceBuffer, numBytes);
-        
-        _endOfLastWrite += samplesToCopy;
-        
-        if (_endOfLastWrite >= _buffer + RING_BUFFER_LENGTH_SAMPLES) {
-            _endOfLastWrite = _buffer;
-        }
-        
+    if (numBytes == samplesPerFrame() * sizeof(int16_t)) {
+        writeFrame(sourceBuffer);
         return numBytes;
     } else {
         return 0;
     }    
 }
 
+int AudioRingBuffer::parseSilentSamples(unsigned char* sourceBuffer, int numBytes) {
+    int16_t numSilentSamples = 0;
+    
+    if (numBytes >= (int) sizeof(numSilentSamples)) {
+        memcpy(&numSilentSamples, sourceBuffer, sizeof(numSilentSamples));
+    }
+    
+    // silent frames still take their slot in the ring buffer so that the jitter buffer sees them arrive on time
+    if (numSilentSamples == samplesPerFrame()) {
+        writeFrame(NULL);
+        return sizeof(numSilentSamples);
+    } else {
+        return 0;
+    }
+}
+
+void AudioRingBuffer::writeFrame(const unsigned char* sourceBuffer) {
+    int samplesToCopy = samplesPerFrame();
+    
+    if (!_endOfLastWrite) {
+        _endOfLastWrite = _buffer;
+    } else if (diffLastWriteNextOutput() > RING_BUFFER_LENGTH_SAMPLES - samplesToCopy) {
+        _endOfLastWrite = _buffer;
+        _nextOutput = _buffer;
+        _isStarved = true;
+    }
+    
+    _silentFrames[(_endOfLastWrite - _buffer) / samplesToCopy] = (sourceBuffer == NULL);
+    
+    if (sourceBuffer) {
+        memcpy(_endOfLastWrite, sourceBuffer, samplesToCopy * sizeof(int16_t));
+    } else {
+        memset(_endOfLastWrite, 0, samplesToCopy * sizeof(int16_t));
+    }
+    
+    _endOfLastWrite += samplesToCopy;
+    
+    if (_endOfLastWrite >= _buffer + RING_BUFFER_LENGTH_SAMPLES) {
+        _endOfLastWrite = _buffer;
+    }
+}
+
+bool AudioRingBuffer::isNextOutputSilent() const {
+    if (!_endOfLastWrite) {
+        return false;
+    }
+    
+    int numFrames = RING_BUFFER_LENGTH_SAMPLES / samplesPerFrame();
+    int nextOutputFrame = (_nextOutput - _buffer) / samplesPerFrame();
+    int previousFrame = (nextOutputFrame == 0) ? numFrames - 1 : nextOutputFrame - 1;
+    
+    return _silentFrames[nextOutputFrame] && _silentFrames[previousFrame];
+}
+
 int AudioRingBuffer::diffLastWriteNextOutput() const {
     if (!_endOfLastWrite) {
         return 0;
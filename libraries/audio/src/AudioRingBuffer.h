@@ -34,6 +34,9 @@ public:
 
     int parseData(unsigned char* sourceBuffer, int numBytes);
     int parseAudioSamples(unsigned char* sourceBuffer, int numBytes);
+    
+    /// parses a silent frame marker (the number of silent samples it stands in for) and writes a frame of silence
+    int parseSilentSamples(unsigned char* sourceBuffer, int numBytes);
 
     int16_t* getNextOutput() const { return _nextOutput; }
     void setNextOutput(int16_t* nextOutput) { _nextOutput = nextOutput; }
@@ -52,18 +55,27 @@ public:
     int diffLastWriteNextOutput() const;
     
     bool isStereo() const { return _isStereo; }
+    int samplesPerFrame() const { return BUFFER_LENGTH_SAMPLES_PER_CHANNEL * (_isStereo ? 2 : 1); }
+    
+    /// true if the frame at the next output and the frame before it (which delayed channels read from) were both
+    /// written from silent frame markers, meaning the next output can be skipped instead of mixed
+    bool isNextOutputSilent() const;
     
 protected:
     // disallow copying of AudioRingBuffer objects
     AudioRingBuffer(const AudioRingBuffer&);
     AudioRingBuffer& operator= (const AudioRingBuffer&);
     
+    /// writes one frame at the end of the last write, from sourceBuffer or as silence if sourceBuffer is NULL
+    void writeFrame(const unsigned char* sourceBuffer);
+    
     int16_t* _nextOutput;
     int16_t* _endOfLastWrite;
     int16_t* _buffer;
     bool _isStarved;
     bool _hasStarted;
     bool _isStereo;
+    bool _silentFrames[RING_BUFFER_LENGTH_FRAMES];
 };
 
 #endif /* defined(__interface__AudioRingBuffer__) */
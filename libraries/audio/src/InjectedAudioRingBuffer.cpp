@@ -30,6 +30,8 @@ int InjectedAudioRingBuffer::parseData(unsigned char* sourceBuffer, int numBytes
     // push past the UUID for this node and the stream identifier
     currentBuffer += (NUM_BYTES_RFC4122_UUID * 2);
     
+    updateJitterBufferForArrival();
+    
     // use parsePositionalData in parent PostionalAudioRingBuffer class to pull common positional data
     currentBuffer += parsePositionalData(currentBuffer, numBytes - (currentBuffer - sourceBuffer));
     
@@ -7,19 +7,39 @@
 //
 
 #include <cstring>
+#include <math.h>
 
 #include <Node.h>
 #include <PacketHeaders.h>
+#include <SharedUtil.h>
 #include <UUID.h>
 
 #include "PositionalAudioRingBuffer.h"
 
+const float FRAME_INTERVAL_USECS = (BUFFER_LENGTH_SAMPLES_PER_CHANNEL / SAMPLE_RATE) * 1000000.0f;
+
+// the jitter estimate follows increases quickly and decays slowly, the target depth covers a multiple of it
+const float JITTER_ESTIMATE_ATTACK_RATIO = 0.25f;
+const float JITTER_ESTIMATE_DECAY_RATIO = 1.0f / 64.0f;
+const float JITTER_BUFFER_JITTER_MULTIPLE = 2.0f;
+
+// stretching is spread out so that the change in latency is not audible
+const int MIN_FRAMES_BETWEEN_TIME_STRETCHES = 8;
+const int TIME_STRETCH_OVERLAP_SAMPLES = 64;
+
 PositionalAudioRingBuffer::PositionalAudioRingBuffer(PositionalAudioRingBuffer::Type type) :
     AudioRingBuffer(false),
     _type(type),
     _position(0.0f, 0.0f, 0.0f),
     _orientation(0.0f, 0.0f, 0.0f, 0.0f),
-    _willBeAddedToMix(false)
+    _willBeAddedToMix(false),
+    _lastArrivalUsecs(0),
+    _interarrivalJitterUsecs(0.0f),
+    _jitterBufferSamples(INITIAL_JITTER_BUFFER_SAMPLES),
+    _numFramesSinceTimeStretch(0),
+    _numStarves(0),
+    _numFramesCompressed(0),
+    _numFramesExpanded(0)
 {
     
 }
@@ -30,8 +50,17 @@ PositionalAudioRingBuffer::~PositionalAudioRingBuffer() {
 int PositionalAudioRingBuffer::parseData(unsigned char* sourceBuffer, int numBytes) {
     unsigned char* currentBuffer = sourceBuffer + numBytesForPacketHeader(sourceBuffer);
     currentBuffer += NUM_BYTES_RFC4122_UUID; // the source UUID
+    
+    updateJitterBufferForArrival();
+    
     currentBuffer += parsePositionalData(currentBuffer, numBytes - (currentBuffer - sourceBuffer));
-    currentBuffer += parseAudioSamples(currentBuffer, numBytes - (currentBuffer - sourceBuffer));
+    
+    if (sourceBuffer[0] == PACKET_TYPE_SILENT_MICROPHONE_AUDIO) {
+        // the source sent a silence marker in place of PCM - keep its position but write a silent frame
+        currentBuffer += parseSilentSamples(currentBuffer, numBytes - (currentBuffer - sourceBuffer));
+    } else {
+        currentBuffer += parseAudioSamples(currentBuffer, numBytes - (currentBuffer - sourceBuffer));
+    }
     
     return currentBuffer - sourceBuffer;
 }
@@ -55,22 +84,195 @@ int PositionalAudioRingBuffer::parsePositionalData(unsigned char* sourceBuffer,
     return currentBuffer - sourceBuffer;
 }
 
-bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
+void PositionalAudioRingBuffer::updateJitterBufferForArrival() {
+    uint64_t now = usecTimestampNow();
+    
+    if (_lastArrivalUsecs > 0) {
+        // how far this packet arrived from when it would have on a perfectly regular stream
+        float deviationUsecs = fabsf((now - _lastArrivalUsecs) - FRAME_INTERVAL_USECS);
+        
+        float ratio = deviationUsecs > _interarrivalJitterUsecs
+            ? JITTER_ESTIMATE_ATTACK_RATIO
+            : JITTER_ESTIMATE_DECAY_RATIO;
+        _interarrivalJitterUsecs += (deviationUsecs - _interarrivalJitterUsecs) * ratio;
+        
+        int targetSamples = ceilf(JITTER_BUFFER_JITTER_MULTIPLE * _interarrivalJitterUsecs * SAMPLE_RATE / 1000000.0f);
+        _jitterBufferSamples = std::min(targetSamples, MAX_JITTER_BUFFER_SAMPLES);
+    }
+    
+    _lastArrivalUsecs = now;
+}
+
+bool PositionalAudioRingBuffer::shouldBeAddedToMix() {
     if (_endOfLastWrite) {
-        if (_isStarved && diffLastWriteNextOutput() <= BUFFER_LENGTH_SAMPLES_PER_CHANNEL + numJitterBufferSamples) {
-            printf("Buffer held back\n");
+        if (_isStarved && diffLastWriteNextOutput() <= BUFFER_LENGTH_SAMPLES_PER_CHANNEL + _jitterBufferSamples) {
+            // held back, every frame while the stream is idle, so only the starve below is logged
             return false;
         } else if (diffLastWriteNextOutput() < BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
             printf("Buffer starved.\n");
             _isStarved = true;
+            _numStarves++;
             return false;
         } else {
+            if (_isStarved) {
+                // the frames behind the next output are not ones we just played, don't stretch with them yet
+                _numFramesSinceTimeStretch = 0;
+            }
+            
             // good buffer, add this to the mix
             _isStarved = false;
             _hasStarted = true;
+            
+            // move the depth beyond the frame about to be played towards the target, one frame at a time
+            int depthSamples = diffLastWriteNextOutput() - BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+            
+            if (++_numFramesSinceTimeStretch >= MIN_FRAMES_BETWEEN_TIME_STRETCHES) {
+                if (depthSamples - BUFFER_LENGTH_SAMPLES_PER_CHANNEL >= _jitterBufferSamples) {
+                    compressNextOutput();
+                } else if (depthSamples + BUFFER_LENGTH_SAMPLES_PER_CHANNEL <= _jitterBufferSamples
+                           && diffLastWriteNextOutput() <= RING_BUFFER_LENGTH_SAMPLES - 3 * BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
+                    expandNextOutput();
+                }
+            }
+            
             return true;
         }
     }
     
     return false;
 }
+
+int16_t* PositionalAudioRingBuffer::frameAtOffset(int16_t* frame, int numFrames) const {
+    int16_t* offsetFrame = frame + (numFrames * BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    
+    if (offsetFrame >= _buffer + RING_BUFFER_LENGTH_SAMPLES) {
+        offsetFrame -= RING_BUFFER_LENGTH_SAMPLES;
+    } else if (offsetFrame < _buffer) {
+        offsetFrame += RING_BUFFER_LENGTH_SAMPLES;
+    }
+    
+    return offsetFrame;
+}
+
+// returns the point in the first half of twoFrames at which the waveform is most similar to the waveform one frame later,
+// the best place to splice out (or repeat) one frame of samples
+static int bestSplicePoint(const int16_t* twoFrames) {
+    int bestSplicePoint = 0;
+    float bestSimilarity = -1.0f;
+    
+    for (int p = 0; p <= BUFFER_LENGTH_SAMPLES_PER_CHANNEL - TIME_STRETCH_OVERLAP_SAMPLES; p++) {
+        const int16_t* first = twoFrames + p;
+        const int16_t* second = first + BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+        
+        float crossCorrelation = 0.0f;
+        float firstEnergy = 0.0f;
+        float secondEnergy = 0.0f;
+        
+        for (int s = 0; s < TIME_STRETCH_OVERLAP_SAMPLES; s++) {
+            crossCorrelation += (float) first[s] * second[s];
+            firstEnergy += (float) first[s] * first[s];
+            secondEnergy += (float) second[s] * second[s];
+        }
+        
+        float similarity = (firstEnergy > 0.0f && secondEnergy > 0.0f)
+            ? crossCorrelation / sqrtf(firstEnergy * secondEnergy)
+            : 0.0f;
+        
+        if (similarity > bestSimilarity) {
+            bestSimilarity = similarity;
+            bestSplicePoint = p;
+        }
+    }
+    
+    return bestSplicePoint;
+}
+
+// cross fades from source to target over the overlap, weighted by the sample position within the overlap
+static int16_t crossFadeSample(int16_t source, int16_t target, int overlapIndex) {
+    float targetWeight = (overlapIndex + 0.5f) / TIME_STRETCH_OVERLAP_SAMPLES;
+    return (int16_t) ((1.0f - targetWeight) * source + targetWeight * target);
+}
+
+void PositionalAudioRingBuffer::compressNextOutput() {
+    const int N = BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+    
+    int16_t* previousFrame = frameAtOffset(_nextOutput, -1);
+    int16_t* nextFrame = _nextOutput;
+    int16_t* followingFrame = frameAtOffset(_nextOutput, 1);
+    
+    int16_t twoFrames[N * 2];
+    memcpy(twoFrames, nextFrame, N * sizeof(int16_t));
+    memcpy(twoFrames + N, followingFrame, N * sizeof(int16_t));
+    
+    // keep the start of the next frame and the end of the following one, splicing out the frame in between
+    int splicePoint = bestSplicePoint(twoFrames);
+    
+    for (int s = 0; s < N; s++) {
+        if (s < splicePoint) {
+            followingFrame[s] = twoFrames[s];
+        } else if (s < splicePoint + TIME_STRETCH_OVERLAP_SAMPLES) {
+            followingFrame[s] = crossFadeSample(twoFrames[s], twoFrames[s + N], s - splicePoint);
+        } else {
+            followingFrame[s] = twoFrames[s + N];
+        }
+    }
+    
+    // the skipped frame becomes the one the delayed channel reads from, so give it what was actually played last
+    int nextFrameIndex = (nextFrame - _buffer) / N;
+    int followingFrameIndex = (followingFrame - _buffer) / N;
+    
+    memcpy(nextFrame, previousFrame, N * sizeof(int16_t));
+    _silentFrames[followingFrameIndex] = _silentFrames[nextFrameIndex] && _silentFrames[followingFrameIndex];
+    _silentFrames[nextFrameIndex] = _silentFrames[(previousFrame - _buffer) / N];
+    
+    _nextOutput = followingFrame;
+    
+    _numFramesSinceTimeStretch = 0;
+    _numFramesCompressed++;
+}
+
+void PositionalAudioRingBuffer::expandNextOutput() {
+    const int N = BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+    
+    int16_t* earlierFrame = frameAtOffset(_nextOutput, -2);
+    int16_t* previousFrame = frameAtOffset(_nextOutput, -1);
+    int16_t* nextFrame = _nextOutput;
+    
+    int16_t twoFrames[N * 2];
+    memcpy(twoFrames, previousFrame, N * sizeof(int16_t));
+    memcpy(twoFrames + N, nextFrame, N * sizeof(int16_t));
+    
+    // play the start of the next frame, then jump back one frame to where the played frame is most similar
+    // and play through to the end of the next frame again - two frames of output that end where the next frame does
+    int splicePoint = bestSplicePoint(twoFrames);
+    
+    int16_t expandedFrames[N * 2];
+    
+    for (int s = 0; s < N * 2; s++) {
+        if (s < splicePoint) {
+            expandedFrames[s] = twoFrames[s + N];
+        } else if (s < splicePoint + TIME_STRETCH_OVERLAP_SAMPLES) {
+            expandedFrames[s] = crossFadeSample(twoFrames[s + N], twoFrames[s], s - splicePoint);
+        } else {
+            expandedFrames[s] = twoFrames[s];
+        }
+    }
+    
+    int earlierFrameIndex = (earlierFrame - _buffer) / N;
+    int previousFrameIndex = (previousFrame - _buffer) / N;
+    int nextFrameIndex = (nextFrame - _buffer) / N;
+    bool isExpandedSilent = _silentFrames[previousFrameIndex] && _silentFrames[nextFrameIndex];
+    
+    // the frame before the expansion is the one the delayed channel reads from, so give it what was actually played last
+    memcpy(earlierFrame, previousFrame, N * sizeof(int16_t));
+    _silentFrames[earlierFrameIndex] = _silentFrames[previousFrameIndex];
+    
+    memcpy(previousFrame, expandedFrames, N * sizeof(int16_t));
+    memcpy(nextFrame, expandedFrames + N, N * sizeof(int16_t));
+    _silentFrames[previousFrameIndex] = _silentFrames[nextFrameIndex] = isExpandedSilent;
+    
+    _nextOutput = previousFrame;
+    
+    _numFramesSinceTimeStretch = 0;
+    _numFramesExpanded++;
+}
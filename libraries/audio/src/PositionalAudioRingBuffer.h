@@ -14,6 +14,9 @@
 
 #include "AudioRingBuffer.h"
 
+const int INITIAL_JITTER_BUFFER_SAMPLES = 12 * (SAMPLE_RATE / 1000.0);
+const int MAX_JITTER_BUFFER_SAMPLES = RING_BUFFER_LENGTH_SAMPLES / 2;
+
 class PositionalAudioRingBuffer : public AudioRingBuffer {
 public:
     enum Type {
@@ -28,7 +31,8 @@ public:
     int parsePositionalData(unsigned char* sourceBuffer, int numBytes);
     int parseListenModeData(unsigned char* sourceBuffer, int numBytes);
     
-    bool shouldBeAddedToMix(int numJitterBufferSamples);
+    /// checks the buffer against its own jitter buffer target, time stretching the next output towards the target
+    bool shouldBeAddedToMix();
     
     bool willBeAddedToMix() const { return _willBeAddedToMix; }
     void setWillBeAddedToMix(bool willBeAddedToMix) { _willBeAddedToMix = willBeAddedToMix; }
@@ -37,15 +41,40 @@ public:
     const glm::vec3& getPosition() const { return _position; }
     const glm::quat& getOrientation() const { return _orientation; }
     
+    int getJitterBufferSamples() const { return _jitterBufferSamples; }
+    float getInterarrivalJitterUsecs() const { return _interarrivalJitterUsecs; }
+    int getNumStarves() const { return _numStarves; }
+    int getNumFramesCompressed() const { return _numFramesCompressed; }
+    int getNumFramesExpanded() const { return _numFramesExpanded; }
+    
 protected:
     // disallow copying of PositionalAudioRingBuffer objects
     PositionalAudioRingBuffer(const PositionalAudioRingBuffer&);
     PositionalAudioRingBuffer& operator= (const PositionalAudioRingBuffer&);
     
+    /// updates the arrival jitter estimate and the jitter buffer target with a packet that just arrived
+    void updateJitterBufferForArrival();
+    
+    /// plays the next two frames in the time of one, splicing where the waveforms are most similar
+    void compressNextOutput();
+    
+    /// plays the next frame in the time of two by repeating the frame before it, spliced where most similar
+    void expandNextOutput();
+    
+    int16_t* frameAtOffset(int16_t* frame, int numFrames) const;
+    
     PositionalAudioRingBuffer::Type _type;
     glm::vec3 _position;
     glm::quat _orientation;
     bool _willBeAddedToMix;
+    
+    uint64_t _lastArrivalUsecs;
+    float _interarrivalJitterUsecs;
+    int _jitterBufferSamples;
+    int _numFramesSinceTimeStretch;
+    int _numStarves;
+    int _numFramesCompressed;
+    int _numFramesExpanded;
 };
 
 #endif /* defined(__hifi__PositionalAudioRingBuffer__) */
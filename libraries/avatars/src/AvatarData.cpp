@@ -22,6 +22,10 @@ using namespace std;
 
 static const float fingerVectorRadix = 4; // bits of precision when converting from float<->fixed
 
+// bits of precision for the fixed point values in the compact format
+static const int COMPACT_POSITION_RADIX = 8;
+static const int COMPACT_OFFSET_RADIX = 12;
+
 AvatarData::AvatarData(Node* owningNode) :
     NodeData(owningNode),
     _uuid(),
@@ -158,6 +162,208 @@ int AvatarData::getBroadcastData(unsigned char* destinationBuffer) {
     return destinationBuffer - bufferStart;
 }
 
+int AvatarData::packCompactField(AvatarDataField field, unsigned char* destinationBuffer) {
+    unsigned char* bufferStart = destinationBuffer;
+    
+    // lazily allocate memory for HeadData in case we're not an Avatar instance
+    if (!_headData) {
+        _headData = new HeadData(this);
+    }
+    // lazily allocate memory for HandData in case we're not an Avatar instance
+    if (!_handData) {
+        _handData = new HandData(this);
+    }
+    
+    switch (field) {
+        case AVATAR_FIELD_IDENTITY:
+            memcpy(destinationBuffer, _uuid.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+            destinationBuffer += NUM_BYTES_RFC4122_UUID;
+            memcpy(destinationBuffer, _leaderUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+            destinationBuffer += NUM_BYTES_RFC4122_UUID;
+            break;
+        case AVATAR_FIELD_POSITION:
+            destinationBuffer += packFloatVec3ToSignedThreeByteFixed(destinationBuffer, _position, COMPACT_POSITION_RADIX);
+            break;
+        case AVATAR_FIELD_BODY:
+            destinationBuffer += packOrientationQuatToSmallestThree(destinationBuffer,
+                glm::quat(glm::radians(glm::vec3(_bodyPitch, _bodyYaw, _bodyRoll))));
+            destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _newScale);
+            break;
+        case AVATAR_FIELD_HEAD:
+            destinationBuffer += packOrientationQuatToSmallestThree(destinationBuffer,
+                glm::quat(glm::radians(glm::vec3(_headData->_pitch, _headData->_yaw, _headData->_roll))));
+            destinationBuffer += packFloatScalarToSignedTwoByteFixed(destinationBuffer, _headData->_leanSideways,
+                                                                     COMPACT_OFFSET_RADIX);
+            destinationBuffer += packFloatScalarToSignedTwoByteFixed(destinationBuffer, _headData->_leanForward,
+                                                                     COMPACT_OFFSET_RADIX);
+            break;
+        case AVATAR_FIELD_HAND_POSITION:
+            destinationBuffer += packFloatVec3ToSignedTwoByteFixed(destinationBuffer, _handPosition - _position,
+                                                                   COMPACT_OFFSET_RADIX);
+            break;
+        case AVATAR_FIELD_LOOK_AT:
+            destinationBuffer += packFloatVec3ToSignedThreeByteFixed(destinationBuffer, _headData->_lookAtPosition,
+                                                                     COMPACT_POSITION_RADIX);
+            break;
+        case AVATAR_FIELD_LOUDNESS:
+            destinationBuffer += packFloatToByte(destinationBuffer,
+                glm::clamp(_headData->_audioLoudness, 0.0f, MAX_AUDIO_LOUDNESS), MAX_AUDIO_LOUDNESS);
+            break;
+        case AVATAR_FIELD_CHAT:
+            *destinationBuffer++ = _chatMessage.size();
+            memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
+            destinationBuffer += _chatMessage.size() * sizeof(char);
+            break;
+        case AVATAR_FIELD_STATE: {
+            unsigned char bitItems = 0;
+            setSemiNibbleAt(bitItems, KEY_STATE_START_BIT, _keyState);
+            setSemiNibbleAt(bitItems, HAND_STATE_START_BIT, _handState);
+            if (_headData->_isFaceshiftConnected) {
+                setAtBit(bitItems, IS_FACESHIFT_CONNECTED);
+            }
+            *destinationBuffer++ = bitItems;
+            destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
+            break;
+        }
+        case AVATAR_FIELD_FACESHIFT:
+            // carries its own connected flag so it can be parsed without the state field
+            *destinationBuffer++ = _headData->_isFaceshiftConnected;
+            if (_headData->_isFaceshiftConnected) {
+                destinationBuffer += packFloatToByte(destinationBuffer, glm::clamp(_headData->_leftEyeBlink, 0.0f, 1.0f), 1.0f);
+                destinationBuffer += packFloatToByte(destinationBuffer, glm::clamp(_headData->_rightEyeBlink, 0.0f, 1.0f), 1.0f);
+                memcpy(destinationBuffer, &_headData->_averageLoudness, sizeof(float));
+                destinationBuffer += sizeof(float);
+                memcpy(destinationBuffer, &_headData->_browAudioLift, sizeof(float));
+                destinationBuffer += sizeof(float);
+                
+                *destinationBuffer++ = _headData->_blendshapeCoefficients.size();
+                for (int i = 0; i < _headData->_blendshapeCoefficients.size(); i++) {
+                    destinationBuffer += packFloatToByte(destinationBuffer,
+                        glm::clamp(_headData->_blendshapeCoefficients[i], 0.0f, 1.0f), 1.0f);
+                }
+            }
+            break;
+        case AVATAR_FIELD_HAND_DATA:
+            destinationBuffer += _handData->encodeRemoteData(destinationBuffer);
+            break;
+        case AVATAR_FIELD_JOINTS:
+            *destinationBuffer++ = (unsigned char)_joints.size();
+            for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
+                *destinationBuffer++ = (unsigned char)it->jointID;
+                destinationBuffer += packOrientationQuatToSmallestThree(destinationBuffer, it->rotation);
+            }
+            break;
+        default:
+            break;
+    }
+    
+    return destinationBuffer - bufferStart;
+}
+
+int AvatarData::parseCompactFields(unsigned char* sourceBuffer, int numBytes) {
+    unsigned char* startPosition = sourceBuffer;
+    
+    AvatarFieldMask fieldMask;
+    memcpy(&fieldMask, sourceBuffer, sizeof(fieldMask));
+    sourceBuffer += sizeof(fieldMask);
+    
+    if (fieldMask & (1 << AVATAR_FIELD_IDENTITY)) {
+        _uuid = QUuid::fromRfc4122(QByteArray((char*) sourceBuffer, NUM_BYTES_RFC4122_UUID));
+        sourceBuffer += NUM_BYTES_RFC4122_UUID;
+        _leaderUUID = QUuid::fromRfc4122(QByteArray((char*) sourceBuffer, NUM_BYTES_RFC4122_UUID));
+        sourceBuffer += NUM_BYTES_RFC4122_UUID;
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_POSITION)) {
+        // hand position is sent relative to the body, keep it there if only the body moved
+        glm::vec3 handPositionRelative = _handPosition - _position;
+        sourceBuffer += unpackFloatVec3FromSignedThreeByteFixed(sourceBuffer, _position, COMPACT_POSITION_RADIX);
+        _handPosition = _position + handPositionRelative;
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_BODY)) {
+        glm::quat bodyOrientation;
+        sourceBuffer += unpackOrientationQuatFromSmallestThree(sourceBuffer, bodyOrientation);
+        glm::vec3 bodyEulerAngles = safeEulerAngles(bodyOrientation);
+        _bodyPitch = bodyEulerAngles.x;
+        _bodyYaw = bodyEulerAngles.y;
+        _bodyRoll = bodyEulerAngles.z;
+        sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer, _newScale);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_HEAD)) {
+        glm::quat headOrientation;
+        sourceBuffer += unpackOrientationQuatFromSmallestThree(sourceBuffer, headOrientation);
+        glm::vec3 headEulerAngles = safeEulerAngles(headOrientation);
+        _headData->setPitch(headEulerAngles.x);
+        _headData->setYaw(headEulerAngles.y);
+        _headData->setRoll(headEulerAngles.z);
+        sourceBuffer += unpackFloatScalarFromSignedTwoByteFixed((int16_t*) sourceBuffer, &_headData->_leanSideways,
+                                                                COMPACT_OFFSET_RADIX);
+        sourceBuffer += unpackFloatScalarFromSignedTwoByteFixed((int16_t*) sourceBuffer, &_headData->_leanForward,
+                                                                COMPACT_OFFSET_RADIX);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_HAND_POSITION)) {
+        glm::vec3 handPositionRelative;
+        sourceBuffer += unpackFloatVec3FromSignedTwoByteFixed(sourceBuffer, handPositionRelative, COMPACT_OFFSET_RADIX);
+        _handPosition = _position + handPositionRelative;
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_LOOK_AT)) {
+        sourceBuffer += unpackFloatVec3FromSignedThreeByteFixed(sourceBuffer, _headData->_lookAtPosition,
+                                                                COMPACT_POSITION_RADIX);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_LOUDNESS)) {
+        sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_audioLoudness, MAX_AUDIO_LOUDNESS);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_CHAT)) {
+        int chatMessageSize = *sourceBuffer++;
+        _chatMessage = string((char*)sourceBuffer, chatMessageSize);
+        sourceBuffer += chatMessageSize * sizeof(char);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_STATE)) {
+        unsigned char bitItems = *sourceBuffer++;
+        _keyState = (KeyState)getSemiNibbleAt(bitItems, KEY_STATE_START_BIT);
+        _handState = getSemiNibbleAt(bitItems, HAND_STATE_START_BIT);
+        sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_pupilDilation, 1.0f);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_FACESHIFT)) {
+        _headData->_isFaceshiftConnected = *sourceBuffer++;
+        if (_headData->_isFaceshiftConnected) {
+            sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_leftEyeBlink, 1.0f);
+            sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_rightEyeBlink, 1.0f);
+            memcpy(&_headData->_averageLoudness, sourceBuffer, sizeof(float));
+            sourceBuffer += sizeof(float);
+            memcpy(&_headData->_browAudioLift, sourceBuffer, sizeof(float));
+            sourceBuffer += sizeof(float);
+            
+            _headData->_blendshapeCoefficients.resize(*sourceBuffer++);
+            for (int i = 0; i < _headData->_blendshapeCoefficients.size(); i++) {
+                sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_blendshapeCoefficients[i], 1.0f);
+            }
+        }
+    }
+    
+    if ((fieldMask & (1 << AVATAR_FIELD_HAND_DATA)) && sourceBuffer - startPosition < numBytes) {
+        sourceBuffer += _handData->decodeRemoteData(sourceBuffer);
+    }
+    
+    if (fieldMask & (1 << AVATAR_FIELD_JOINTS) && sourceBuffer - startPosition < numBytes) {
+        _joints.resize(*sourceBuffer++);
+        for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
+            it->jointID = *sourceBuffer++;
+            sourceBuffer += unpackOrientationQuatFromSmallestThree(sourceBuffer, it->rotation);
+        }
+    }
+    
+    return sourceBuffer - startPosition;
+}
+
 // called on the other nodes - assigns it to my views of the others
 int AvatarData::parseData(unsigned char* sourceBuffer, int numBytes) {
 
@@ -171,6 +377,8 @@ int AvatarData::parseData(unsigned char* sourceBuffer, int numBytes) {
         _handData = new HandData(this);
     }
     
+    PACKET_TYPE packetType = sourceBuffer[0];
+    
     // increment to push past the packet header
     int numBytesPacketHeader = numBytesForPacketHeader(sourceBuffer);
     sourceBuffer += numBytesPacketHeader;
@@ -180,6 +388,12 @@ int AvatarData::parseData(unsigned char* sourceBuffer, int numBytes) {
     // push past the node session UUID
     sourceBuffer += NUM_BYTES_RFC4122_UUID;
     
+    // records from the avatar mixer are in the compact format
+    if (packetType == PACKET_TYPE_BULK_AVATAR_DATA) {
+        sourceBuffer += parseCompactFields(sourceBuffer, numBytes - (sourceBuffer - startPosition));
+        return sourceBuffer - startPosition;
+    }
+    
     // user UUID
     _uuid = QUuid::fromRfc4122(QByteArray((char*) sourceBuffer, NUM_BYTES_RFC4122_UUID));
     sourceBuffer += NUM_BYTES_RFC4122_UUID;
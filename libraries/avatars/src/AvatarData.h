@@ -33,6 +33,30 @@ const int IS_FACESHIFT_CONNECTED = 4; // 5th bit
 
 const float MAX_AUDIO_LOUDNESS = 1000.0; // close enough for mouth animation
 
+// face video fragments carry a frame count, frame size and fragment offset, then these flags
+const unsigned char FACE_VIDEO_KEY_FRAME_FLAG = 1; // the frame can be decoded without any of the frames before it
+
+// The fields of the compact record the avatar mixer sends, preceded by a mask of the fields present in the record.
+// The mixer only sends the fields that have changed since the last update of that avatar the receiver acknowledged.
+enum AvatarDataField {
+    AVATAR_FIELD_IDENTITY = 0,
+    AVATAR_FIELD_POSITION,
+    AVATAR_FIELD_BODY,
+    AVATAR_FIELD_HEAD,
+    AVATAR_FIELD_HAND_POSITION,
+    AVATAR_FIELD_LOOK_AT,
+    AVATAR_FIELD_LOUDNESS,
+    AVATAR_FIELD_CHAT,
+    AVATAR_FIELD_STATE,
+    AVATAR_FIELD_FACESHIFT,
+    AVATAR_FIELD_HAND_DATA,
+    AVATAR_FIELD_JOINTS,
+    NUM_AVATAR_FIELDS
+};
+
+typedef uint16_t AvatarFieldMask;
+const AvatarFieldMask ALL_AVATAR_FIELDS = (1 << NUM_AVATAR_FIELDS) - 1;
+
 enum KeyState
 {
     NO_KEY_DOWN = 0,
@@ -62,8 +86,16 @@ public:
     void setHandPosition(const glm::vec3 handPosition) { _handPosition = handPosition; }
     
     int getBroadcastData(unsigned char* destinationBuffer);
+    
+    /// parses a head data packet, or a record from a bulk avatar data packet in the compact format
     int parseData(unsigned char* sourceBuffer, int numBytes);
     
+    /// packs one field of the compact format, returns the number of bytes written
+    int packCompactField(AvatarDataField field, unsigned char* destinationBuffer);
+    
+    /// parses a field mask followed by the compact fields it lists, returns the number of bytes read
+    int parseCompactFields(unsigned char* sourceBuffer, int numBytes);
+    
     QUuid& getUUID() { return _uuid; }
     void setUUID(const QUuid& uuid) { _uuid = uuid; }
     
@@ -0,0 +1,99 @@
+//
+//  LockFreeFrameQueue.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+
+#ifndef __hifi__LockFreeFrameQueue__
+#define __hifi__LockFreeFrameQueue__
+
+#include <cstring>
+
+/// A fixed size ring of frames, each frameLength elements long, handed from exactly one producer thread to exactly one
+/// consumer thread without locking. Neither side ever blocks or allocates, so it is safe to use from a real-time thread.
+///
+/// The producer fills the frame returned by getFrameToWrite() and then calls commitWrite(), the consumer reads the frame
+/// returned by getFrameToRead() and then calls commitRead().
+template <typename T>
+class LockFreeFrameQueue {
+public:
+    LockFreeFrameQueue(int frameLength, int maxFrames) :
+        _frameLength(frameLength),
+        _numSlots(maxFrames + 1),
+        _frames(new T[frameLength * (maxFrames + 1)]),
+        _readIndex(0),
+        _writeIndex(0) {};
+
+    ~LockFreeFrameQueue() { delete[] _frames; }
+
+    /// the frame the producer should fill next, or NULL if the queue is full
+    T* getFrameToWrite() {
+        int nextWriteIndex = (_writeIndex + 1) % _numSlots;
+        return nextWriteIndex == _readIndex ? NULL : _frames + (_writeIndex * _frameLength);
+    }
+
+    /// publishes the frame returned by getFrameToWrite() to the consumer
+    void commitWrite() {
+        // the frame contents must be visible before the consumer can see the new write index
+        __sync_synchronize();
+        _writeIndex = (_writeIndex + 1) % _numSlots;
+    }
+
+    /// copies a frame in, returns false and drops it if the queue is full
+    bool write(const T* frame) {
+        T* destination = getFrameToWrite();
+        if (!destination) {
+            return false;
+        }
+
+        memcpy(destination, frame, _frameLength * sizeof(T));
+        commitWrite();
+        return true;
+    }
+
+    /// the oldest frame the producer has committed, or NULL if the queue is empty
+    T* getFrameToRead() {
+        if (_readIndex == _writeIndex) {
+            return NULL;
+        }
+
+        // don't let reads of the frame contents get ahead of the check on the write index
+        __sync_synchronize();
+        return _frames + (_readIndex * _frameLength);
+    }
+
+    /// hands the frame returned by getFrameToRead() back to the producer
+    void commitRead() {
+        // finish reading the frame before the producer is allowed to overwrite it
+        __sync_synchronize();
+        _readIndex = (_readIndex + 1) % _numSlots;
+    }
+
+    /// copies the oldest frame out, returns false if the queue is empty
+    bool read(T* frame) {
+        T* source = getFrameToRead();
+        if (!source) {
+            return false;
+        }
+
+        memcpy(frame, source, _frameLength * sizeof(T));
+        commitRead();
+        return true;
+    }
+
+    int getFrameLength() const { return _frameLength; }
+    int getNumFramesAvailable() const { return (_writeIndex - _readIndex + _numSlots) % _numSlots; }
+private:
+    // not copyable, the frames are owned by this queue
+    LockFreeFrameQueue(const LockFreeFrameQueue&);
+    LockFreeFrameQueue& operator=(const LockFreeFrameQueue&);
+
+    int _frameLength;
+    int _numSlots;
+    T* _frames;
+    volatile int _readIndex;
+    volatile int _writeIndex;
+};
+
+#endif /* defined(__hifi__LockFreeFrameQueue__) */
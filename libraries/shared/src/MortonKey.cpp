@@ -0,0 +1,68 @@
+//
+//  MortonKey.cpp
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Octal codes packed into 64 bit integers
+//
+
+#include "OctalCode.h"
+
+#include "MortonKey.h"
+
+// gathers every third bit, starting with the lowest, into the low 21 bits
+static uint64_t compactEveryThirdBit(uint64_t bits) {
+    bits &= 0x1249249249249249ULL;
+    bits = (bits ^ (bits >> 2))  & 0x10c30c30c30c30c3ULL;
+    bits = (bits ^ (bits >> 4))  & 0x100f00f00f00f00fULL;
+    bits = (bits ^ (bits >> 8))  & 0x1f0000ff0000ffULL;
+    bits = (bits ^ (bits >> 16)) & 0x1f00000000ffffULL;
+    bits = (bits ^ (bits >> 32)) & 0x1fffffULL;
+    return bits;
+}
+
+void copyFirstVertexForMortonKey(MortonKey key, float* output) {
+    int depth = mortonKeyDepth(key);
+    uint64_t sections = key ^ (ROOT_MORTON_KEY << (depth * MORTON_KEY_BITS_PER_LEVEL));
+    float scale = mortonKeyScale(key);
+
+    // each section is the x, y and z bits of a level, highest first
+    output[0] = compactEveryThirdBit(sections >> 2) * scale;
+    output[1] = compactEveryThirdBit(sections >> 1) * scale;
+    output[2] = compactEveryThirdBit(sections) * scale;
+}
+
+MortonKey mortonKeyForOctalCode(const unsigned char* octalCode) {
+    int depth = numberOfThreeBitSectionsInCode(octalCode);
+    if (depth > MAX_MORTON_KEY_DEPTH) {
+        return INVALID_MORTON_KEY;
+    }
+
+    // the sections follow the length byte, packed from the high bit of each byte down
+    int sectionBytes = bytesRequiredForCodeLength(depth) - 1;
+    uint64_t bits = 0;
+    for (int i = 0; i < sectionBytes; i++) {
+        bits = (bits << BITS_IN_BYTE) | octalCode[1 + i];
+    }
+    int sectionBits = depth * MORTON_KEY_BITS_PER_LEVEL;
+    uint64_t sections = bits >> (sectionBytes * BITS_IN_BYTE - sectionBits);
+
+    return (ROOT_MORTON_KEY << sectionBits) | sections;
+}
+
+int octalCodeForMortonKey(MortonKey key, unsigned char* octalCode) {
+    int depth = mortonKeyDepth(key);
+    int sectionBits = depth * MORTON_KEY_BITS_PER_LEVEL;
+    int sectionBytes = bytesRequiredForCodeLength(depth) - 1;
+    uint64_t sections = key ^ (ROOT_MORTON_KEY << sectionBits);
+
+    // left align the sections in the bytes after the length byte, the bits after them are zero
+    uint64_t bits = sections << (sectionBytes * BITS_IN_BYTE - sectionBits);
+    octalCode[0] = depth;
+    for (int i = sectionBytes; i > 0; i--) {
+        octalCode[i] = bits & 0xFF;
+        bits >>= BITS_IN_BYTE;
+    }
+    return sectionBytes + 1;
+}
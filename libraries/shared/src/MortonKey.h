@@ -0,0 +1,73 @@
+//
+//  MortonKey.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Octal codes packed into 64 bit integers
+//
+
+#ifndef __hifi__MortonKey__
+#define __hifi__MortonKey__
+
+#include <stdint.h>
+
+/// An octal code packed into 64 bits: a marker bit, then the code's three bit sections with the first section highest.
+/// Codes of up to MAX_MORTON_KEY_DEPTH sections fit, deeper codes have no key. Unlike octal codes they need no memory
+/// of their own, and the operations on them are a few shifts and masks rather than walks over the bytes of the code.
+/// Keys compare in the same order as compareOctalCodes() orders their octal codes.
+typedef uint64_t MortonKey;
+
+const int MAX_MORTON_KEY_DEPTH = 21;
+const MortonKey ROOT_MORTON_KEY = 1;
+const MortonKey INVALID_MORTON_KEY = 0;
+
+// enough for the octal code of any key, the length byte and the 63 bits of the sections
+const int MAX_MORTON_KEY_OCTAL_CODE_BYTES = 9;
+
+const int MORTON_KEY_BITS_PER_LEVEL = 3;
+const int MORTON_KEY_MARKER_BIT = 63;
+
+inline bool isValidMortonKey(MortonKey key) { return key != INVALID_MORTON_KEY; }
+
+/// the number of sections in the key's octal code, 0 for the root
+inline int mortonKeyDepth(MortonKey key) {
+    return (MORTON_KEY_MARKER_BIT - __builtin_clzll(key)) / MORTON_KEY_BITS_PER_LEVEL;
+}
+
+/// the key of a child, the parent must be shallower than MAX_MORTON_KEY_DEPTH
+inline MortonKey mortonKeyChild(MortonKey parent, int childIndex) {
+    return (parent << MORTON_KEY_BITS_PER_LEVEL) | childIndex;
+}
+
+inline MortonKey mortonKeyParent(MortonKey child) { return child >> MORTON_KEY_BITS_PER_LEVEL; }
+
+inline int mortonKeyChildIndex(MortonKey key) { return key & ((1 << MORTON_KEY_BITS_PER_LEVEL) - 1); }
+
+/// true if possibleAncestor is possibleDescendant or one of its ancestors, like isAncestorOf() with CHECK_NODE_ONLY
+inline bool isMortonKeyAncestorOf(MortonKey possibleAncestor, MortonKey possibleDescendant) {
+    int levelsBelow = mortonKeyDepth(possibleDescendant) - mortonKeyDepth(possibleAncestor);
+    return levelsBelow >= 0 && (possibleDescendant >> (levelsBelow * MORTON_KEY_BITS_PER_LEVEL)) == possibleAncestor;
+}
+
+/// -1, 0 or 1 as keyA is less than, equal to or greater than keyB, like compareOctalCodes()
+inline int compareMortonKeys(MortonKey keyA, MortonKey keyB) {
+    return keyA < keyB ? -1 : (keyA > keyB ? 1 : 0);
+}
+
+/// the size of the key's voxel in the unit cube of the tree
+inline float mortonKeyScale(MortonKey key) {
+    return 1.0f / (float)(1 << mortonKeyDepth(key));
+}
+
+/// the minimum corner of the key's voxel in the unit cube of the tree, same as copyFirstVertexForCode()
+void copyFirstVertexForMortonKey(MortonKey key, float* output);
+
+/// the key for an octal code, or INVALID_MORTON_KEY if it's deeper than MAX_MORTON_KEY_DEPTH
+MortonKey mortonKeyForOctalCode(const unsigned char* octalCode);
+
+/// writes the octal code of a key into octalCode, which has room for MAX_MORTON_KEY_OCTAL_CODE_BYTES, returns the
+/// number of bytes written
+int octalCodeForMortonKey(MortonKey key, unsigned char* octalCode);
+
+#endif /* defined(__hifi__MortonKey__) */
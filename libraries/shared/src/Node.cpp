@@ -31,7 +31,8 @@ Node::Node(const QUuid& uuid, char type, sockaddr* publicSocket, sockaddr* local
     _activeSocket(NULL),
     _bytesReceivedMovingAverage(NULL),
     _linkedData(NULL),
-    _isAlive(true)
+    _isAlive(true),
+    _lastBulkDataSequence(-1)
 {
     setPublicSocket(publicSocket);
     setLocalSocket(localSocket);
@@ -70,6 +70,10 @@ public:
     int getPingMs() const { return _pingMs; }
     void setPingMs(int pingMs) { _pingMs = pingMs; }
     
+    /// the sequence number of the last bulk data packet applied from this node, -1 before the first
+    int getLastBulkDataSequence() const { return _lastBulkDataSequence; }
+    void setLastBulkDataSequence(int lastBulkDataSequence) { _lastBulkDataSequence = lastBulkDataSequence; }
+    
     void lock() { pthread_mutex_lock(&_mutex); }
     void unlock() { pthread_mutex_unlock(&_mutex); }
 
@@ -91,6 +95,7 @@ private:
     NodeData* _linkedData;
     bool _isAlive;
     int _pingMs;
+    int _lastBulkDataSequence;
     pthread_mutex_t _mutex;
 };
 
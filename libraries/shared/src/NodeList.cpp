@@ -33,6 +33,10 @@ const char SOLO_NODE_TYPES[2] = {
     NODE_TYPE_AUDIO_MIXER
 };
 
+// how far behind the last bulk data packet applied one can arrive and still be taken for a late one rather than the
+// sender starting its sequence over
+const int MAX_BULK_DATA_REORDERING = 64;
+
 const QString DEFAULT_DOMAIN_HOSTNAME = "root.highfidelity.io";
 const unsigned short DEFAULT_DOMAIN_SERVER_PORT = 40102;
 
@@ -180,8 +184,21 @@ void NodeList::processBulkNodeData(sockaddr *senderAddress, unsigned char *packe
         unsigned char* currentPosition = startPosition + numBytesPacketHeader;
         unsigned char packetHolder[numTotalBytes];
         
-        // we've already verified packet version for the bulk packet, so all head data in the packet is also up to date
-        populateTypeAndVersion(packetHolder, PACKET_TYPE_HEAD_DATA);
+        // the sequence number we acknowledge once the packet is parsed
+        uint16_t sequence;
+        memcpy(&sequence, currentPosition, sizeof(sequence));
+        currentPosition += sizeof(sequence);
+        
+        // a packet sent before one we've applied would put older avatar state over newer, it isn't acknowledged
+        // either, so the sender still counts the fields in it as unreceived and sends them again if they're current
+        int lastSequence = bulkSendNode->getLastBulkDataSequence();
+        if (lastSequence != -1 && (uint16_t) (lastSequence - sequence) < MAX_BULK_DATA_REORDERING) {
+            return;
+        }
+        bulkSendNode->setLastBulkDataSequence(sequence);
+        
+        // each record is handed to the linked data with the bulk header so it knows to parse the compact format
+        populateTypeAndVersion(packetHolder, PACKET_TYPE_BULK_AVATAR_DATA);
         
         while ((currentPosition - startPosition) < numTotalBytes) {
             
@@ -203,6 +220,19 @@ void NodeList::processBulkNodeData(sockaddr *senderAddress, unsigned char *packe
                                                   numTotalBytes - (currentPosition - startPosition));
             
         }
+        
+        // let the mixer know which field versions we now have, so it only sends what changed since
+        unsigned char ackPacket[MAX_PACKET_SIZE];
+        unsigned char* ackPosition = ackPacket + populateTypeAndVersion(ackPacket, PACKET_TYPE_BULK_AVATAR_DATA_ACK);
+        
+        QByteArray rfcUUID = _ownerUUID.toRfc4122();
+        memcpy(ackPosition, rfcUUID.constData(), rfcUUID.size());
+        ackPosition += rfcUUID.size();
+        
+        memcpy(ackPosition, &sequence, sizeof(sequence));
+        ackPosition += sizeof(sequence);
+        
+        _nodeSocket.send(senderAddress, ackPacket, ackPosition - ackPacket);
     }    
 }
 
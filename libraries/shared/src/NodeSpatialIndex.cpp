@@ -0,0 +1,173 @@
+//
+//  NodeSpatialIndex.cpp
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "Node.h"
+
+#include "NodeSpatialIndex.h"
+
+// each cell coordinate is packed into 21 bits of the key, offset so that negative coordinates stay positive
+const int CELL_COORDINATE_BITS = 21;
+const int CELL_COORDINATE_OFFSET = 1 << (CELL_COORDINATE_BITS - 1);
+const uint64_t CELL_COORDINATE_MASK = (1 << CELL_COORDINATE_BITS) - 1;
+
+NodeSpatialIndex::NodeSpatialIndex(float cellSize) :
+    _cellSize(cellSize),
+    _cells(),
+    _nodes()
+{
+    pthread_rwlock_init(&_lock, NULL);
+}
+
+NodeSpatialIndex::~NodeSpatialIndex() {
+    pthread_rwlock_destroy(&_lock);
+}
+
+void NodeSpatialIndex::updateNode(Node* node, const glm::vec3& position) {
+    pthread_rwlock_wrlock(&_lock);
+
+    CellKey cellKey = keyForCell(cellForPosition(position));
+    std::map<Node*, IndexedNode>::iterator indexedNode = _nodes.find(node);
+
+    if (indexedNode == _nodes.end()) {
+        IndexedNode newIndexedNode = { position, cellKey };
+        _nodes.insert(std::pair<Node*, IndexedNode>(node, newIndexedNode));
+        _cells[cellKey].push_back(node);
+    } else {
+        if (indexedNode->second.cellKey != cellKey) {
+            removeFromCell(node, indexedNode->second.cellKey);
+            _cells[cellKey].push_back(node);
+            indexedNode->second.cellKey = cellKey;
+        }
+
+        indexedNode->second.position = position;
+    }
+
+    pthread_rwlock_unlock(&_lock);
+}
+
+void NodeSpatialIndex::removeNode(Node* node) {
+    pthread_rwlock_wrlock(&_lock);
+
+    std::map<Node*, IndexedNode>::iterator indexedNode = _nodes.find(node);
+
+    if (indexedNode != _nodes.end()) {
+        removeFromCell(node, indexedNode->second.cellKey);
+        _nodes.erase(indexedNode);
+    }
+
+    pthread_rwlock_unlock(&_lock);
+}
+
+void NodeSpatialIndex::findNodesInRadius(const glm::vec3& center, float radius, std::vector<Node*>& foundNodes) {
+    findNodes(center, radius, NULL, 0.0f, foundNodes);
+}
+
+void NodeSpatialIndex::findNodesInCone(const glm::vec3& apex, const glm::vec3& direction, float minDot, float radius,
+                                       std::vector<Node*>& foundNodes) {
+    findNodes(apex, radius, &direction, minDot, foundNodes);
+}
+
+int NodeSpatialIndex::getNumNodes() {
+    pthread_rwlock_rdlock(&_lock);
+    int numNodes = _nodes.size();
+    pthread_rwlock_unlock(&_lock);
+
+    return numNodes;
+}
+
+glm::ivec3 NodeSpatialIndex::cellForPosition(const glm::vec3& position) const {
+    return glm::ivec3(floorf(position.x / _cellSize), floorf(position.y / _cellSize), floorf(position.z / _cellSize));
+}
+
+NodeSpatialIndex::CellKey NodeSpatialIndex::keyForCell(const glm::ivec3& cell) const {
+    return ((CellKey) ((cell.x + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << (2 * CELL_COORDINATE_BITS))
+        | ((CellKey) ((cell.y + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << CELL_COORDINATE_BITS)
+        | (CellKey) ((cell.z + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK);
+}
+
+glm::ivec3 NodeSpatialIndex::cellForKey(CellKey cellKey) const {
+    return glm::ivec3((int) ((cellKey >> (2 * CELL_COORDINATE_BITS)) & CELL_COORDINATE_MASK) - CELL_COORDINATE_OFFSET,
+                      (int) ((cellKey >> CELL_COORDINATE_BITS) & CELL_COORDINATE_MASK) - CELL_COORDINATE_OFFSET,
+                      (int) (cellKey & CELL_COORDINATE_MASK) - CELL_COORDINATE_OFFSET);
+}
+
+void NodeSpatialIndex::removeFromCell(Node* node, CellKey cellKey) {
+    std::map<CellKey, std::vector<Node*> >::iterator cell = _cells.find(cellKey);
+
+    if (cell != _cells.end()) {
+        cell->second.erase(std::remove(cell->second.begin(), cell->second.end(), node), cell->second.end());
+
+        // drop empty cells so that sparse crowds don't leave a trail of them behind
+        if (cell->second.empty()) {
+            _cells.erase(cell);
+        }
+    }
+}
+
+void NodeSpatialIndex::findNodes(const glm::vec3& center, float radius, const glm::vec3* coneDirection,
+                                 float coneMinDot, std::vector<Node*>& foundNodes) {
+    pthread_rwlock_rdlock(&_lock);
+
+    glm::ivec3 minCell = cellForPosition(center - glm::vec3(radius, radius, radius));
+    glm::ivec3 maxCell = cellForPosition(center + glm::vec3(radius, radius, radius));
+    glm::ivec3 cellRange = maxCell - minCell + glm::ivec3(1, 1, 1);
+    float numCellsInRange = (float) cellRange.x * cellRange.y * cellRange.z;
+
+    if (numCellsInRange > _cells.size()) {
+        // the query covers more cells than are occupied, it is cheaper to check every occupied cell
+        for (std::map<CellKey, std::vector<Node*> >::iterator cell = _cells.begin(); cell != _cells.end(); cell++) {
+            glm::ivec3 cellCoordinates = cellForKey(cell->first);
+
+            if (cellCoordinates.x >= minCell.x && cellCoordinates.x <= maxCell.x
+                && cellCoordinates.y >= minCell.y && cellCoordinates.y <= maxCell.y
+                && cellCoordinates.z >= minCell.z && cellCoordinates.z <= maxCell.z) {
+                addNodesInCell(cell->second, center, radius, coneDirection, coneMinDot, foundNodes);
+            }
+        }
+    } else {
+        for (int x = minCell.x; x <= maxCell.x; x++) {
+            for (int y = minCell.y; y <= maxCell.y; y++) {
+                for (int z = minCell.z; z <= maxCell.z; z++) {
+                    std::map<CellKey, std::vector<Node*> >::iterator cell =
+                        _cells.find(keyForCell(glm::ivec3(x, y, z)));
+
+                    if (cell != _cells.end()) {
+                        addNodesInCell(cell->second, center, radius, coneDirection, coneMinDot, foundNodes);
+                    }
+                }
+            }
+        }
+    }
+
+    pthread_rwlock_unlock(&_lock);
+}
+
+void NodeSpatialIndex::addNodesInCell(const std::vector<Node*>& cellNodes, const glm::vec3& center, float radius,
+                                      const glm::vec3* coneDirection, float coneMinDot, std::vector<Node*>& foundNodes) {
+    for (std::vector<Node*>::const_iterator node = cellNodes.begin(); node != cellNodes.end(); node++) {
+        if (!(*node)->isAlive()) {
+            continue;
+        }
+
+        // find rather than operator[], which isn't safe to share between the threads holding the read lock
+        glm::vec3 offset = _nodes.find(*node)->second.position - center;
+        float distanceSquared = glm::dot(offset, offset);
+
+        if (distanceSquared > radius * radius) {
+            continue;
+        }
+
+        if (coneDirection && glm::dot(offset, *coneDirection) < coneMinDot * sqrtf(distanceSquared)) {
+            continue;
+        }
+
+        foundNodes.push_back(*node);
+    }
+}
@@ -0,0 +1,78 @@
+//
+//  NodeSpatialIndex.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+
+#ifndef __hifi__NodeSpatialIndex__
+#define __hifi__NodeSpatialIndex__
+
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "NodeList.h"
+
+/// A uniform grid of node positions, so that a mixer can find the nodes near a point or in front of it without walking
+/// the whole NodeList. Positions are set with updateNode as each node's data is parsed, nodes are dropped when the
+/// NodeList kills them if the index has been added as a hook.
+class NodeSpatialIndex : public NodeListHook {
+public:
+    NodeSpatialIndex(float cellSize);
+    ~NodeSpatialIndex();
+
+    /// adds the node at position, or moves it there if it is already in the index
+    void updateNode(Node* node, const glm::vec3& position);
+    void removeNode(Node* node);
+
+    /// appends the live nodes within radius of center to foundNodes
+    void findNodesInRadius(const glm::vec3& center, float radius, std::vector<Node*>& foundNodes);
+
+    /// appends the live nodes within radius of apex whose direction from it has at least minDot with direction, which
+    /// must be normalized
+    void findNodesInCone(const glm::vec3& apex, const glm::vec3& direction, float minDot, float radius,
+                         std::vector<Node*>& foundNodes);
+
+    int getNumNodes();
+
+    virtual void nodeAdded(Node* node) {}
+    virtual void nodeKilled(Node* node) { removeNode(node); }
+private:
+    typedef uint64_t CellKey;
+
+    struct IndexedNode {
+        glm::vec3 position;
+        CellKey cellKey;
+    };
+
+    // not copyable, the hook and lock belong to this index
+    NodeSpatialIndex(const NodeSpatialIndex&);
+    NodeSpatialIndex& operator=(const NodeSpatialIndex&);
+
+    glm::ivec3 cellForPosition(const glm::vec3& position) const;
+    CellKey keyForCell(const glm::ivec3& cell) const;
+    glm::ivec3 cellForKey(CellKey cellKey) const;
+
+    void removeFromCell(Node* node, CellKey cellKey);
+
+    /// the live nodes within radius of center, and also inside the cone when coneDirection is not NULL
+    void findNodes(const glm::vec3& center, float radius, const glm::vec3* coneDirection, float coneMinDot,
+                   std::vector<Node*>& foundNodes);
+
+    void addNodesInCell(const std::vector<Node*>& cellNodes, const glm::vec3& center, float radius,
+                        const glm::vec3* coneDirection, float coneMinDot, std::vector<Node*>& foundNodes);
+
+    float _cellSize;
+    std::map<CellKey, std::vector<Node*> > _cells;
+    std::map<Node*, IndexedNode> _nodes;
+    
+    // queries only take the read lock, so that mixers can run them from several threads at once
+    pthread_rwlock_t _lock;
+};
+
+#endif /* defined(__hifi__NodeSpatialIndex__) */
@@ -17,19 +17,30 @@ PACKET_VERSION versionForPacketType(PACKET_TYPE type) {
 
         case PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO:
         case PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO:
+        case PACKET_TYPE_SILENT_MICROPHONE_AUDIO:
             return 2;
 
         case PACKET_TYPE_HEAD_DATA:
             return 11;
         
+        case PACKET_TYPE_BULK_AVATAR_DATA:
+            return 1;
+        
         case PACKET_TYPE_AVATAR_URLS:
             return 2;
             
         case PACKET_TYPE_AVATAR_FACE_VIDEO:
-            return 2;
+            return 3;
 
         case PACKET_TYPE_VOXEL_STATS:
             return 2;
+        
+        case PACKET_TYPE_VOXEL_QUERY:
+            return 4;
+        
+        case PACKET_TYPE_VOXEL_DATA:
+        case PACKET_TYPE_VOXEL_DATA_MONOCHROME:
+            return 1;
        
         case PACKET_TYPE_DOMAIN:
         case PACKET_TYPE_DOMAIN_LIST_REQUEST:
@@ -24,9 +24,13 @@ const PACKET_TYPE PACKET_TYPE_INJECT_AUDIO = 'I';
 const PACKET_TYPE PACKET_TYPE_MIXED_AUDIO = 'A';
 const PACKET_TYPE PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO = 'M';
 const PACKET_TYPE PACKET_TYPE_MICROPHONE_AUDIO_WITH_ECHO = 'm';
+const PACKET_TYPE PACKET_TYPE_SILENT_MICROPHONE_AUDIO = 'n';
+const PACKET_TYPE PACKET_TYPE_SILENT_AUDIO_FRAME = 'a';
 const PACKET_TYPE PACKET_TYPE_BULK_AVATAR_DATA = 'X';
+const PACKET_TYPE PACKET_TYPE_BULK_AVATAR_DATA_ACK = 'x';
 const PACKET_TYPE PACKET_TYPE_AVATAR_URLS = 'U';
 const PACKET_TYPE PACKET_TYPE_AVATAR_FACE_VIDEO = 'F';
+const PACKET_TYPE PACKET_TYPE_AVATAR_FACE_VIDEO_MAX_BITRATE = 'f';
 const PACKET_TYPE PACKET_TYPE_TRANSMITTER_DATA_V2 = 'T';
 const PACKET_TYPE PACKET_TYPE_ENVIRONMENT_DATA = 'e';
 const PACKET_TYPE PACKET_TYPE_DOMAIN_LIST_REQUEST = 'L';
@@ -30,7 +30,10 @@ bool ReceivedPacketProcessor::process() {
         const uint64_t RECEIVED_THREAD_SLEEP_INTERVAL = (1000 * 1000)/60; // check at 60fps
         usleep(RECEIVED_THREAD_SLEEP_INTERVAL);
     }
-    while (_packets.size() > 0) {
+
+    // a pass handles the packets waiting now, packets that arrive meanwhile are left for the next one
+    int packetCount = _packets.size();
+    for (int i = 0; i < packetCount; i++) {
         NetworkPacket& packet = _packets.front();
         processPacket(packet.getAddress(), packet.getData(), packet.getLength());
 
@@ -38,5 +41,8 @@ bool ReceivedPacketProcessor::process() {
         _packets.erase(_packets.begin());
         unlock();
     }
+    if (packetCount > 0) {
+        packetsProcessed();
+    }
     return isStillRunning();  // keep running till they terminate us
 }
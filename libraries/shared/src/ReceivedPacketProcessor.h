@@ -33,6 +33,11 @@ protected:
     /// \thread "this" individual processing thread
     virtual void processPacket(sockaddr& senderAddress, unsigned char*  packetData, ssize_t packetLength) = 0;
 
+    /// Called after each pass over the packets that were waiting to be processed. Implement this to finish work that is
+    /// collected across the packets of a pass.
+    /// \thread "this" individual processing thread
+    virtual void packetsProcessed() { }
+
     /// Implements generic processing behavior for this thread.
     virtual bool process();
 
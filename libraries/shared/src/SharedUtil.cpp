@@ -565,6 +565,113 @@ int unpackFloatVec3FromSignedTwoByteFixed(unsigned char* sourceBuffer, glm::vec3
 }
 
 
+const int THREE_BYTE_FIXED_MAX = (1 << 23) - 1;
+
+int packFloatVec3ToSignedThreeByteFixed(unsigned char* destBuffer, const glm::vec3& srcVector, int radix) {
+    for (int i = 0; i < 3; i++) {
+        int fixedValue = glm::clamp((int) roundf(srcVector[i] * (float)(1 << radix)),
+                                    -THREE_BYTE_FIXED_MAX, THREE_BYTE_FIXED_MAX);
+        destBuffer[i * 3] = fixedValue & 0xFF;
+        destBuffer[i * 3 + 1] = (fixedValue >> 8) & 0xFF;
+        destBuffer[i * 3 + 2] = (fixedValue >> 16) & 0xFF;
+    }
+    return 3 * 3;
+}
+
+int unpackFloatVec3FromSignedThreeByteFixed(unsigned char* sourceBuffer, glm::vec3& destination, int radix) {
+    for (int i = 0; i < 3; i++) {
+        int fixedValue = sourceBuffer[i * 3] | (sourceBuffer[i * 3 + 1] << 8) | (sourceBuffer[i * 3 + 2] << 16);
+        
+        // sign extend from 24 bits
+        if (fixedValue & (1 << 23)) {
+            fixedValue -= (1 << 24);
+        }
+        destination[i] = fixedValue / (float)(1 << radix);
+    }
+    return 3 * 3;
+}
+
+const int SMALLEST_THREE_COMPONENT_BITS = 10;
+const int SMALLEST_THREE_COMPONENT_MAX = (1 << SMALLEST_THREE_COMPONENT_BITS) - 1;
+const float SMALLEST_THREE_COMPONENT_RANGE = 1.0f / sqrtf(2.0f);
+
+int packOrientationQuatToSmallestThree(unsigned char* buffer, const glm::quat& quatInput) {
+    float components[4] = { quatInput.x, quatInput.y, quatInput.z, quatInput.w };
+    
+    int largestIndex = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+    
+    // q and -q are the same orientation, so flip it so the dropped component is always positive
+    float sign = components[largestIndex] < 0.0f ? -1.0f : 1.0f;
+    
+    uint32_t packedQuat = largestIndex;
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            float normalized = (sign * components[i] / SMALLEST_THREE_COMPONENT_RANGE + 1.0f) * 0.5f;
+            int quantized = glm::clamp((int) roundf(normalized * SMALLEST_THREE_COMPONENT_MAX),
+                                       0, SMALLEST_THREE_COMPONENT_MAX);
+            packedQuat = (packedQuat << SMALLEST_THREE_COMPONENT_BITS) | quantized;
+        }
+    }
+    
+    memcpy(buffer, &packedQuat, sizeof(packedQuat));
+    return sizeof(packedQuat);
+}
+
+int unpackOrientationQuatFromSmallestThree(unsigned char* buffer, glm::quat& quatOutput) {
+    uint32_t packedQuat;
+    memcpy(&packedQuat, buffer, sizeof(packedQuat));
+    
+    int largestIndex = packedQuat >> (3 * SMALLEST_THREE_COMPONENT_BITS);
+    float components[4];
+    float sumOfSquares = 0.0f;
+    
+    for (int i = 3; i >= 0; i--) {
+        if (i != largestIndex) {
+            float normalized = (packedQuat & SMALLEST_THREE_COMPONENT_MAX) / (float) SMALLEST_THREE_COMPONENT_MAX;
+            components[i] = (normalized * 2.0f - 1.0f) * SMALLEST_THREE_COMPONENT_RANGE;
+            sumOfSquares += components[i] * components[i];
+            packedQuat >>= SMALLEST_THREE_COMPONENT_BITS;
+        }
+    }
+    components[largestIndex] = sqrtf(std::max(0.0f, 1.0f - sumOfSquares));
+    
+    quatOutput = glm::normalize(glm::quat(components[3], components[0], components[1], components[2]));
+    return sizeof(packedQuat);
+}
+
+//  Safe version of glm::eulerAngles; uses the factorization method described in David Eberly's
+//  http://www.geometrictools.com/Documentation/EulerAngles.pdf (via Clyde,
+// https://github.com/threerings/clyde/blob/master/src/main/java/com/threerings/math/Quaternion.java)
+glm::vec3 safeEulerAngles(const glm::quat& q) {
+    float sy = 2.0f * (q.y * q.w - q.x * q.z);
+    if (sy < 1.0f - EPSILON) {
+        if (sy > -1.0f + EPSILON) {
+            return glm::degrees(glm::vec3(
+                atan2f(q.y * q.z + q.x * q.w, 0.5f - (q.x * q.x + q.y * q.y)),
+                asinf(sy),
+                atan2f(q.x * q.y + q.z * q.w, 0.5f - (q.y * q.y + q.z * q.z))));
+                
+        } else {
+            // not a unique solution; x + z = atan2(-m21, m11)
+            return glm::degrees(glm::vec3(
+                0.0f,
+                (float) M_PI * -0.5f,
+                atan2f(q.x * q.w - q.y * q.z, 0.5f - (q.x * q.x + q.z * q.z))));
+        }
+    } else {
+        // not a unique solution; x - z = atan2(-m21, m11)
+        return glm::degrees(glm::vec3(
+            0.0f,
+            (float) M_PI * 0.5f,
+            -atan2f(q.x * q.w - q.y * q.z, 0.5f - (q.x * q.x + q.z * q.z))));
+    }
+}
+
 int packFloatAngleToTwoByte(unsigned char* buffer, float angle) {
     const float ANGLE_CONVERSION_RATIO = (std::numeric_limits<uint16_t>::max() / 360.0);
     
@@ -151,4 +151,15 @@ int unpackFloatScalarFromSignedTwoByteFixed(int16_t* byteFixedPointer, float* de
 int packFloatVec3ToSignedTwoByteFixed(unsigned char* destBuffer, const glm::vec3& srcVector, int radix);
 int unpackFloatVec3FromSignedTwoByteFixed(unsigned char* sourceBuffer, glm::vec3& destination, int radix);
 
+// Positions as 24 bit fixed-point per component: radix 8 covers +/-32768 with 1/256 precision
+int packFloatVec3ToSignedThreeByteFixed(unsigned char* destBuffer, const glm::vec3& srcVector, int radix);
+int unpackFloatVec3FromSignedThreeByteFixed(unsigned char* sourceBuffer, glm::vec3& destination, int radix);
+
+// Orientation Quats are unit length, so the largest component can be rebuilt from the other three, which are then
+// known to be between -1/sqrt(2) and 1/sqrt(2). This encodes which one was dropped in 2 bits and the rest in 10 bits each
+int packOrientationQuatToSmallestThree(unsigned char* buffer, const glm::quat& quatInput);
+int unpackOrientationQuatFromSmallestThree(unsigned char* buffer, glm::quat& quatOutput);
+
+glm::vec3 safeEulerAngles(const glm::quat& q);
+
 #endif /* defined(__hifi__SharedUtil__) */
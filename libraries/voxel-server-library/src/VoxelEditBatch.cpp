@@ -0,0 +1,95 @@
+//
+//  VoxelEditBatch.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Voxel sets collected from edit packets to apply to the tree together
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <OctalCode.h>
+
+#include "VoxelEditBatch.h"
+
+// orders edits by code, and edits of the same code in the order they were added
+class EditOrder {
+public:
+    EditOrder(const unsigned char* codeColorBuffers, int editSize, int codeSize) :
+        _codeColorBuffers(codeColorBuffers),
+        _editSize(editSize),
+        _codeSize(codeSize) { }
+
+    bool operator()(int editA, int editB) const {
+        // the codes are all the same length, so comparing their bytes orders them like compareOctalCodes()
+        int compare = memcmp(_codeColorBuffers + editA * _editSize, _codeColorBuffers + editB * _editSize, _codeSize);
+        return compare < 0 || (compare == 0 && editA < editB);
+    }
+
+private:
+    const unsigned char* _codeColorBuffers;
+    int _editSize;
+    int _codeSize;
+};
+
+VoxelEditBatch::VoxelEditBatch() :
+    _lengthOfCode(0),
+    _editSize(0),
+    _codeColorBuffers(),
+    _destructive(),
+    _sortedEdits(),
+    _coalescedEdits()
+{
+}
+
+bool VoxelEditBatch::addEdit(const unsigned char* codeColorBuffer, bool destructive) {
+    int lengthOfCode = numberOfThreeBitSectionsInCode(codeColorBuffer);
+    if (isEmpty()) {
+        _lengthOfCode = lengthOfCode;
+        _editSize = bytesRequiredForCodeLength(lengthOfCode) + SIZE_OF_COLOR_DATA;
+    } else if (lengthOfCode != _lengthOfCode) {
+        return false;
+    }
+    _codeColorBuffers.insert(_codeColorBuffers.end(), codeColorBuffer, codeColorBuffer + _editSize);
+    _destructive.push_back(destructive);
+    return true;
+}
+
+void VoxelEditBatch::apply(VoxelTree& tree, VoxelEditLog& editLog) {
+    if (isEmpty()) {
+        return;
+    }
+    int codeSize = _editSize - SIZE_OF_COLOR_DATA;
+    const unsigned char* codeColorBuffers = &_codeColorBuffers[0];
+
+    _sortedEdits.clear();
+    for (int i = 0; i < getEditCount(); i++) {
+        _sortedEdits.push_back(i);
+    }
+    std::sort(_sortedEdits.begin(), _sortedEdits.end(), EditOrder(codeColorBuffers, _editSize, codeSize));
+
+    // the last set of a voxel gives it its color, but if any of them deleted its children it still needs to
+    _coalescedEdits.clear();
+    for (int i = 0; i < _sortedEdits.size(); i++) {
+        const unsigned char* codeColorBuffer = codeColorBuffers + _sortedEdits[i] * _editSize;
+        bool destructive = _destructive[_sortedEdits[i]];
+        VoxelEdit* previousEdit = _coalescedEdits.empty() ? NULL : &_coalescedEdits.back();
+        if (previousEdit && memcmp(previousEdit->codeColorBuffer, codeColorBuffer, codeSize) == 0) {
+            previousEdit->codeColorBuffer = codeColorBuffer;
+            previousEdit->destructive = previousEdit->destructive || destructive;
+        } else {
+            VoxelEdit edit = { codeColorBuffer, destructive };
+            _coalescedEdits.push_back(edit);
+        }
+    }
+
+    tree.readCodeColorBuffersToTree(&_coalescedEdits[0], _coalescedEdits.size());
+    for (int i = 0; i < _coalescedEdits.size(); i++) {
+        editLog.editApplied(_coalescedEdits[i].codeColorBuffer);
+    }
+
+    _codeColorBuffers.clear();
+    _destructive.clear();
+}
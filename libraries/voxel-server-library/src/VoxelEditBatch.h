@@ -0,0 +1,47 @@
+//
+//  VoxelEditBatch.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Voxel sets collected from edit packets to apply to the tree together
+//
+
+#ifndef __voxel_server__VoxelEditBatch__
+#define __voxel_server__VoxelEditBatch__
+
+#include <vector>
+
+#include <VoxelTree.h>
+
+#include "VoxelEditLog.h"
+
+/// The voxel sets from the edit packets of one pass over the received packets. They are applied to the tree in a single
+/// walk, sorted so that edits in the same subtree share the walk down to it, and with only the last set of each voxel
+/// applied. Sets of voxels of different sizes can overlap, and the order of overlapping sets matters, so a batch only
+/// holds sets of one size.
+class VoxelEditBatch {
+public:
+    VoxelEditBatch();
+
+    /// adds the set in the code color buffer, returns false without adding it if it's of a different size than the
+    /// sets already in the batch, which then need to be applied first
+    bool addEdit(const unsigned char* codeColorBuffer, bool destructive);
+
+    /// applies the sets to the tree, records them in the edit log, and empties the batch, the caller holds the tree's
+    /// write lock
+    void apply(VoxelTree& tree, VoxelEditLog& editLog);
+
+    bool isEmpty() const { return _destructive.empty(); }
+    int getEditCount() const { return _destructive.size(); }
+
+private:
+    int _lengthOfCode;
+    int _editSize;
+    std::vector<unsigned char> _codeColorBuffers; // the sets' code color buffers, one after another
+    std::vector<bool> _destructive;
+    std::vector<int> _sortedEdits;
+    std::vector<VoxelEdit> _coalescedEdits;
+};
+
+#endif // __voxel_server__VoxelEditBatch__
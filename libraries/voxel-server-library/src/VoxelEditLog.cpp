@@ -0,0 +1,72 @@
+//
+//  VoxelEditLog.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The most recent edits applied to the server's tree
+//
+
+#include <OctalCode.h>
+#include <SharedUtil.h>
+
+#include "VoxelEditLog.h"
+
+VoxelEditLog::VoxelEditLog() :
+    _edits(),
+    _nextEdit(0),
+    _lastDroppedEditTime(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    _edits.reserve(EDIT_LOG_SIZE);
+}
+
+VoxelEditLog::~VoxelEditLog() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+void VoxelEditLog::editApplied(const unsigned char* octalCode) {
+    int codeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
+
+    pthread_mutex_lock(&_mutex);
+
+    if (_edits.size() < EDIT_LOG_SIZE) {
+        _edits.push_back(LoggedEdit());
+    } else {
+        _lastDroppedEditTime = _edits[_nextEdit].time;
+    }
+
+    LoggedEdit& edit = _edits[_nextEdit];
+    edit.octalCode.assign(octalCode, octalCode + codeLength);
+    edit.time = usecTimestampNow();
+    _nextEdit = (_nextEdit + 1) % EDIT_LOG_SIZE;
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+bool VoxelEditLog::hasEditsSince(uint64_t time, const unsigned char* octalCodes, int octalCodesLength) {
+    pthread_mutex_lock(&_mutex);
+
+    bool hasEdits = _lastDroppedEditTime > time;
+
+    // walk back from the newest edit until we reach the ones from before time
+    for (int i = 1; !hasEdits && i <= _edits.size(); i++) {
+        const LoggedEdit& edit = _edits[(_nextEdit - i + EDIT_LOG_SIZE) % EDIT_LOG_SIZE];
+        if (edit.time <= time) {
+            break;
+        }
+
+        const unsigned char* editCode = &edit.octalCode[0];
+        for (const unsigned char* code = octalCodes; code < octalCodes + octalCodesLength;
+             code += bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(code))) {
+            // an edit inside the subtree changes it, and so does one to a voxel that contains it
+            if (isAncestorOf(code, editCode) || isAncestorOf(editCode, code)) {
+                hasEdits = true;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_mutex);
+    return hasEdits;
+}
@@ -0,0 +1,46 @@
+//
+//  VoxelEditLog.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The most recent edits applied to the server's tree
+//
+
+#ifndef __voxel_server__VoxelEditLog__
+#define __voxel_server__VoxelEditLog__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+const int EDIT_LOG_SIZE = 1024;
+
+/// The octal codes of the most recent edits to the tree and when they were applied, so that a packet can be checked
+/// for voxels that have been edited since it was encoded before it is sent again.
+class VoxelEditLog {
+public:
+    VoxelEditLog();
+    ~VoxelEditLog();
+
+    /// records a set or erase of the voxel with this octal code
+    void editApplied(const unsigned char* octalCode);
+
+    /// true if an edit since time touched a voxel in or above the subtrees of the concatenated octal codes, or if
+    /// edits since time have already been dropped from the log so we can't tell
+    bool hasEditsSince(uint64_t time, const unsigned char* octalCodes, int octalCodesLength);
+
+private:
+    struct LoggedEdit {
+        std::vector<unsigned char> octalCode;
+        uint64_t time;
+    };
+
+    std::vector<LoggedEdit> _edits;
+    int _nextEdit;
+    uint64_t _lastDroppedEditTime;
+
+    pthread_mutex_t _mutex;
+};
+
+#endif // __voxel_server__VoxelEditLog__
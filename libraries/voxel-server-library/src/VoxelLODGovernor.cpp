@@ -0,0 +1,55 @@
+//
+//  VoxelLODGovernor.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Lowers the level of detail a client is sent while the server can't keep up with it
+//
+
+#include <algorithm>
+
+#include <SharedUtil.h>
+
+#include "VoxelLODGovernor.h"
+
+const uint64_t LOD_PRESSURE_USECS = 2 * 1000 * 1000;
+const uint64_t LOD_HEADROOM_USECS = 5 * 1000 * 1000;
+
+// each step down shrinks the render boundaries by a fifth, the most is two render levels coarser
+const float LOD_DECREASE = 0.8f;
+const float LOD_INCREASE = 1.1f;
+const float MIN_LOAD_SCALE = 0.25f;
+const float MAX_LOAD_SCALE = 1.0f;
+
+VoxelLODGovernor::VoxelLODGovernor() :
+    _loadScale(MAX_LOAD_SCALE),
+    _pressureStarted(0),
+    _headroomStarted(0)
+{
+}
+
+void VoxelLODGovernor::intervalSent(bool isUnderPressure, bool hasHeadroom) {
+    uint64_t now = usecTimestampNow();
+
+    if (isUnderPressure) {
+        _headroomStarted = 0;
+        if (_pressureStarted == 0) {
+            _pressureStarted = now;
+        } else if (now - _pressureStarted >= LOD_PRESSURE_USECS) {
+            _loadScale = std::max(MIN_LOAD_SCALE, _loadScale * LOD_DECREASE);
+            _pressureStarted = now; // give the coarser detail time to take effect before going coarser again
+        }
+    } else if (hasHeadroom) {
+        _pressureStarted = 0;
+        if (_loadScale >= MAX_LOAD_SCALE) {
+            return;
+        }
+        if (_headroomStarted == 0) {
+            _headroomStarted = now;
+        } else if (now - _headroomStarted >= LOD_HEADROOM_USECS) {
+            _loadScale = std::min(MAX_LOAD_SCALE, _loadScale * LOD_INCREASE);
+            _headroomStarted = now;
+        }
+    }
+}
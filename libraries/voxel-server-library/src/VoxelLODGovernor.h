@@ -0,0 +1,37 @@
+//
+//  VoxelLODGovernor.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Lowers the level of detail a client is sent while the server can't keep up with it
+//
+
+#ifndef __voxel_server__VoxelLODGovernor__
+#define __voxel_server__VoxelLODGovernor__
+
+#include <stdint.h>
+
+/// Scales down the level of detail a client asked for while sending to it is under pressure, either because encoding
+/// runs out of its time budget or because the client's link has slowed the send rate below what it asked for. The scale
+/// steps down after pressure has lasted LOD_PRESSURE_USECS with no headroom in between, and back up towards 1.0 after
+/// LOD_HEADROOM_USECS of sending whole scenes with time and packets to spare, so a busy scene or a brief stall doesn't
+/// churn the detail the client sees.
+class VoxelLODGovernor {
+public:
+    VoxelLODGovernor();
+
+    /// records how one send interval went, isUnderPressure if it ran out of time or packets with voxels still waiting,
+    /// hasHeadroom if it sent everything that was waiting
+    void intervalSent(bool isUnderPressure, bool hasHeadroom);
+
+    /// the factor of the client's level of detail scale to send at
+    float getLoadScale() const { return _loadScale; }
+
+private:
+    float _loadScale;
+    uint64_t _pressureStarted;
+    uint64_t _headroomStarted;
+};
+
+#endif // __voxel_server__VoxelLODGovernor__
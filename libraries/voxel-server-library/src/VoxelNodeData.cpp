@@ -6,24 +6,44 @@
 //
 //
 
+#include "OctalCode.h"
 #include "PacketHeaders.h"
 #include "SharedUtil.h"
 #include "VoxelNodeData.h"
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
-#include "VoxelSendThread.h"
+#include "VoxelSender.h"
+#include "VoxelServer.h"
+
+// the views voxels are prefetched for, in order
+enum {
+    PREFETCH_PREDICTED_VIEW,
+    PREFETCH_HALO,
+    PREFETCH_DONE
+};
+
+// the halo is this much wider than the view and sent at this factor of its level of detail, two render levels coarser
+const float PREFETCH_HALO_FOV_EXPANSION = 60.0f; // degrees
+const float MAX_PREFETCH_HALO_FOV = 170.0f;
+const float PREFETCH_HALO_LOD_SCALE = 0.25f;
 
 VoxelNodeData::VoxelNodeData(Node* owningNode) :
     VoxelQuery(owningNode),
     _viewSent(false),
     _voxelPacketAvailableBytes(MAX_VOXEL_PACKET_SIZE),
+    _voxelPacketEncodedTime(0),
     _maxSearchLevel(1),
     _maxLevelReachedInLastSearch(1),
     _lastTimeBagEmpty(0),
     _viewFrustumChanging(false),
     _viewFrustumJustStoppedChanging(true),
     _currentPacketIsColor(true),
-    _voxelSendThread(NULL)
+    _sentStateGeneration(0),
+    _prefetchStage(PREFETCH_PREDICTED_VIEW),
+    _prefetchLODScale(DEFAULT_LOD_SCALE),
+    _voxelServer(NULL),
+    _voxelSender(NULL)
 {
     _voxelPacket = new unsigned char[MAX_VOXEL_PACKET_SIZE];
     _voxelPacketAt = _voxelPacket;
@@ -33,16 +53,98 @@ VoxelNodeData::VoxelNodeData(Node* owningNode) :
     resetVoxelPacket();
 }
 
-void VoxelNodeData::initializeVoxelSendThread(VoxelServer* voxelServer) {
-    // Create voxel sending thread...
+void VoxelNodeData::initializeVoxelSender(VoxelServer* voxelServer) {
+    // Create voxel sender and hand it to the server's send workers...
     QUuid nodeUUID = getOwningNode()->getUUID();
-    _voxelSendThread = new VoxelSendThread(nodeUUID, voxelServer);
-    _voxelSendThread->initialize(true);
+    _voxelServer = voxelServer;
+    _voxelSender = new VoxelSender(nodeUUID, voxelServer);
+    _voxelServer->getSendScheduler().addSender(_voxelSender);
+}
+
+int VoxelNodeData::parseData(unsigned char* sourceBuffer, int numBytes) {
+    int bytesRead = VoxelQuery::parseData(sourceBuffer, numBytes);
+    
+    viewPredictor.poseReceived(getCameraPosition(), getCameraOrientation());
+    
+    if (getHasPacketAcknowledgement()) {
+        rateController.acknowledgementReceived(getLastReceivedSequence(), getUsecsSinceLastReceived(),
+                                               getNumPacketsReceived());
+        packetHistory.packetsAcknowledged(getLastReceivedSequence());
+    }
+    if (!getMissingSequences().empty()) {
+        packetHistory.packetsMissing(getMissingSequences());
+    }
+    return bytesRead;
+}
+
+void VoxelNodeData::updateSentState() {
+    // the client only keeps what we send it when it asks for deltas
+    if (!getWantDelta() || getLocalVoxelsGeneration() != _sentStateGeneration) {
+        sentState.forgetAll();
+        _sentStateGeneration = getLocalVoxelsGeneration();
+    }
+}
+
+bool VoxelNodeData::startNextLevelPass() {
+    if (!nodeBag.isEmpty() || deeperLevelBag.isEmpty()) {
+        return false;
+    }
+    nodeBag.swap(deeperLevelBag);
+    incrementMaxSearchLevel();
+    return true;
+}
+
+void VoxelNodeData::resetLevelPasses() {
+    deeperLevelBag.deleteAll();
+    resetMaxSearchLevel();
+}
+
+bool VoxelNodeData::startNextPrefetch(VoxelNode* rootNode, uint64_t predictionUsecs) {
+    if (!prefetchBag.isEmpty()) {
+        return true;
+    }
+
+    while (_prefetchStage != PREFETCH_DONE) {
+        int stage = _prefetchStage++;
+        _prefetchViewFrustum = _currentViewFrustum;
+
+        if (stage == PREFETCH_PREDICTED_VIEW) {
+            // a camera standing still is going to see what it sees now
+            if (!viewPredictor.isMoving()) {
+                continue;
+            }
+            glm::vec3 position;
+            glm::quat orientation;
+            viewPredictor.predictPose(predictionUsecs, position, orientation);
+            _prefetchViewFrustum.setPosition(position);
+            _prefetchViewFrustum.setOrientation(orientation);
+            _prefetchLODScale = DEFAULT_LOD_SCALE;
+        } else {
+            float haloFOV = std::min(_currentViewFrustum.getFieldOfView() + PREFETCH_HALO_FOV_EXPANSION,
+                                     MAX_PREFETCH_HALO_FOV);
+            _prefetchViewFrustum.setFieldOfView(haloFOV);
+            _prefetchLODScale = PREFETCH_HALO_LOD_SCALE;
+        }
+        _prefetchViewFrustum.calculate();
+        prefetchBag.insert(rootNode);
+        return true;
+    }
+    return false;
+}
+
+void VoxelNodeData::resetPrefetch() {
+    prefetchBag.deleteAll();
+    _prefetchStage = PREFETCH_PREDICTED_VIEW;
 }
 
 bool VoxelNodeData::packetIsDuplicate() const {
     if (_lastVoxelPacketLength == getPacketLength()) {
-        return memcmp(_lastVoxelPacket, _voxelPacket, getPacketLength()) == 0;
+        // the sequence numbers always differ, compare the header and the voxels around it
+        int sequenceStart = numBytesForPacketHeader(_voxelPacket);
+        int voxelsStart = sequenceStart + sizeof(VOXEL_PACKET_SEQUENCE);
+        
+        return memcmp(_lastVoxelPacket, _voxelPacket, sequenceStart) == 0
+            && memcmp(_lastVoxelPacket + voxelsStart, _voxelPacket + voxelsStart, getPacketLength() - voxelsStart) == 0;
     }
     return false;
 }
@@ -94,12 +196,26 @@ void VoxelNodeData::resetVoxelPacket() {
     _currentPacketIsColor = (LOW_RES_MONO && getWantLowResMoving() && _viewFrustumChanging) ? false : getWantColor();
     PACKET_TYPE voxelPacketType = _currentPacketIsColor ? PACKET_TYPE_VOXEL_DATA : PACKET_TYPE_VOXEL_DATA_MONOCHROME;
     int numBytesPacketHeader = populateTypeAndVersion(_voxelPacket, voxelPacketType);
-    _voxelPacketAt = _voxelPacket + numBytesPacketHeader;
-    _voxelPacketAvailableBytes = MAX_VOXEL_PACKET_SIZE - numBytesPacketHeader;
+    
+    // leave room for the sequence number, which is set when the packet is sent
+    int numBytesBeforeVoxels = numBytesPacketHeader + sizeof(VOXEL_PACKET_SEQUENCE);
+    _voxelPacketAt = _voxelPacket + numBytesBeforeVoxels;
+    _voxelPacketAvailableBytes = MAX_VOXEL_PACKET_SIZE - numBytesBeforeVoxels;
     _voxelPacketWaiting = false;
+    _voxelPacketRootCodes.clear();
 }
 
-void VoxelNodeData::writeToPacket(unsigned char* buffer, int bytes) {
+void VoxelNodeData::setPacketSequence(VOXEL_PACKET_SEQUENCE sequence) {
+    memcpy(_voxelPacket + numBytesForPacketHeader(_voxelPacket), &sequence, sizeof(sequence));
+}
+
+void VoxelNodeData::writeToPacket(unsigned char* buffer, int bytes, const unsigned char* rootCode) {
+    if (!_voxelPacketWaiting) {
+        _voxelPacketEncodedTime = usecTimestampNow();
+    }
+    _voxelPacketRootCodes.insert(_voxelPacketRootCodes.end(), rootCode,
+                                 rootCode + bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(rootCode)));
+    
     memcpy(_voxelPacketAt, buffer, bytes);
     _voxelPacketAvailableBytes -= bytes;
     _voxelPacketAt += bytes;
@@ -110,9 +226,9 @@ VoxelNodeData::~VoxelNodeData() {
     delete[] _voxelPacket;
     delete[] _lastVoxelPacket;
 
-    if (_voxelSendThread) {
-        _voxelSendThread->terminate();
-        delete _voxelSendThread;
+    if (_voxelSender) {
+        _voxelServer->getSendScheduler().removeSender(_voxelSender);
+        delete _voxelSender;
     }
 }
 
@@ -17,8 +17,14 @@
 #include <VoxelConstants.h>
 #include <VoxelNodeBag.h>
 #include <VoxelSceneStats.h>
+#include <VoxelSentState.h>
 
-class VoxelSendThread;
+#include "VoxelLODGovernor.h"
+#include "VoxelPacketHistory.h"
+#include "VoxelSendRateController.h"
+#include "VoxelViewPredictor.h"
+
+class VoxelSender;
 class VoxelServer;
 
 class VoxelNodeData : public VoxelQuery {
@@ -26,9 +32,20 @@ public:
     VoxelNodeData(Node* owningNode);
     ~VoxelNodeData();
 
-    void resetVoxelPacket();  // resets voxel packet to after "V" header
+    /// parses the client's query, passing its acknowledgement of our packets on to the rate controller
+    int parseData(unsigned char* sourceBuffer, int numBytes);
+
+    void resetVoxelPacket();  // resets voxel packet to after "V" header and sequence number
+
+    void setPacketSequence(VOXEL_PACKET_SEQUENCE sequence); // writes the sequence number after the header
+
+    void writeToPacket(unsigned char* buffer, int bytes, const unsigned char* rootCode); // writes to end of packet
 
-    void writeToPacket(unsigned char* buffer, int bytes); // writes to end of packet
+    /// the octal codes of the subtrees written to the packet, one after the other
+    const std::vector<unsigned char>& getPacketRootCodes() const { return _voxelPacketRootCodes; }
+    
+    /// when the first subtree was written to the packet, edits after this may have changed its voxels
+    uint64_t getPacketEncodedTime() const { return _voxelPacketEncodedTime; }
 
     const unsigned char* getPacket() const { return _voxelPacket; }
     int getPacketLength() const { return (MAX_VOXEL_PACKET_SIZE - _voxelPacketAvailableBytes); }
@@ -47,6 +64,35 @@ public:
 
     VoxelNodeBag nodeBag;
     CoverageMap map;
+    
+    /// in a progressive scene, the nodes waiting for a finer pass than the one in nodeBag, which encodes the nodes
+    /// down to getMaxSearchLevel(), the root's level being 1
+    VoxelNodeBag deeperLevelBag;
+    
+    /// once nodeBag is empty, moves the nodes waiting for the next pass of a progressive scene into it, returns true if
+    /// there were any
+    bool startNextLevelPass();
+    
+    /// starts the passes of a progressive scene over from the top of the tree
+    void resetLevelPasses();
+    
+    /// whether there are voxels waiting to be sent in this pass or a later one
+    bool hasVoxelsWaiting() const { return !nodeBag.isEmpty() || !deeperLevelBag.isEmpty(); }
+    
+    /// the nodes left to prefetch, sent with the packets to spare once the view itself has been sent
+    VoxelNodeBag prefetchBag;
+    
+    /// once prefetchBag is empty, starts prefetching for the next view, first the one the camera is predicted to have
+    /// predictionUsecs from now if it's moving, then a wider, coarser halo around the current one, returns false once
+    /// there's nothing left to prefetch until the view changes
+    bool startNextPrefetch(VoxelNode* rootNode, uint64_t predictionUsecs);
+    
+    /// forgets the prefetching for the last view, for when it changes
+    void resetPrefetch();
+    
+    /// the view the nodes in prefetchBag are for, and the factor of the client's level of detail they're sent at
+    const ViewFrustum& getPrefetchViewFrustum() const { return _prefetchViewFrustum; }
+    float getPrefetchLODScale() const { return _prefetchLODScale; }
 
     ViewFrustum& getCurrentViewFrustum()     { return _currentViewFrustum; };
     ViewFrustum& getLastKnownViewFrustum()   { return _lastKnownViewFrustum; };
@@ -69,9 +115,19 @@ public:
     bool getCurrentPacketIsColor() const { return _currentPacketIsColor; };
     
     VoxelSceneStats stats;
+    VoxelSendRateController rateController;
+    VoxelPacketHistory packetHistory;
+    VoxelSentState sentState;
+    VoxelLODGovernor lodGovernor;
+    VoxelViewPredictor viewPredictor;
+    
+    /// forgets what we've sent the client if it stopped asking for deltas or has lost voxels since, called by the
+    /// client's sender before it encodes
+    void updateSentState();
     
-    void initializeVoxelSendThread(VoxelServer* voxelServer);
-    bool isVoxelSendThreadInitalized() { return _voxelSendThread; }
+    /// creates this client's sender and schedules it on the server's send workers
+    void initializeVoxelSender(VoxelServer* voxelServer);
+    bool isVoxelSenderInitialized() { return _voxelSender; }
     
 private:
     VoxelNodeData(const VoxelNodeData &);
@@ -82,6 +138,8 @@ private:
     unsigned char* _voxelPacketAt;
     int _voxelPacketAvailableBytes;
     bool _voxelPacketWaiting;
+    std::vector<unsigned char> _voxelPacketRootCodes;
+    uint64_t _voxelPacketEncodedTime;
 
     unsigned char* _lastVoxelPacket;
     int _lastVoxelPacketLength;
@@ -96,8 +154,14 @@ private:
     bool _viewFrustumChanging;
     bool _viewFrustumJustStoppedChanging;
     bool _currentPacketIsColor;
+    uint16_t _sentStateGeneration;
+    
+    int _prefetchStage;
+    ViewFrustum _prefetchViewFrustum;
+    float _prefetchLODScale;
 
-    VoxelSendThread* _voxelSendThread;
+    VoxelServer* _voxelServer;
+    VoxelSender* _voxelSender;
 };
 
 #endif /* defined(__hifi__VoxelNodeData__) */
@@ -0,0 +1,123 @@
+//
+//  VoxelPacketHistory.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The last voxel packets sent to a client, kept for sending again
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <SharedUtil.h>
+#include <VoxelQuery.h>
+
+#include "VoxelPacketHistory.h"
+
+VoxelPacketHistory::VoxelPacketHistory() :
+    _packets(PACKET_HISTORY_SIZE),
+    _resendQueue(),
+    _numPacketsResent(0),
+    _numResendsSuperseded(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+
+    for (int i = 0; i < PACKET_HISTORY_SIZE; i++) {
+        _packets[i].isValid = false;
+    }
+}
+
+VoxelPacketHistory::~VoxelPacketHistory() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+void VoxelPacketHistory::packetSent(VOXEL_PACKET_SEQUENCE sequence, const unsigned char* packet, int packetLength,
+                                    uint64_t encodedTime, const std::vector<unsigned char>& rootCodes) {
+    pthread_mutex_lock(&_mutex);
+
+    SentPacket& sentPacket = _packets[sequence % PACKET_HISTORY_SIZE];
+    sentPacket.isValid = true;
+    sentPacket.sequence = sequence;
+    sentPacket.encodedTime = encodedTime;
+    sentPacket.lastResendTime = 0;
+    sentPacket.data.assign(packet, packet + packetLength);
+    sentPacket.rootCodes = rootCodes;
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+void VoxelPacketHistory::packetsAcknowledged(VOXEL_PACKET_SEQUENCE lastReceivedSequence) {
+    // sequence differences past this are packets sent after the acknowledged one
+    const VOXEL_PACKET_SEQUENCE MAX_SEQUENCE_PROGRESS = 0x7FFF;
+
+    pthread_mutex_lock(&_mutex);
+
+    for (int i = 0; i < PACKET_HISTORY_SIZE; i++) {
+        if (_packets[i].isValid) {
+            VOXEL_PACKET_SEQUENCE packetsBehind = lastReceivedSequence - _packets[i].sequence;
+            if (packetsBehind > MAX_MISSING_PACKETS && packetsBehind <= MAX_SEQUENCE_PROGRESS) {
+                releasePacket(_packets[i]);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+void VoxelPacketHistory::releasePacket(SentPacket& sentPacket) {
+    sentPacket.isValid = false;
+    std::vector<unsigned char>().swap(sentPacket.data);
+    std::vector<unsigned char>().swap(sentPacket.rootCodes);
+}
+
+void VoxelPacketHistory::packetsMissing(const std::vector<VOXEL_PACKET_SEQUENCE>& sequences) {
+    pthread_mutex_lock(&_mutex);
+
+    // the client asks with every query until the packet arrives, so most of these are already queued
+    for (int i = 0; i < (int) sequences.size(); i++) {
+        if (std::find(_resendQueue.begin(), _resendQueue.end(), sequences[i]) == _resendQueue.end()) {
+            _resendQueue.push_back(sequences[i]);
+        }
+    }
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+int VoxelPacketHistory::takePacketToResend(unsigned char* packet, VoxelEditLog& editLog, int minResendIntervalUsecs) {
+    pthread_mutex_lock(&_mutex);
+
+    uint64_t now = usecTimestampNow();
+    int packetLength = 0;
+
+    while (packetLength == 0 && !_resendQueue.empty()) {
+        VOXEL_PACKET_SEQUENCE sequence = _resendQueue.front();
+        _resendQueue.erase(_resendQueue.begin());
+
+        SentPacket& sentPacket = _packets[sequence % PACKET_HISTORY_SIZE];
+        if (!sentPacket.isValid || sentPacket.sequence != sequence) {
+            // already gone from the ring, or superseded
+            continue;
+        }
+
+        if (now - sentPacket.lastResendTime < (uint64_t) minResendIntervalUsecs) {
+            // the client asked again before our last resend could have reached it
+            continue;
+        }
+
+        const unsigned char* rootCodes = sentPacket.rootCodes.empty() ? NULL : &sentPacket.rootCodes[0];
+        if (editLog.hasEditsSince(sentPacket.encodedTime, rootCodes, sentPacket.rootCodes.size())) {
+            releasePacket(sentPacket);
+            _numResendsSuperseded++;
+            continue;
+        }
+
+        memcpy(packet, &sentPacket.data[0], sentPacket.data.size());
+        packetLength = sentPacket.data.size();
+        sentPacket.lastResendTime = now;
+        _numPacketsResent++;
+    }
+
+    pthread_mutex_unlock(&_mutex);
+    return packetLength;
+}
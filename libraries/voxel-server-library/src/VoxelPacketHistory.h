@@ -0,0 +1,74 @@
+//
+//  VoxelPacketHistory.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The last voxel packets sent to a client, kept for sending again
+//
+
+#ifndef __voxel_server__VoxelPacketHistory__
+#define __voxel_server__VoxelPacketHistory__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include <VoxelConstants.h>
+
+#include "VoxelEditLog.h"
+
+const int PACKET_HISTORY_SIZE = 256;
+
+/// A ring of the last voxel packets sent to a client. When the client reports one missing it is sent again as it was,
+/// with the same sequence number, unless the voxels in it have been edited since, in which case the regular sends of
+/// changed voxels will bring the client up to date instead. A packet's copy is only held until the client's
+/// acknowledgements are too far past it for it to ever be asked for.
+class VoxelPacketHistory {
+public:
+    VoxelPacketHistory();
+    ~VoxelPacketHistory();
+
+    /// keeps a copy of a sent packet, with the time its voxels were encoded from and the concatenated octal codes of
+    /// the subtrees encoded into it
+    void packetSent(VOXEL_PACKET_SEQUENCE sequence, const unsigned char* packet, int packetLength, uint64_t encodedTime,
+                    const std::vector<unsigned char>& rootCodes);
+
+    /// releases the packets too far behind the last one the client has received for it to ask for them
+    void packetsAcknowledged(VOXEL_PACKET_SEQUENCE lastReceivedSequence);
+
+    /// queues the packets the client reports missing to be sent again
+    void packetsMissing(const std::vector<VOXEL_PACKET_SEQUENCE>& sequences);
+
+    /// copies the next packet to send again into packet and returns its length, or 0 if there are none. Packets that
+    /// were sent again less than minResendIntervalUsecs ago are left, the resend may still be on its way.
+    int takePacketToResend(unsigned char* packet, VoxelEditLog& editLog, int minResendIntervalUsecs);
+
+    int getNumPacketsResent() const { return _numPacketsResent; }
+    int getNumResendsSuperseded() const { return _numResendsSuperseded; }
+
+private:
+    struct SentPacket {
+        bool isValid;
+        VOXEL_PACKET_SEQUENCE sequence;
+        uint64_t encodedTime;
+        uint64_t lastResendTime;
+        std::vector<unsigned char> data; // allocated when the slot is first used, freed once the packet is released
+        std::vector<unsigned char> rootCodes;
+    };
+
+    void releasePacket(SentPacket& sentPacket);
+
+    // not copyable, the ring can be large
+    VoxelPacketHistory(const VoxelPacketHistory&);
+    VoxelPacketHistory& operator=(const VoxelPacketHistory&);
+
+    std::vector<SentPacket> _packets;
+    std::vector<VOXEL_PACKET_SEQUENCE> _resendQueue;
+    int _numPacketsResent;
+    int _numResendsSuperseded;
+
+    pthread_mutex_t _mutex;
+};
+
+#endif // __voxel_server__VoxelPacketHistory__
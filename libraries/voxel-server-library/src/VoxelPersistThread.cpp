@@ -41,7 +41,7 @@ bool VoxelPersistThread::process() {
             
             // after done inserting all these voxels, then reaverage colors
             qDebug("BEGIN Voxels Re-Averaging\n");
-            _tree->reaverageVoxelColors(_tree->rootNode);
+            _tree->reaverageVoxelColorsInParallel(_tree->rootNode);
             qDebug("DONE WITH Voxels Re-Averaging\n");
         }
         
@@ -69,6 +69,10 @@ bool VoxelPersistThread::process() {
 
     // check the dirty bit and persist here...
     if (_tree->isDirty()) {
+        // the colors edits left to be averaged are averaged before they're saved
+        if (_tree->hasPendingReaverage()) {
+            VoxelServer::GetInstance()->reaverageEditedVoxels();
+        }
         qDebug("saving voxels to file %s...\n",_filename);
         _tree->writeToSVOFile(_filename);
         _tree->clearDirtyBit(); // tree is clean after saving
@@ -0,0 +1,188 @@
+//
+//  VoxelSendRateController.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Delay based congestion control of the voxel packets sent to a client
+//
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <SharedUtil.h>
+
+#include "VoxelSendRateController.h"
+
+// LEDBAT aims for 100ms of queueing, we want voxels to stay responsive to head movement so we aim lower
+const int TARGET_QUEUING_DELAY_USECS = 25 * 1000;
+
+// packets per interval the rate grows by per interval of acknowledged packets when there is no queueing at all
+const float RATE_GAIN = 0.1f;
+const float LOSS_DECREASE = 0.5f;
+
+const float MIN_PACKETS_PER_INTERVAL = 0.1f;
+const float MAX_PACKETS_PER_INTERVAL = 50.0f;
+
+const uint64_t BASE_DELAY_BUCKET_USECS = 10 * 1000 * 1000;
+
+// sequence differences past this are packets arriving out of order, not progress
+const VOXEL_PACKET_SEQUENCE MAX_SEQUENCE_PROGRESS = 0x7FFF;
+
+VoxelSendRateController::VoxelSendRateController() :
+    _nextSequence(0),
+    _hasAcknowledgement(false),
+    _lastAcknowledgedSequence(0),
+    _lastNumPacketsReceived(0),
+    _currentBaseDelayBucket(0),
+    _baseDelayBucketStart(0),
+    _numCurrentDelays(0),
+    _queuingDelayUsecs(0),
+    _packetsPerInterval(0.0f),
+    _packetCredit(0.0f),
+    _lastDecreaseTime(0),
+    _numPacketsLost(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+
+    memset(_sendTimes, 0, sizeof(_sendTimes));
+    for (int i = 0; i < BASE_DELAY_BUCKETS; i++) {
+        _baseDelayMinimums[i] = INT_MAX;
+    }
+}
+
+VoxelSendRateController::~VoxelSendRateController() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+int VoxelSendRateController::packetsForInterval(int initialPacketsPerInterval) {
+    pthread_mutex_lock(&_mutex);
+
+    if (_packetsPerInterval == 0.0f) {
+        _packetsPerInterval = std::max(MIN_PACKETS_PER_INTERVAL,
+                                       std::min(MAX_PACKETS_PER_INTERVAL, (float) initialPacketsPerInterval));
+    }
+
+    // slow rates send a packet every few intervals rather than rounding down to nothing
+    _packetCredit += _packetsPerInterval;
+    int packets = (int) _packetCredit;
+    _packetCredit -= packets;
+
+    pthread_mutex_unlock(&_mutex);
+    return packets;
+}
+
+VOXEL_PACKET_SEQUENCE VoxelSendRateController::packetSent() {
+    pthread_mutex_lock(&_mutex);
+
+    VOXEL_PACKET_SEQUENCE sequence = _nextSequence++;
+    _sendTimes[sequence % SEND_TIME_HISTORY_SIZE] = usecTimestampNow();
+
+    pthread_mutex_unlock(&_mutex);
+    return sequence;
+}
+
+void VoxelSendRateController::acknowledgementReceived(VOXEL_PACKET_SEQUENCE lastReceivedSequence,
+                                                      uint32_t usecsSinceLastReceived, uint16_t numPacketsReceived) {
+    pthread_mutex_lock(&_mutex);
+
+    VOXEL_PACKET_SEQUENCE sequenceProgress = lastReceivedSequence - _lastAcknowledgedSequence;
+    uint16_t newlyReceived = numPacketsReceived - _lastNumPacketsReceived;
+
+    bool isProgress = sequenceProgress > 0 && sequenceProgress <= MAX_SEQUENCE_PROGRESS;
+    if (_hasAcknowledgement && (newlyReceived == 0 || !isProgress)) {
+        // the client hasn't heard anything new since its last query, or only late packets
+        pthread_mutex_unlock(&_mutex);
+        return;
+    }
+
+    uint64_t now = usecTimestampNow();
+
+    // take the time the client held the packet before querying out of the round trip
+    VOXEL_PACKET_SEQUENCE sequenceAge = _nextSequence - lastReceivedSequence;
+    if (sequenceAge > 0 && sequenceAge <= SEND_TIME_HISTORY_SIZE) {
+        uint64_t sendTime = _sendTimes[lastReceivedSequence % SEND_TIME_HISTORY_SIZE];
+        int64_t roundTripUsecs = now - sendTime - usecsSinceLastReceived;
+        if (roundTripUsecs > 0) {
+            addDelaySample(now, roundTripUsecs);
+        }
+    }
+
+    int packetsLost = 0;
+    if (_hasAcknowledgement && newlyReceived < sequenceProgress) {
+        packetsLost = sequenceProgress - newlyReceived;
+        _numPacketsLost += packetsLost;
+    }
+
+    // the rate is set by the first interval, until then there's nothing to adjust
+    if (_packetsPerInterval > 0.0f) {
+        if (packetsLost > 0) {
+            int roundTripUsecs = _numCurrentDelays > 0 ? _currentDelays[0] : 0;
+            if (now - _lastDecreaseTime > (uint64_t) roundTripUsecs) {
+                _packetsPerInterval *= LOSS_DECREASE;
+                _lastDecreaseTime = now;
+            }
+        } else if (_hasAcknowledgement && _numCurrentDelays > 0) {
+            float offTarget = (float) (TARGET_QUEUING_DELAY_USECS - _queuingDelayUsecs) / TARGET_QUEUING_DELAY_USECS;
+            offTarget = std::max(-1.0f, std::min(1.0f, offTarget));
+
+            // one interval's worth of acknowledged packets moves the rate by at most the gain
+            _packetsPerInterval += RATE_GAIN * offTarget * sequenceProgress / _packetsPerInterval;
+        }
+
+        // a slow rate can be driven well below zero by one acknowledgement of a long run of queued packets, and
+        // must still come back up
+        _packetsPerInterval = std::max(MIN_PACKETS_PER_INTERVAL,
+                                       std::min(MAX_PACKETS_PER_INTERVAL, _packetsPerInterval));
+    }
+
+    _hasAcknowledgement = true;
+    _lastAcknowledgedSequence = lastReceivedSequence;
+    _lastNumPacketsReceived = numPacketsReceived;
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+int VoxelSendRateController::getRoundTripUsecs() const {
+    // until we've measured one, assume a round trip across the country
+    const int DEFAULT_ROUND_TRIP_USECS = 100 * 1000;
+    
+    // the acknowledgements that update the delays come in on the network thread
+    pthread_mutex_lock(&_mutex);
+    
+    int roundTripUsecs = _numCurrentDelays > 0 ? INT_MAX : DEFAULT_ROUND_TRIP_USECS;
+    for (int i = 0; i < _numCurrentDelays; i++) {
+        roundTripUsecs = std::min(roundTripUsecs, _currentDelays[i]);
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+    return roundTripUsecs;
+}
+
+void VoxelSendRateController::addDelaySample(uint64_t now, int roundTripUsecs) {
+    // the base delay is the lowest round trip of the last minute, so that a route change eventually ages out
+    if (now - _baseDelayBucketStart > BASE_DELAY_BUCKET_USECS) {
+        _currentBaseDelayBucket = (_currentBaseDelayBucket + 1) % BASE_DELAY_BUCKETS;
+        _baseDelayMinimums[_currentBaseDelayBucket] = INT_MAX;
+        _baseDelayBucketStart = now;
+    }
+    _baseDelayMinimums[_currentBaseDelayBucket] = std::min(_baseDelayMinimums[_currentBaseDelayBucket], roundTripUsecs);
+
+    int baseDelayUsecs = INT_MAX;
+    for (int i = 0; i < BASE_DELAY_BUCKETS; i++) {
+        baseDelayUsecs = std::min(baseDelayUsecs, _baseDelayMinimums[i]);
+    }
+
+    // the current delay is the lowest of the last few round trips
+    memmove(_currentDelays + 1, _currentDelays, (CURRENT_DELAY_SAMPLES - 1) * sizeof(int));
+    _currentDelays[0] = roundTripUsecs;
+    _numCurrentDelays = std::min(_numCurrentDelays + 1, CURRENT_DELAY_SAMPLES);
+
+    int currentDelayUsecs = INT_MAX;
+    for (int i = 0; i < _numCurrentDelays; i++) {
+        currentDelayUsecs = std::min(currentDelayUsecs, _currentDelays[i]);
+    }
+
+    _queuingDelayUsecs = currentDelayUsecs - baseDelayUsecs;
+}
@@ -0,0 +1,71 @@
+//
+//  VoxelSendRateController.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Delay based congestion control of the voxel packets sent to a client
+//
+
+#ifndef __voxel_server__VoxelSendRateController__
+#define __voxel_server__VoxelSendRateController__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <VoxelConstants.h>
+
+const int SEND_TIME_HISTORY_SIZE = 1024; // how many of the last packets' send times we remember for round trips
+const int BASE_DELAY_BUCKETS = 6; // minutes of history for the base delay, in ten second buckets
+const int CURRENT_DELAY_SAMPLES = 4; // round trips the current delay is the minimum of, to filter out jitter
+
+/// Sets how many voxel packets a client is sent each interval, in the manner of LEDBAT. The round trip of each
+/// acknowledged packet is compared with the lowest seen in the last minute, the rate grows while the difference, the
+/// delay we are adding by queueing packets on the way to the client, stays under a target and shrinks as it goes over.
+/// Lost packets halve the rate, at most once per round trip.
+class VoxelSendRateController {
+public:
+    VoxelSendRateController();
+    ~VoxelSendRateController();
+
+    /// the number of packets to send this interval, the rate starts at initialPacketsPerInterval
+    int packetsForInterval(int initialPacketsPerInterval);
+
+    /// records the send of a voxel packet, returns the sequence number to send it with
+    VOXEL_PACKET_SEQUENCE packetSent();
+
+    /// updates the rate with an acknowledgement from the client's query
+    void acknowledgementReceived(VOXEL_PACKET_SEQUENCE lastReceivedSequence, uint32_t usecsSinceLastReceived,
+                                 uint16_t numPacketsReceived);
+
+    float getPacketsPerInterval() const { return _packetsPerInterval; }
+    int getQueuingDelayUsecs() const { return _queuingDelayUsecs; }
+    int getRoundTripUsecs() const;
+    int getNumPacketsLost() const { return _numPacketsLost; }
+
+private:
+    void addDelaySample(uint64_t now, int roundTripUsecs);
+
+    mutable pthread_mutex_t _mutex;
+
+    VOXEL_PACKET_SEQUENCE _nextSequence;
+    uint64_t _sendTimes[SEND_TIME_HISTORY_SIZE];
+
+    bool _hasAcknowledgement;
+    VOXEL_PACKET_SEQUENCE _lastAcknowledgedSequence;
+    uint16_t _lastNumPacketsReceived;
+
+    int _baseDelayMinimums[BASE_DELAY_BUCKETS];
+    int _currentBaseDelayBucket;
+    uint64_t _baseDelayBucketStart;
+    int _currentDelays[CURRENT_DELAY_SAMPLES];
+    int _numCurrentDelays;
+    int _queuingDelayUsecs;
+
+    float _packetsPerInterval;
+    float _packetCredit;
+    uint64_t _lastDecreaseTime;
+    int _numPacketsLost;
+};
+
+#endif // __voxel_server__VoxelSendRateController__
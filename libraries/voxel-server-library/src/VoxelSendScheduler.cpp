@@ -0,0 +1,200 @@
+//
+//  VoxelSendScheduler.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Runs every client's VoxelSender on a fixed pool of worker threads
+//
+
+#include <algorithm>
+#include <sys/time.h>
+
+#include <SharedUtil.h>
+
+#include "VoxelSender.h"
+#include "VoxelServerConsts.h"
+
+#include "VoxelSendScheduler.h"
+
+// the longest a single sender may encode for in one interval, the rest of the interval is left for sending
+const int MAX_SENDER_SLICE_USECS = VOXEL_SEND_INTERVAL_USECS - SENDING_TIME_TO_SPARE;
+
+// however overloaded the server is, every client gets at least this long to make some progress each interval
+const int MIN_SENDER_SLICE_USECS = 1000;
+
+VoxelSendScheduler::VoxelSendScheduler() :
+    _senders(),
+    _workers(),
+    _isStopping(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_sendersChanged, NULL);
+}
+
+VoxelSendScheduler::~VoxelSendScheduler() {
+    stop();
+
+    pthread_cond_destroy(&_sendersChanged);
+    pthread_mutex_destroy(&_mutex);
+}
+
+void VoxelSendScheduler::start(int numWorkers) {
+    _isStopping = false;
+
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_t worker;
+        if (pthread_create(&worker, NULL, runWorker, this) == 0) {
+            _workers.push_back(worker);
+        }
+    }
+}
+
+void VoxelSendScheduler::stop() {
+    pthread_mutex_lock(&_mutex);
+    _isStopping = true;
+    pthread_cond_broadcast(&_sendersChanged);
+    pthread_mutex_unlock(&_mutex);
+
+    for (int i = 0; i < _workers.size(); i++) {
+        pthread_join(_workers[i], NULL);
+    }
+    _workers.clear();
+}
+
+void VoxelSendScheduler::addSender(VoxelSender* sender) {
+    ScheduledSender scheduledSender = { sender, usecTimestampNow(), true, false };
+
+    pthread_mutex_lock(&_mutex);
+    _senders.push_back(scheduledSender);
+    pthread_cond_broadcast(&_sendersChanged);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void VoxelSendScheduler::removeSender(VoxelSender* sender) {
+    pthread_mutex_lock(&_mutex);
+
+    int senderIndex;
+    while ((senderIndex = indexOfSender(sender)) != -1 && _senders[senderIndex].isRunning) {
+        pthread_cond_wait(&_sendersChanged, &_mutex);
+    }
+
+    if (senderIndex != -1) {
+        _senders.erase(_senders.begin() + senderIndex);
+    }
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+void* VoxelSendScheduler::runWorker(void* args) {
+    ((VoxelSendScheduler*) args)->workerLoop();
+    return NULL;
+}
+
+void VoxelSendScheduler::workerLoop() {
+    pthread_mutex_lock(&_mutex);
+
+    while (!_isStopping) {
+        int senderIndex = nextSenderIndex();
+
+        if (senderIndex == -1) {
+            pthread_cond_wait(&_sendersChanged, &_mutex);
+            continue;
+        }
+
+        uint64_t now = usecTimestampNow();
+        if (_senders[senderIndex].dueTime > now) {
+            // sleep until it is due, unless a sender is added or another worker frees one up first
+            timeval wakeTime;
+            gettimeofday(&wakeTime, NULL);
+            uint64_t wakeUsecs = usecTimestamp(&wakeTime) + (_senders[senderIndex].dueTime - now);
+
+            timespec wakeSpec;
+            wakeSpec.tv_sec = wakeUsecs / 1000000;
+            wakeSpec.tv_nsec = (wakeUsecs % 1000000) * 1000;
+            pthread_cond_timedwait(&_sendersChanged, &_mutex, &wakeSpec);
+            continue;
+        }
+
+        VoxelSender* sender = _senders[senderIndex].sender;
+        _senders[senderIndex].isRunning = true;
+        int sliceUsecs = senderSliceUsecs();
+
+        pthread_mutex_unlock(&_mutex);
+        bool hasVoxelsWaiting = sender->sendInterval(sliceUsecs);
+        pthread_mutex_lock(&_mutex);
+
+        // the vector may have changed while we were sending, so find the sender again
+        senderIndex = indexOfSender(sender);
+        _senders[senderIndex].isRunning = false;
+        _senders[senderIndex].hasVoxelsWaiting = hasVoxelsWaiting;
+
+        // due again an interval after this run started, a sender that fell behind runs again as soon as it can
+        _senders[senderIndex].dueTime = now + VOXEL_SEND_INTERVAL_USECS;
+
+        // wake anyone waiting to remove this sender, and a worker that was sleeping until a busy sender was due
+        pthread_cond_broadcast(&_sendersChanged);
+    }
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+int VoxelSendScheduler::nextSenderIndex() const {
+    uint64_t now = usecTimestampNow();
+    int nextIndex = -1;
+
+    for (int i = 0; i < _senders.size(); i++) {
+        const ScheduledSender& candidate = _senders[i];
+        if (candidate.isRunning) {
+            continue;
+        }
+
+        if (nextIndex == -1) {
+            nextIndex = i;
+            continue;
+        }
+
+        const ScheduledSender& best = _senders[nextIndex];
+        bool candidateIsDue = candidate.dueTime <= now;
+        bool bestIsDue = best.dueTime <= now;
+
+        if (candidateIsDue && bestIsDue && candidate.hasVoxelsWaiting != best.hasVoxelsWaiting) {
+            // of the senders that are due, the ones with voxels waiting go before the ones that just check for changes
+            if (candidate.hasVoxelsWaiting) {
+                nextIndex = i;
+            }
+        } else if (candidate.dueTime < best.dueTime) {
+            nextIndex = i;
+        }
+    }
+
+    return nextIndex;
+}
+
+int VoxelSendScheduler::senderSliceUsecs() const {
+    int numSendersWithVoxelsWaiting = 0;
+    for (int i = 0; i < _senders.size(); i++) {
+        if (_senders[i].hasVoxelsWaiting) {
+            numSendersWithVoxelsWaiting++;
+        }
+    }
+
+    if (numSendersWithVoxelsWaiting == 0) {
+        return MAX_SENDER_SLICE_USECS;
+    }
+
+    // every worker can encode for a whole slice each interval, split that evenly between the clients that need it
+    int budgetUsecs = _workers.size() * MAX_SENDER_SLICE_USECS;
+    int sliceUsecs = budgetUsecs / numSendersWithVoxelsWaiting;
+
+    return std::max(MIN_SENDER_SLICE_USECS, std::min(MAX_SENDER_SLICE_USECS, sliceUsecs));
+}
+
+int VoxelSendScheduler::indexOfSender(VoxelSender* sender) const {
+    for (int i = 0; i < _senders.size(); i++) {
+        if (_senders[i].sender == sender) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,73 @@
+//
+//  VoxelSendScheduler.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Runs every client's VoxelSender on a fixed pool of worker threads
+//
+
+#ifndef __voxel_server__VoxelSendScheduler__
+#define __voxel_server__VoxelSendScheduler__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+class VoxelSender;
+
+/// Runs the clients' VoxelSenders on a fixed pool of worker threads instead of a thread per client. Each sender is due
+/// once per VOXEL_SEND_INTERVAL_USECS, idle workers take the due sender with the earliest deadline, preferring the ones
+/// that still had voxels waiting after their last run. The workers share an encode time budget per interval, when there
+/// are more clients with voxels waiting than the budget covers each of them gets an equal, smaller slice of it.
+class VoxelSendScheduler {
+public:
+    VoxelSendScheduler();
+    ~VoxelSendScheduler();
+
+    /// starts numWorkers worker threads
+    void start(int numWorkers);
+
+    /// stops and joins the worker threads, the senders are left registered
+    void stop();
+
+    /// schedules the sender to run from now on, the caller keeps ownership
+    void addSender(VoxelSender* sender);
+
+    /// unschedules the sender, waiting for its current run to finish if a worker has it, after which it can be deleted
+    void removeSender(VoxelSender* sender);
+
+    int getNumWorkers() const { return _workers.size(); }
+
+private:
+    struct ScheduledSender {
+        VoxelSender* sender;
+        uint64_t dueTime;
+        bool hasVoxelsWaiting;
+        bool isRunning;
+    };
+
+    // not copyable, the workers point back at this scheduler
+    VoxelSendScheduler(const VoxelSendScheduler&);
+    VoxelSendScheduler& operator=(const VoxelSendScheduler&);
+
+    static void* runWorker(void* args);
+    void workerLoop();
+
+    /// the index of the sender a worker should run next, or -1 if none are waiting to run, called with the mutex held
+    int nextSenderIndex() const;
+
+    /// the encode time each sender gets this interval for its share of the budget, called with the mutex held
+    int senderSliceUsecs() const;
+
+    int indexOfSender(VoxelSender* sender) const;
+
+    std::vector<ScheduledSender> _senders;
+    std::vector<pthread_t> _workers;
+    bool _isStopping;
+
+    pthread_mutex_t _mutex;
+    pthread_cond_t _sendersChanged;
+};
+
+#endif // __voxel_server__VoxelSendScheduler__
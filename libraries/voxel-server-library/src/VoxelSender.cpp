@@ -1,11 +1,11 @@
 //
-//  VoxelSendThread.cpp
+//  VoxelSender.cpp
 //  voxel-server
 //
 //  Created by Brad Hefta-Gaub on 8/21/13
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
-//  Threaded or non-threaded voxel packet sender
+//  Voxel packet sender for a single client
 //
 
 #include <NodeList.h>
@@ -14,18 +14,16 @@
 #include <EnvironmentData.h>
 extern EnvironmentData environmentData[3];
 
-#include "VoxelSendThread.h"
+#include "VoxelSender.h"
 #include "VoxelServer.h"
 #include "VoxelServerConsts.h"
 
-VoxelSendThread::VoxelSendThread(const QUuid& nodeUUID, VoxelServer* myServer) :
+VoxelSender::VoxelSender(const QUuid& nodeUUID, VoxelServer* myServer) :
     _nodeUUID(nodeUUID),
     _myServer(myServer) {
 }
 
-bool VoxelSendThread::process() {
-    uint64_t  lastSendTime = usecTimestampNow();
-    
+bool VoxelSender::sendInterval(int usecBudget) {
     Node* node = NodeList::getInstance()->nodeWithUUID(_nodeUUID);
     VoxelNodeData* nodeData = NULL;
     
@@ -34,30 +32,21 @@ bool VoxelSendThread::process() {
     }
 
     // Sometimes the node data has not yet been linked, in which case we can't really do anything
-    if (nodeData) {
-        bool viewFrustumChanged = nodeData->updateCurrentViewFrustum();
-        if (_myServer->wantsDebugVoxelSending()) {
-            printf("nodeData->updateCurrentViewFrustum() changed=%s\n", debug::valueOf(viewFrustumChanged));
-        }
-        deepestLevelVoxelDistributor(node, nodeData, viewFrustumChanged);
+    if (!nodeData) {
+        return false;
     }
     
-    // dynamically sleep until we need to fire off the next set of voxels
-    int usecToSleep =  VOXEL_SEND_INTERVAL_USECS - (usecTimestampNow() - lastSendTime);
-    
-    if (usecToSleep > 0) {
-        usleep(usecToSleep);
-    } else {
-        if (_myServer->wantsDebugVoxelSending()) {
-            std::cout << "Last send took too much time, not sleeping!\n";
-        }
+    bool viewFrustumChanged = nodeData->updateCurrentViewFrustum();
+    if (_myServer->wantsDebugVoxelSending()) {
+        printf("nodeData->updateCurrentViewFrustum() changed=%s\n", debug::valueOf(viewFrustumChanged));
     }
+    deepestLevelVoxelDistributor(node, nodeData, viewFrustumChanged, usecBudget);
     
-    return isStillRunning();  // keep running till they terminate us
+    return nodeData->hasVoxelsWaiting();
 }
 
 
-void VoxelSendThread::handlePacketSend(Node* node, VoxelNodeData* nodeData, int& trueBytesSent, int& truePacketsSent) {
+void VoxelSender::handlePacketSend(Node* node, VoxelNodeData* nodeData, int& trueBytesSent, int& truePacketsSent) {
 
     // Here's where we check to see if this packet is a duplicate of the last packet. If it is, we will silently
     // obscure the packet and not send it. This allows the callers and upper level logic to not need to know about
@@ -67,6 +56,15 @@ void VoxelSendThread::handlePacketSend(Node* node, VoxelNodeData* nodeData, int&
         return; // without sending...
     }
 
+    VOXEL_PACKET_SEQUENCE sequence = nodeData->rateController.packetSent();
+    nodeData->setPacketSequence(sequence);
+    
+    // only a client that acknowledges packets can report one missing, so only its packets are kept for sending again
+    if (nodeData->getHasPacketAcknowledgement()) {
+        nodeData->packetHistory.packetSent(sequence, nodeData->getPacket(), nodeData->getPacketLength(),
+                                           nodeData->getPacketEncodedTime(), nodeData->getPacketRootCodes());
+    }
+
     // If we've got a stats message ready to send, then see if we can piggyback them together
     if (nodeData->stats.isReadyToSend()) {
         // Send the stats message to the client
@@ -101,9 +99,18 @@ void VoxelSendThread::handlePacketSend(Node* node, VoxelNodeData* nodeData, int&
 }
 
 /// Version of voxel distributor that sends the deepest LOD level at once
-void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* nodeData, bool viewFrustumChanged) {
+void VoxelSender::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* nodeData, bool viewFrustumChanged,
+                                               int usecBudget) {
+
+    // the colors edits left to be averaged are averaged before any of them are encoded
+    _myServer->reaverageEditedVoxels();
 
-    _myServer->lockTree();
+    // other clients' senders encode from the tree at the same time, only edits need it to themselves
+    _myServer->lockTreeForRead();
+
+    // nodes are only left out for being sent before when the client still has them
+    nodeData->updateSentState();
+    VoxelSentState* sentState = nodeData->getWantDelta() ? &nodeData->sentState : IGNORE_SENT_STATE;
 
     int truePacketsSent = 0;
     int trueBytesSent = 0;
@@ -153,6 +160,11 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
             );
     }
     
+    // a progressive scene goes on to its next, finer pass once this one is sent, and is only over after the last
+    if (!viewFrustumChanged) {
+        nodeData->startNextLevelPass();
+    }
+    
     // If the current view frustum has changed OR we have nothing to send, then search against 
     // the current view frustum for things to send.
     if (viewFrustumChanged || nodeData->nodeBag.isEmpty()) {
@@ -179,6 +191,7 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                 nodeData->nodeBag.deleteAll();
             }
             nodeData->map.erase();
+            nodeData->resetPrefetch();
         } 
         
         if (!viewFrustumChanged && !nodeData->getWantDelta()) {
@@ -201,6 +214,9 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
             nodeData->nodeBag.deleteAll();
         }
         nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getServerTree().rootNode, _myServer->getJurisdiction());
+        
+        // a progressive scene starts over from its coarsest pass, anything left in the bag waits for its level again
+        nodeData->resetLevelPasses();
 
         // This is the start of "resending" the scene.
         bool dontRestartSceneOnMove = false; // this is experimental
@@ -221,13 +237,45 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
 
         bool shouldSendEnvironments = _myServer->wantSendEnvironments() && shouldDo(ENVIRONMENT_SEND_INTERVAL_USECS, VOXEL_SEND_INTERVAL_USECS);
 
+        // the client's or our own rate is where the rate controller starts, from there it follows the delay and loss
+        // the client acknowledges
         int clientMaxPacketsPerInterval = nodeData->getMaxVoxelPacketsPerSecond() / INTERVALS_PER_SECOND;
-        int maxPacketsPerInterval = std::max(clientMaxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval());
+        int initialPacketsPerInterval = std::max(clientMaxPacketsPerInterval,
+                                                 _myServer->getPacketsPerClientPerInterval());
+        int maxPacketsPerInterval = nodeData->rateController.packetsForInterval(initialPacketsPerInterval);
+        
+        // the level of detail the client's screen and quality setting ask for, less while we can't keep up with it
+        float lodScale = nodeData->getLODScale() * nodeData->lodGovernor.getLoadScale();
+        bool ranOutOfTime = false;
+        
+        // once the view is sent, up to half of the interval's packets go to voxels the client is likely to see next,
+        // only for clients that ask for deltas and keep what's out of view, since then they keep what they're sent and
+        // the sent state stops resending
+        bool wantPrefetch = nodeData->getWantDelta() && nodeData->getWantPrefetch() && wantColor;
+        int maxPrefetchPacketsPerInterval = std::max(1, maxPacketsPerInterval / 2);
+        uint64_t predictionUsecs = nodeData->rateController.getRoundTripUsecs() + PREFETCH_LEAD_USECS;
         
         if (_myServer->wantsDebugVoxelSending()) {
-            printf("packetsSentThisInterval=%d maxPacketsPerInterval=%d server PPI=%d nodePPS=%d nodePPI=%d\n", 
+            printf("packetsSentThisInterval=%d maxPacketsPerInterval=%d server PPI=%d nodePPS=%d nodePPI=%d "
+                   "controller PPI=%f queuing=%d usecs lost=%d resent=%d superseded=%d sent nodes=%d lodScale=%f\n",
                 packetsSentThisInterval, maxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval(), 
-                nodeData->getMaxVoxelPacketsPerSecond(), clientMaxPacketsPerInterval);
+                nodeData->getMaxVoxelPacketsPerSecond(), clientMaxPacketsPerInterval,
+                nodeData->rateController.getPacketsPerInterval(), nodeData->rateController.getQueuingDelayUsecs(),
+                nodeData->rateController.getNumPacketsLost(), nodeData->packetHistory.getNumPacketsResent(),
+                nodeData->packetHistory.getNumResendsSuperseded(), nodeData->sentState.count(), lodScale);
+        }
+
+        // first send again any packets the client told us it missed, they count against this interval's packets
+        int resentPacketLength = 0;
+        while (packetsSentThisInterval < maxPacketsPerInterval - (shouldSendEnvironments ? 1 : 0)
+               && (resentPacketLength = nodeData->packetHistory.takePacketToResend(_tempOutputBuffer,
+                       _myServer->getEditLog(), nodeData->rateController.getRoundTripUsecs())) > 0) {
+            NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(),
+                                                           _tempOutputBuffer, resentPacketLength);
+            nodeData->stats.packetSent(resentPacketLength);
+            trueBytesSent += resentPacketLength;
+            truePacketsSent++;
+            packetsSentThisInterval++;
         }
 
         while (packetsSentThisInterval < maxPacketsPerInterval - (shouldSendEnvironments ? 1 : 0)) {
@@ -235,18 +283,19 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
             uint64_t now = usecTimestampNow();
             long elapsedUsec = (now - start);
             long elapsedUsecPerPacket = (truePacketsSent == 0) ? 0 : (elapsedUsec / truePacketsSent);
-            long usecRemaining = (VOXEL_SEND_INTERVAL_USECS - elapsedUsec);
+            long usecRemaining = (usecBudget - elapsedUsec);
             
-            if (elapsedUsecPerPacket + SENDING_TIME_TO_SPARE > usecRemaining) {
+            if (elapsedUsecPerPacket > usecRemaining) {
                 if (_myServer->wantsDebugVoxelSending()) {
                     printf("packetLoop() usecRemaining=%ld bailing early took %ld usecs to generate %d bytes in %d packets (%ld usec avg), %d nodes still to send\n",
                             usecRemaining, elapsedUsec, trueBytesSent, truePacketsSent, elapsedUsecPerPacket,
                             nodeData->nodeBag.count());
                 }
+                ranOutOfTime = true;
                 break;
             }            
             
-            if (!nodeData->nodeBag.isEmpty()) {
+            if (!nodeData->nodeBag.isEmpty() || nodeData->startNextLevelPass()) {
                 VoxelNode* subTree = nodeData->nodeBag.extract();
                 bool wantOcclusionCulling = nodeData->getWantOcclusionCulling();
                 CoverageMap* coverageMap = wantOcclusionCulling ? &nodeData->map : IGNORE_COVERAGE_MAP;
@@ -256,11 +305,17 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                 bool isFullScene = (!viewFrustumChanged || !nodeData->getWantDelta()) && 
                                  nodeData->getViewFrustumJustStoppedChanging();
                 
+                // a progressive client is sent the whole view a level at a time, the nodes below this pass's level
+                // wait for the next
+                VoxelNodeBag* deeperLevelBag = nodeData->getWantProgressive()
+                                               ? &nodeData->deeperLevelBag : IGNORE_DEEPER_LEVEL_BAG;
+                
                 EncodeBitstreamParams params(INT_MAX, &nodeData->getCurrentViewFrustum(), wantColor, 
                                              WANT_EXISTS_BITS, DONT_CHOP, wantDelta, lastViewFrustum,
                                              wantOcclusionCulling, coverageMap, boundaryLevelAdjust,
                                              nodeData->getLastTimeBagEmpty(),
-                                             isFullScene, &nodeData->stats, _myServer->getJurisdiction());
+                                             isFullScene, &nodeData->stats, _myServer->getJurisdiction(),
+                                             sentState, lodScale, deeperLevelBag, nodeData->getMaxSearchLevel());
                       
                 nodeData->stats.encodeStarted();
                 bytesWritten = _myServer->getServerTree().encodeTreeBitstream(subTree, _tempOutputBuffer, MAX_VOXEL_PACKET_SIZE - 1,
@@ -268,17 +323,38 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                 nodeData->stats.encodeStopped();
 
                 if (nodeData->getAvailable() >= bytesWritten) {
-                    nodeData->writeToPacket(_tempOutputBuffer, bytesWritten);
+                    nodeData->writeToPacket(_tempOutputBuffer, bytesWritten, subTree->getOctalCode());
                 } else {
                     handlePacketSend(node, nodeData, trueBytesSent, truePacketsSent);
                     packetsSentThisInterval++;
-                    nodeData->writeToPacket(_tempOutputBuffer, bytesWritten);
+                    nodeData->writeToPacket(_tempOutputBuffer, bytesWritten, subTree->getOctalCode());
                 }
+            } else if (wantPrefetch && packetsSentThisInterval < maxPrefetchPacketsPerInterval
+                       && nodeData->startNextPrefetch(_myServer->getServerTree().rootNode, predictionUsecs)) {
+                VoxelNode* subTree = nodeData->prefetchBag.extract();
+                
+                // sent like a scene of the prefetch view, what the client already has is left out by the sent state
+                EncodeBitstreamParams params(INT_MAX, &nodeData->getPrefetchViewFrustum(), wantColor,
+                                             WANT_EXISTS_BITS, DONT_CHOP, false, IGNORE_VIEW_FRUSTUM,
+                                             NO_OCCLUSION_CULLING, IGNORE_COVERAGE_MAP, NO_BOUNDARY_ADJUST,
+                                             nodeData->getLastTimeBagEmpty(), true, IGNORE_SCENE_STATS,
+                                             _myServer->getJurisdiction(), sentState,
+                                             lodScale * nodeData->getPrefetchLODScale());
+                
+                bytesWritten = _myServer->getServerTree().encodeTreeBitstream(subTree, _tempOutputBuffer,
+                                                                              MAX_VOXEL_PACKET_SIZE - 1,
+                                                                              nodeData->prefetchBag, params);
+                
+                if (nodeData->getAvailable() < bytesWritten) {
+                    handlePacketSend(node, nodeData, trueBytesSent, truePacketsSent);
+                    packetsSentThisInterval++;
+                }
+                nodeData->writeToPacket(_tempOutputBuffer, bytesWritten, subTree->getOctalCode());
             } else {
                 if (nodeData->isPacketWaiting()) {
                     handlePacketSend(node, nodeData, trueBytesSent, truePacketsSent);
                 }
-                packetsSentThisInterval = _myServer->getPacketsPerClientPerInterval(); // done for now, no nodes left
+                packetsSentThisInterval = maxPacketsPerInterval; // done for now, no nodes left
             }
         }
         // send the environment packet
@@ -312,9 +388,16 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                     elapsedmsec, trueBytesSent, truePacketsSent, nodeData->nodeBag.count());
         }
         
-        // if after sending packets we've emptied our bag, then we want to remember that we've sent all 
-        // the voxels from the current view frustum
-        if (nodeData->nodeBag.isEmpty()) {
+        // encoding that runs out of time, or a link that has slowed us below the rate asked for, with voxels still
+        // waiting is pressure to send less detail, a scene sent in full is room for more
+        bool ranOutOfPackets = packetsSentThisInterval >= maxPacketsPerInterval
+                               && maxPacketsPerInterval < initialPacketsPerInterval;
+        bool hasVoxelsWaiting = nodeData->hasVoxelsWaiting();
+        nodeData->lodGovernor.intervalSent(hasVoxelsWaiting && (ranOutOfTime || ranOutOfPackets), !hasVoxelsWaiting);
+        
+        // if after sending packets we've emptied our bag, and there are no finer passes left, then we want to remember
+        // that we've sent all the voxels from the current view frustum
+        if (!hasVoxelsWaiting) {
             nodeData->updateLastKnownViewFrustum();
             nodeData->setViewSent(true);
             if (_myServer->wantsDebugVoxelSending()) {
@@ -0,0 +1,41 @@
+//
+//  VoxelSender.h
+//  voxel-server
+//
+//  Created by Brad Hefta-Gaub on 8/21/13
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Object for sending voxels to a client, run one interval at a time by the VoxelSendScheduler
+//
+
+#ifndef __voxel_server__VoxelSender__
+#define __voxel_server__VoxelSender__
+
+#include <NetworkPacket.h>
+#include <VoxelTree.h>
+#include <VoxelNodeBag.h>
+#include "VoxelNodeData.h"
+
+class VoxelServer;
+
+/// Sends voxel packets to a single client. It has no thread of its own, the VoxelSendScheduler's workers call
+/// sendInterval once per send interval.
+class VoxelSender {
+public:
+    VoxelSender(const QUuid& nodeUUID, VoxelServer* myServer);
+    
+    /// sends this interval's packets to the client, encoding for no more than usecBudget, returns true if the client
+    /// still has voxels waiting to be sent
+    bool sendInterval(int usecBudget);
+
+private:
+    QUuid _nodeUUID;
+    VoxelServer* _myServer;
+
+    void handlePacketSend(Node* node, VoxelNodeData* nodeData, int& trueBytesSent, int& truePacketsSent);
+    void deepestLevelVoxelDistributor(Node* node, VoxelNodeData* nodeData, bool viewFrustumChanged, int usecBudget);
+    
+    unsigned char _tempOutputBuffer[MAX_VOXEL_PACKET_SIZE];
+};
+
+#endif // __voxel_server__VoxelSender__
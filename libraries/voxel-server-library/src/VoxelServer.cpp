@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -35,6 +36,7 @@
 #include <sys/time.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <unistd.h>
 #endif
 
 #include "VoxelServer.h"
@@ -84,6 +86,15 @@ VoxelServer::~VoxelServer() {
     }
 }
 
+void VoxelServer::reaverageEditedVoxels() {
+    // senders check this without the lock, the first of them to get the lock does the averaging
+    if (_serverTree.hasPendingReaverage()) {
+        lockTree();
+        _serverTree.reaverageDirtyPaths();
+        unlockTree();
+    }
+}
+
 void VoxelServer::initMongoose(int port) {
     // setup the mongoose web server
     struct mg_callbacks callbacks = {};
@@ -271,7 +282,7 @@ void VoxelServer::run() {
         parsePayload();
     }
 
-    pthread_mutex_init(&_treeLock, NULL);
+    pthread_rwlock_init(&_treeLock, NULL);
     
     qInstallMessageHandler(Logging::verboseMessageHandler);
     
@@ -359,6 +370,12 @@ void VoxelServer::run() {
     _shouldShowAnimationDebug =  getCmdOption(_argc, _argv, WANT_ANIMATION_DEBUG);
     qDebug("shouldShowAnimationDebug=%s\n", debug::valueOf(_shouldShowAnimationDebug));
 
+    // By default edits leave the colors above them to be averaged before the next encode or save, this parameter
+    // makes every edit average them right away
+    const char* EAGER_REAVERAGE = "--eagerReaverage";
+    _serverTree.setLazyReaverage(!getCmdOption(_argc, _argv, EAGER_REAVERAGE));
+    qDebug("lazyReaverage=%s\n", debug::valueOf(_serverTree.getLazyReaverage()));
+
     // By default we will voxel persist, if you want to disable this, then pass in this parameter
     const char* NO_VOXEL_PERSIST = "--NoVoxelPersist";
     if (getCmdOption(_argc, _argv, NO_VOXEL_PERSIST)) {
@@ -425,6 +442,17 @@ void VoxelServer::run() {
     if (_voxelServerPacketProcessor) {
         _voxelServerPacketProcessor->initialize(true);
     }
+    
+    // send to all of the clients from a worker per core, unless told otherwise
+    int numSendThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* SEND_THREADS = "--sendThreads";
+    const char* sendThreads = getCmdOption(_argc, _argv, SEND_THREADS);
+    if (sendThreads) {
+        numSendThreads = atoi(sendThreads);
+    }
+    numSendThreads = std::max(numSendThreads, 1);
+    qDebug("sendThreads=%d\n", numSendThreads);
+    _sendScheduler.start(numSendThreads);
 
     qDebug("Now running...\n");
     
@@ -461,8 +489,8 @@ void VoxelServer::run() {
                     nodeList->updateNodeWithData(node, &senderAddress, packetData, packetLength);
                     
                     VoxelNodeData* nodeData = (VoxelNodeData*) node->getLinkedData();
-                    if (nodeData && !nodeData->isVoxelSendThreadInitalized()) {
-                        nodeData->initializeVoxelSendThread(this);
+                    if (nodeData && !nodeData->isVoxelSenderInitialized()) {
+                        nodeData->initializeVoxelSender(this);
                     }
                 }
             } else if (packetData[0] == PACKET_TYPE_VOXEL_JURISDICTION_REQUEST) {
@@ -482,6 +510,8 @@ void VoxelServer::run() {
         }
     }
     
+    _sendScheduler.stop();
+    
     delete _jurisdiction;
     
     if (_jurisdictionSender) {
@@ -502,7 +532,7 @@ void VoxelServer::run() {
     // tell our NodeList we're done with notifications
     nodeList->removeHook(&_nodeWatcher);
     
-    pthread_mutex_destroy(&_treeLock);
+    pthread_rwlock_destroy(&_treeLock);
 }
 
 
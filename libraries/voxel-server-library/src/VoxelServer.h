@@ -19,8 +19,9 @@
 #include "civetweb.h"
 
 #include "NodeWatcher.h"
+#include "VoxelEditLog.h"
 #include "VoxelPersistThread.h"
-#include "VoxelSendThread.h"
+#include "VoxelSendScheduler.h"
 #include "VoxelServerConsts.h"
 #include "VoxelServerPacketProcessor.h"
 
@@ -47,10 +48,20 @@ public:
     VoxelTree& getServerTree() { return _serverTree; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
     
-    void lockTree() {  pthread_mutex_lock(&_treeLock); }
-    void unlockTree() {  pthread_mutex_unlock(&_treeLock); }
+    /// locks the tree for editing, waiting for any senders encoding from it to finish
+    void lockTree() {  pthread_rwlock_wrlock(&_treeLock); }
+    
+    /// locks the tree for encoding, any number of senders can hold this at once
+    void lockTreeForRead() {  pthread_rwlock_rdlock(&_treeLock); }
+    void unlockTree() {  pthread_rwlock_unlock(&_treeLock); }
+
+    /// averages the colors above the voxels edited since this was last called, before they're encoded or persisted
+    void reaverageEditedVoxels();
     VoxelTree* getTree() { return &_serverTree; }
     
+    VoxelSendScheduler& getSendScheduler() { return _sendScheduler; }
+    VoxelEditLog& getEditLog() { return _editLog; }
+    
     int getPacketsPerClientPerInterval() const { return _packetsPerClientPerInterval; }
     bool getSendMinimalEnvironment() const { return _sendMinimalEnvironment; }
     EnvironmentData* getEnvironmentData(int i) { return &_environmentData[i]; }
@@ -79,7 +90,9 @@ private:
     JurisdictionSender* _jurisdictionSender;
     VoxelServerPacketProcessor* _voxelServerPacketProcessor;
     VoxelPersistThread* _voxelPersistThread;
-    pthread_mutex_t _treeLock;
+    pthread_rwlock_t _treeLock;
+    VoxelSendScheduler _sendScheduler;
+    VoxelEditLog _editLog;
     EnvironmentData _environmentData[3];
     
     NodeWatcher _nodeWatcher; // used to cleanup AGENT data when agents are killed
@@ -24,6 +24,7 @@ const int VOXEL_SEND_INTERVAL_USECS = 17 * 1000; // approximately 60fps
 const int SENDING_TIME_TO_SPARE = 5 * 1000; // usec of sending interval to spare for calculating voxels
 const int INTERVALS_PER_SECOND = 1000 * 1000 / VOXEL_SEND_INTERVAL_USECS;
 const int ENVIRONMENT_SEND_INTERVAL_USECS = 1000000;
+const int PREFETCH_LEAD_USECS = 250 * 1000; // how far past the round trip to predict where a moving client will look
 
 extern const char* LOCAL_VOXELS_PERSIST_FILE;
 extern const char* VOXELS_PERSIST_FILE;
@@ -18,7 +18,27 @@
 
 VoxelServerPacketProcessor::VoxelServerPacketProcessor(VoxelServer* myServer) :
     _myServer(myServer),
-    _receivedPacketCount(0) {
+    _receivedPacketCount(0),
+    _pendingEdits() {
+}
+
+void VoxelServerPacketProcessor::packetsProcessed() {
+    applyPendingEdits();
+}
+
+// the sets from the packets processed so far are applied together, under one write lock of the tree
+void VoxelServerPacketProcessor::applyPendingEdits() {
+    if (_pendingEdits.isEmpty()) {
+        return;
+    }
+    PerformanceWarning warn(_myServer->wantShowAnimationDebug(), "applyPendingEdits()",
+                            _myServer->wantShowAnimationDebug());
+
+    // destructive sets delete voxels, whose delete hooks update the clients' sent state, so like erases these
+    // can't run while the senders are encoding
+    _myServer->lockTree();
+    _pendingEdits.apply(_myServer->getServerTree(), _myServer->getEditLog());
+    _myServer->unlockTree();
 }
 
 
@@ -48,6 +68,7 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
         }
         int atByte = numBytesPacketHeader + sizeof(itemNumber);
         unsigned char* voxelData = (unsigned char*)&packetData[atByte];
+
         while (atByte < packetLength) {
             unsigned char octets = (unsigned char)*voxelData;
             const int COLOR_SIZE_IN_BYTES = 3;
@@ -64,7 +85,11 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
                 delete[] vertices;
             }
         
-            _myServer->getServerTree().readCodeColorBufferToTree(voxelData, destructive);
+            // a batch only holds sets of one size, start another when the size changes
+            if (!_pendingEdits.addEdit(voxelData, destructive)) {
+                applyPendingEdits();
+                _pendingEdits.addEdit(voxelData, destructive);
+            }
             // skip to next
             voxelData += voxelDataSize;
             atByte += voxelDataSize;
@@ -78,11 +103,22 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
 
     } else if (packetData[0] == PACKET_TYPE_ERASE_VOXEL) {
 
+        // sets received before the erase have to be applied before it
+        applyPendingEdits();
+
         // Send these bits off to the VoxelTree class to process them
         _myServer->lockTree();
         _myServer->getServerTree().processRemoveVoxelBitstream((unsigned char*)packetData, packetLength);
         _myServer->unlockTree();
 
+        // the erased voxels are laid out like the set ones, a code and a color for each
+        int atByte = numBytesPacketHeader + sizeof(short int);
+        while (atByte < packetLength) {
+            unsigned char* voxelCode = (unsigned char*) &packetData[atByte];
+            _myServer->getEditLog().editApplied(voxelCode);
+            atByte += bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(voxelCode)) + SIZE_OF_COLOR_DATA;
+        }
+
         // Make sure our Node and NodeList knows we've heard from this node.
         Node* node = NodeList::getInstance()->nodeWithAddress(&senderAddress);
         if (node) {
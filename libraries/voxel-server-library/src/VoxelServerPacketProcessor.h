@@ -12,6 +12,9 @@
 #define __voxel_server__VoxelServerPacketProcessor__
 
 #include <ReceivedPacketProcessor.h>
+
+#include "VoxelEditBatch.h"
+
 class VoxelServer;
 
 /// Handles processing of incoming network packets for the voxel-server. As with other ReceivedPacketProcessor classes 
@@ -23,9 +26,13 @@ public:
 
 protected:
     virtual void processPacket(sockaddr& senderAddress, unsigned char*  packetData, ssize_t packetLength);
+    virtual void packetsProcessed();
 
 private:
+    void applyPendingEdits();
+
     VoxelServer* _myServer;
     int _receivedPacketCount;
+    VoxelEditBatch _pendingEdits;
 };
 #endif // __voxel_server__VoxelServerPacketProcessor__
@@ -0,0 +1,114 @@
+//
+//  VoxelViewPredictor.cpp
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Extrapolates a client's camera from the poses in its recent queries
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include <SharedUtil.h>
+
+#include "VoxelViewPredictor.h"
+
+// how much each query's motion counts towards the smoothed velocities, the rest is the motion before it
+const float VELOCITY_SMOOTHING = 0.5f;
+
+// queries further apart than this don't say how fast the camera is moving, it was probably teleported or stalled
+const uint64_t MAX_POSE_INTERVAL_USECS = 1000 * 1000;
+
+// a camera slower than this is standing still, anything it sees is already in its view
+const float MIN_MOVING_SPEED = 0.1f; // meters per second
+const float MIN_TURNING_SPEED = 5.0f * PI_OVER_180; // radians per second
+
+// at most this far ahead, or a turn predicted past half a turn would wrap back around
+const uint64_t MAX_PREDICTION_USECS = 1000 * 1000;
+const float MAX_PREDICTED_TURN = 90.0f * PI_OVER_180;
+
+VoxelViewPredictor::VoxelViewPredictor() :
+    _hasPose(false),
+    _lastPoseTime(0),
+    _lastPosition(0.0f, 0.0f, 0.0f),
+    _lastOrientation(),
+    _velocity(0.0f, 0.0f, 0.0f),
+    _angularVelocity(0.0f, 0.0f, 0.0f)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+VoxelViewPredictor::~VoxelViewPredictor() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+void VoxelViewPredictor::poseReceived(const glm::vec3& position, const glm::quat& orientation) {
+    uint64_t now = usecTimestampNow();
+
+    pthread_mutex_lock(&_mutex);
+
+    uint64_t sinceLastPose = now - _lastPoseTime;
+    if (!_hasPose || sinceLastPose > MAX_POSE_INTERVAL_USECS) {
+        _velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+        _angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    } else if (sinceLastPose > 0) {
+        float seconds = sinceLastPose / 1000000.0f;
+        glm::vec3 velocity = (position - _lastPosition) / seconds;
+
+        // the rotation from the last orientation to this one, the short way around
+        glm::quat turn = orientation * glm::inverse(_lastOrientation);
+        if (turn.w < 0.0f) {
+            turn = glm::quat(-turn.w, -turn.x, -turn.y, -turn.z);
+        }
+        glm::vec3 turnAxis(turn.x, turn.y, turn.z);
+        float halfAngleSine = glm::length(turnAxis);
+        glm::vec3 angularVelocity(0.0f, 0.0f, 0.0f);
+        if (halfAngleSine > EPSILON) {
+            float angle = 2.0f * atan2f(halfAngleSine, turn.w);
+            angularVelocity = turnAxis * (angle / (halfAngleSine * seconds));
+        }
+
+        _velocity = glm::mix(_velocity, velocity, VELOCITY_SMOOTHING);
+        _angularVelocity = glm::mix(_angularVelocity, angularVelocity, VELOCITY_SMOOTHING);
+    }
+
+    _hasPose = true;
+    _lastPoseTime = now;
+    _lastPosition = position;
+    _lastOrientation = orientation;
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+bool VoxelViewPredictor::isMoving() const {
+    pthread_mutex_lock(&_mutex);
+    bool isMoving = _hasPose && usecTimestampNow() - _lastPoseTime <= MAX_POSE_INTERVAL_USECS
+        && (glm::length(_velocity) >= MIN_MOVING_SPEED || glm::length(_angularVelocity) >= MIN_TURNING_SPEED);
+    pthread_mutex_unlock(&_mutex);
+    return isMoving;
+}
+
+void VoxelViewPredictor::predictPose(uint64_t usecsAhead, glm::vec3& position, glm::quat& orientation) const {
+    pthread_mutex_lock(&_mutex);
+
+    // predict from the last pose we heard of, which is already a little behind now
+    uint64_t now = usecTimestampNow();
+    uint64_t sinceLastPose = now > _lastPoseTime ? now - _lastPoseTime : 0;
+    float seconds = std::min(usecsAhead + sinceLastPose, MAX_PREDICTION_USECS) / 1000000.0f;
+
+    position = _lastPosition + _velocity * seconds;
+
+    float turningSpeed = glm::length(_angularVelocity);
+    float turnAngle = std::min(turningSpeed * seconds, MAX_PREDICTED_TURN);
+    if (turnAngle > EPSILON) {
+        // glm's rotate takes degrees
+        glm::quat turn = glm::rotate(glm::quat(), turnAngle / PI_OVER_180, _angularVelocity / turningSpeed);
+        orientation = turn * _lastOrientation;
+    } else {
+        orientation = _lastOrientation;
+    }
+
+    pthread_mutex_unlock(&_mutex);
+}
@@ -0,0 +1,52 @@
+//
+//  VoxelViewPredictor.h
+//  voxel-server
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Extrapolates a client's camera from the poses in its recent queries
+//
+
+#ifndef __voxel_server__VoxelViewPredictor__
+#define __voxel_server__VoxelViewPredictor__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/// Tracks how fast a client's camera is moving and turning from the poses in the queries it sends, smoothing over the
+/// jitter between queries, so the server can send voxels for where the camera will be a round trip from now. The
+/// queries arrive on the network thread and the predictions are made on the send workers.
+class VoxelViewPredictor {
+public:
+    VoxelViewPredictor();
+    ~VoxelViewPredictor();
+
+    /// records the camera pose of a query received now
+    void poseReceived(const glm::vec3& position, const glm::quat& orientation);
+
+    /// true if the camera was moving or turning as of its last query, and that query is recent
+    bool isMoving() const;
+
+    /// the pose the camera will have usecsAhead from now if it keeps moving and turning as it has been
+    void predictPose(uint64_t usecsAhead, glm::vec3& position, glm::quat& orientation) const;
+
+private:
+    // not copyable, it owns a mutex
+    VoxelViewPredictor(const VoxelViewPredictor&);
+    VoxelViewPredictor& operator=(const VoxelViewPredictor&);
+
+    mutable pthread_mutex_t _mutex;
+
+    bool _hasPose;
+    uint64_t _lastPoseTime;
+    glm::vec3 _lastPosition;
+    glm::quat _lastOrientation;
+
+    glm::vec3 _velocity; // meters per second
+    glm::vec3 _angularVelocity; // axis scaled by radians per second
+};
+
+#endif // __voxel_server__VoxelViewPredictor__
@@ -26,10 +26,11 @@ JurisdictionMap& JurisdictionMap::operator=(const JurisdictionMap& other) {
 
 #ifdef HAS_MOVE_SEMANTICS
 // Move constructor
-JurisdictionMap::JurisdictionMap(JurisdictionMap&& other) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(JurisdictionMap&& other) : _rootOctalCode(NULL), _hasMortonKeys(false) {
     init(other._rootOctalCode, other._endNodes);
     other._rootOctalCode = NULL;
     other._endNodes.clear();
+    other.updateMortonKeys();
 }
 
 // move assignment
@@ -37,12 +38,13 @@ JurisdictionMap& JurisdictionMap::operator=(JurisdictionMap&& other) {
     init(other._rootOctalCode, other._endNodes);
     other._rootOctalCode = NULL;
     other._endNodes.clear();
+    other.updateMortonKeys();
     return *this;
 }
 #endif
 
 // Copy constructor
-JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL), _hasMortonKeys(false) {
     copyContents(other);
 }
 
@@ -89,9 +91,10 @@ void JurisdictionMap::clear() {
         }
     }
     _endNodes.clear();
+    updateMortonKeys();
 }
 
-JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL), _hasMortonKeys(false) {
     unsigned char* rootCode = new unsigned char[1];
     *rootCode = 0;
     
@@ -99,17 +102,17 @@ JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL) {
     init(rootCode, emptyEndNodes);
 }
 
-JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL), _hasMortonKeys(false) {
     clear(); // clean up our own memory
     readFromFile(filename);
 }
 
 JurisdictionMap::JurisdictionMap(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes)  
-    : _rootOctalCode(NULL) {
+    : _rootOctalCode(NULL), _hasMortonKeys(false) {
     init(rootOctalCode, endNodes);
 }
 
-JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) {
+JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) : _hasMortonKeys(false) {
     _rootOctalCode = hexStringToOctalCode(QString(rootHexCode));
     
     QString endNodesHexStrings(endNodesHexCodes);
@@ -123,6 +126,7 @@ JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHe
         //printOctalCode(endNodeOctcode);
         _endNodes.push_back(endNodeOctcode);
     }    
+    updateMortonKeys();
 }
 
 
@@ -130,6 +134,28 @@ void JurisdictionMap::init(unsigned char* rootOctalCode, const std::vector<unsig
     clear(); // clean up our own memory
     _rootOctalCode = rootOctalCode;
     _endNodes = endNodes;
+    updateMortonKeys();
+}
+
+void JurisdictionMap::updateMortonKeys() {
+    _hasMortonKeys = false;
+    _endNodeMortonKeys.clear();
+    if (!_rootOctalCode) {
+        return;
+    }
+    _rootMortonKey = mortonKeyForOctalCode(_rootOctalCode);
+    if (!isValidMortonKey(_rootMortonKey)) {
+        return;
+    }
+    for (int i = 0; i < _endNodes.size(); i++) {
+        MortonKey endNodeMortonKey = _endNodes[i] ? mortonKeyForOctalCode(_endNodes[i]) : INVALID_MORTON_KEY;
+        if (!isValidMortonKey(endNodeMortonKey)) {
+            _endNodeMortonKeys.clear();
+            return;
+        }
+        _endNodeMortonKeys.push_back(endNodeMortonKey);
+    }
+    _hasMortonKeys = true;
 }
 
 JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const unsigned char* nodeOctalCode, int childIndex) const {
@@ -155,6 +181,28 @@ JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const unsigned char* nod
     return isInJurisdiction ? WITHIN : BELOW;
 }
 
+JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const VoxelNode* node, int childIndex) const {
+    MortonKey nodeMortonKey = node->getMortonKey();
+    if (!_hasMortonKeys || !isValidMortonKey(nodeMortonKey)) {
+        return isMyJurisdiction(node->getOctalCode(), childIndex);
+    }
+    
+    // the child doesn't change the answer, below the root's ancestors a node and its children are either all under the
+    // root or none of them are
+    if (isMortonKeyAncestorOf(nodeMortonKey, _rootMortonKey)) {
+        return ABOVE;
+    }
+    if (!isMortonKeyAncestorOf(_rootMortonKey, nodeMortonKey)) {
+        return BELOW;
+    }
+    for (int i = 0; i < _endNodeMortonKeys.size(); i++) {
+        if (isMortonKeyAncestorOf(_endNodeMortonKeys[i], nodeMortonKey)) {
+            return BELOW;
+        }
+    }
+    return WITHIN;
+}
+
 
 bool JurisdictionMap::readFromFile(const char* filename) {
     QString     settingsFile(filename);
@@ -179,6 +227,7 @@ bool JurisdictionMap::readFromFile(const char* filename) {
         _endNodes.push_back(octcode);
     }
     settings.endGroup();
+    updateMortonKeys();
     return true;
 }
 
@@ -301,6 +350,7 @@ int JurisdictionMap::unpackFromMessage(unsigned char* sourceBuffer, int availabl
             }
         }
     }
+    updateMortonKeys();
     
     return sourceBuffer - startPosition; // includes header!
 }
@@ -16,6 +16,10 @@
 #include <QtCore/QString>
 #include <QtCore/QUuid>
 
+#include <MortonKey.h>
+
+class VoxelNode;
+
 class JurisdictionMap {
 public:
     enum Area {
@@ -44,6 +48,10 @@ public:
     ~JurisdictionMap();
 
     Area isMyJurisdiction(const unsigned char* nodeOctalCode, int childIndex) const;
+    
+    /// same as isMyJurisdiction() of the node's octal code, but compares MortonKeys when the node and the jurisdiction
+    /// have them, for the encoder which asks for every node it visits
+    Area isMyJurisdiction(const VoxelNode* node, int childIndex) const;
 
     bool writeToFile(const char* filename);
     bool readFromFile(const char* filename);
@@ -66,9 +74,15 @@ private:
     void copyContents(const JurisdictionMap& other); // use assignment instead
     void clear();
     void init(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes);
+    void updateMortonKeys();
 
     unsigned char* _rootOctalCode;
     std::vector<unsigned char*> _endNodes;
+
+    // the root and end nodes as keys, only used if all of them fit in one
+    bool _hasMortonKeys;
+    MortonKey _rootMortonKey;
+    std::vector<MortonKey> _endNodeMortonKeys;
 };
 
 /// Map between node IDs and their reported JurisdictionMap. Typically used by classes that need to know which nodes are 
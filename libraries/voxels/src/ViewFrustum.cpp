@@ -298,6 +298,84 @@ ViewFrustum::location ViewFrustum::boxInFrustum(const AABox& box) const {
     return regularResult;
 }
 
+// Each step is done for all eight children in arrays of one value per child, which the compiler can vectorize. The
+// children's corners are offset from the box's by exact powers of two, so they match the children's own boxes.
+void ViewFrustum::childrenInFrustum(const AABox& box, ChildrenLocations& locations) const {
+    float childScale = box.getScale() * 0.5f;
+    const glm::vec3& corner = box.getCorner();
+    float cornerX[NUMBER_OF_CHILDREN];
+    float cornerY[NUMBER_OF_CHILDREN];
+    float cornerZ[NUMBER_OF_CHILDREN];
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        cornerX[i] = corner.x + childScale * ((i >> 2) & 1);
+        cornerY[i] = corner.y + childScale * ((i >> 1) & 1);
+        cornerZ[i] = corner.z + childScale * (i & 1);
+    }
+
+    float halfChildScale = childScale * 0.5f;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        float x = _position.x - (cornerX[i] + halfChildScale);
+        float y = _position.y - (cornerY[i] + halfChildScale);
+        float z = _position.z - (cornerZ[i] + halfChildScale);
+        locations.distances[i] = sqrtf(x * x + y * y + z * z);
+    }
+
+    // the regular frustum, a child is outside if its vertexP is behind any plane, and intersects if any vertexN is
+    int outsidePlanes[NUMBER_OF_CHILDREN] = { 0 };
+    int intersectPlanes[NUMBER_OF_CHILDREN] = { 0 };
+    for (int plane = 0; plane < 6; plane++) {
+        const glm::vec3& normal = _planes[plane].getNormal();
+        float dCoefficient = _planes[plane].getDCoefficient();
+        float offsetPX = normal.x > 0 ? childScale : 0.0f;
+        float offsetPY = normal.y > 0 ? childScale : 0.0f;
+        float offsetPZ = normal.z > 0 ? childScale : 0.0f;
+        float offsetNX = normal.x < 0 ? childScale : 0.0f;
+        float offsetNY = normal.y < 0 ? childScale : 0.0f;
+        float offsetNZ = normal.z < 0 ? childScale : 0.0f;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            float distanceP = dCoefficient + (normal.x * (cornerX[i] + offsetPX) + normal.y * (cornerY[i] + offsetPY)
+                                              + normal.z * (cornerZ[i] + offsetPZ));
+            float distanceN = dCoefficient + (normal.x * (cornerX[i] + offsetNX) + normal.y * (cornerY[i] + offsetNY)
+                                              + normal.z * (cornerZ[i] + offsetNZ));
+            outsidePlanes[i] |= (distanceP < 0);
+            intersectPlanes[i] |= (distanceN < 0);
+        }
+    }
+
+    // the keyhole, only the children inside its bounding box can touch it, and few do
+    int inKeyhole[NUMBER_OF_CHILDREN] = { 0 };
+    if (_keyholeRadius >= 0.0f) {
+        const glm::vec3& keyholeCorner = _keyholeBoundingBox.getCorner();
+        glm::vec3 keyholeFarCorner = keyholeCorner + _keyholeBoundingBox.getScale();
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            if (cornerX[i] >= keyholeCorner.x && cornerX[i] + childScale <= keyholeFarCorner.x &&
+                cornerY[i] >= keyholeCorner.y && cornerY[i] + childScale <= keyholeFarCorner.y &&
+                cornerZ[i] >= keyholeCorner.z && cornerZ[i] + childScale <= keyholeFarCorner.z) {
+                inKeyhole[i] = boxInKeyhole(AABox(glm::vec3(cornerX[i], cornerY[i], cornerZ[i]), childScale));
+            }
+        }
+    }
+
+    // as in boxInFrustum(), inside the keyhole wins, and outside the regular frustum leaves what the keyhole says
+    locations.insideMask = 0;
+    locations.intersectMask = 0;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        ViewFrustum::location location;
+        if (inKeyhole[i] == INSIDE) {
+            location = INSIDE;
+        } else if (outsidePlanes[i]) {
+            location = (ViewFrustum::location)inKeyhole[i];
+        } else {
+            location = intersectPlanes[i] ? INTERSECT : INSIDE;
+        }
+        if (location == INSIDE) {
+            locations.insideMask |= (1 << i);
+        } else if (location == INTERSECT) {
+            locations.intersectMask |= (1 << i);
+        }
+    }
+}
+
 bool testMatches(glm::quat lhs, glm::quat rhs, float epsilon = EPSILON) {
     return (fabs(lhs.x - rhs.x) <= epsilon && fabs(lhs.y - rhs.y) <= epsilon && fabs(lhs.z - rhs.z) <= epsilon
             && fabs(lhs.w - rhs.w) <= epsilon);
@@ -17,10 +17,13 @@
 #include "AABox.h"
 #include "Plane.h"
 
+#include "VoxelConstants.h"
 #include "VoxelProjectedPolygon.h"
 
 const float DEFAULT_KEYHOLE_RADIUS = 3.0f;
 
+class ChildrenLocations;
+
 class ViewFrustum {
 public:
     // setters for camera attributes
@@ -80,6 +83,10 @@ public:
     ViewFrustum::location pointInFrustum(const glm::vec3& point) const;
     ViewFrustum::location sphereInFrustum(const glm::vec3& center, float radius) const;
     ViewFrustum::location boxInFrustum(const AABox& box) const;
+
+    /// Locates the eight children of the box at once, giving the same locations as boxInFrustum() and the same
+    /// distances as VoxelNode::distanceToCamera() would for each of them
+    void childrenInFrustum(const AABox& box, ChildrenLocations& locations) const;
     
     // some frustum comparisons
     bool matches(const ViewFrustum& compareTo, bool debug = false) const;
@@ -150,5 +157,19 @@ private:
     glm::mat4 _ourModelViewProjectionMatrix;
 };
 
+/// Where the eight children of a box are in a view frustum, as masks with bit (1 << childIndex) set for each child
+class ChildrenLocations {
+public:
+    ViewFrustum::location getLocation(int childIndex) const {
+        return (insideMask & (1 << childIndex)) ? ViewFrustum::INSIDE :
+            ((intersectMask & (1 << childIndex)) ? ViewFrustum::INTERSECT : ViewFrustum::OUTSIDE);
+    }
+    bool isInView(int childIndex) const { return (insideMask | intersectMask) & (1 << childIndex); }
+
+    unsigned char insideMask;
+    unsigned char intersectMask; // the children in neither mask are outside
+    float distances[NUMBER_OF_CHILDREN]; // from the camera to each child's center
+};
+
 
 #endif /* defined(__hifi__ViewFrustum__) */
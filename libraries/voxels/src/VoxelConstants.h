@@ -29,6 +29,11 @@ const int   TREE_SCALE = 16384; // ~10 miles.. This is the number of meters of t
 // This controls the LOD. Larger number will make smaller voxels visible at greater distance.
 const float VOXEL_SIZE_SCALE = TREE_SCALE * 400.0f; 
 
+// The screen VOXEL_SIZE_SCALE was tuned on, other screens scale the boundaries to keep voxels the same size in pixels
+const int   REFERENCE_LOD_SCREEN_HEIGHT = 1080;
+const float REFERENCE_LOD_FIELD_OF_VIEW = 90.0f; // degrees
+const float DEFAULT_LOD_SCALE = 1.0f; // scales the distances to the render level boundaries, larger for more detail
+
 const int NUMBER_OF_CHILDREN = 8;
 const int MAX_VOXEL_PACKET_SIZE = 1492;
 const int MAX_TREE_SLICE_BYTES = 26;
@@ -60,4 +65,6 @@ const int DANGEROUSLY_DEEP_RECURSION = 200; // use this for something that needs
 
 const int DEFAULT_MAX_VOXEL_PPS = 600; // the default maximum PPS we think a voxel server should send to a client
 
+typedef uint16_t VOXEL_PACKET_SEQUENCE; // follows the header of voxel data packets, acknowledged by the client's query
+
 #endif
\ No newline at end of file
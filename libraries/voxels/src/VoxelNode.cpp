@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <stdio.h>
@@ -43,6 +44,25 @@ VoxelNode::VoxelNode(unsigned char * octalCode) {
     _voxelNodeLeafCount++; // all nodes start as leaf nodes
 }
 
+VoxelNode::VoxelNode(MortonKey mortonKey) {
+    unsigned char octalCode[MAX_MORTON_KEY_OCTAL_CODE_BYTES];
+    int octalCodeLength = octalCodeForMortonKey(mortonKey, octalCode);
+    if (octalCodeLength > sizeof(_octalCode)) {
+        _octalCode.pointer = new unsigned char[octalCodeLength];
+        memcpy(_octalCode.pointer, octalCode, octalCodeLength);
+        _octcodePointer = true;
+        _octcodeMemoryUsage += octalCodeLength;
+    } else {
+        _octcodePointer = false;
+        memcpy(_octalCode.buffer, octalCode, octalCodeLength);
+    }
+    _mortonKey = mortonKey;
+    initMembers();
+
+    _voxelNodeCount++;
+    _voxelNodeLeafCount++; // all nodes start as leaf nodes
+}
+
 void VoxelNode::init(unsigned char * octalCode) {
     int octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
@@ -54,7 +74,11 @@ void VoxelNode::init(unsigned char * octalCode) {
         memcpy(_octalCode.buffer, octalCode, octalCodeLength);
         delete[] octalCode;
     }
-    
+    _mortonKey = mortonKeyForOctalCode(getOctalCode());
+    initMembers();
+}
+
+void VoxelNode::initMembers() {
 #ifndef NO_FALSE_COLOR // !NO_FALSE_COLOR means, does have false color
     _falseColored = false; // assume true color
     _currentColor[0] = _currentColor[1] = _currentColor[2] = _currentColor[3] = 0;
@@ -65,6 +89,7 @@ void VoxelNode::init(unsigned char * octalCode) {
     // set up the _children union
     _childBitmask = 0;
     _childrenExternal = false;
+    _needsReaverage = false;
 
 #ifdef BLENDED_UNION_CHILDREN
     _children.external = NULL;
@@ -135,7 +160,13 @@ void VoxelNode::markWithChangedTime() {
 void VoxelNode::handleSubtreeChanged(VoxelTree* myTree) {
     // here's a good place to do color re-averaging...
     if (myTree->getShouldReaverage()) {
-        setColorFromAverageOfChildren();
+        if (myTree->getLazyReaverage()) {
+            // the tree averages each changed node once, when it's next read
+            _needsReaverage = true;
+            myTree->reaverageNeeded();
+        } else {
+            setColorFromAverageOfChildren();
+        }
     }
     
     markWithChangedTime();
@@ -233,12 +264,18 @@ void VoxelNode::setShouldRender(bool shouldRender) {
 
 void VoxelNode::calculateAABox() {
     glm::vec3 corner;
+    float voxelScale;
     
-    // copy corner into box
-    copyFirstVertexForCode(getOctalCode(),(float*)&corner);
+    if (isValidMortonKey(_mortonKey)) {
+        copyFirstVertexForMortonKey(_mortonKey, (float*)&corner);
+        voxelScale = mortonKeyScale(_mortonKey);
+    } else {
+        // copy corner into box
+        copyFirstVertexForCode(getOctalCode(),(float*)&corner);
     
-    // this tells you the "size" of the voxel
-    float voxelScale = 1 / powf(2, numberOfThreeBitSectionsInCode(getOctalCode()));
+        // this tells you the "size" of the voxel
+        voxelScale = 1 / powf(2, numberOfThreeBitSectionsInCode(getOctalCode()));
+    }
     _box.setBox(corner,voxelScale);
 }
 
@@ -1152,7 +1189,11 @@ VoxelNode* VoxelNode::addChildAtIndex(int childIndex) {
             _voxelNodeLeafCount--;
         }
     
-        childAt = new VoxelNode(childOctalCode(getOctalCode(), childIndex));
+        if (isValidMortonKey(_mortonKey) && mortonKeyDepth(_mortonKey) < MAX_MORTON_KEY_DEPTH) {
+            childAt = new VoxelNode(mortonKeyChild(_mortonKey, childIndex));
+        } else {
+            childAt = new VoxelNode(childOctalCode(getOctalCode(), childIndex));
+        }
         childAt->setVoxelSystem(getVoxelSystem()); // our child is always part of our voxel system NULL ok
         setChildAtIndex(childIndex, childAt);
 
@@ -1270,47 +1311,41 @@ void VoxelNode::setColor(const nodeColor& color) {
 
 
 
-// will detect if children are leaves AND the same color
-// and in that case will delete the children and make this node
-// a leaf, returns TRUE if all the leaves are collapsed into a 
-// single node
-bool VoxelNode::collapseIdenticalLeaves() {
+bool VoxelNode::hasIdenticalLeafChildren() const {
     // scan children, verify that they are ALL present and accounted for
-    bool allChildrenMatch = true; // assume the best (ottimista)
-    int red,green,blue;
+    const unsigned char* firstColor = NULL;
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         VoxelNode* childAt = getChildAtIndex(i);
         // if no child, child isn't a leaf, or child doesn't have a color
         if (!childAt || !childAt->isLeaf() || !childAt->isColored()) {
-            allChildrenMatch=false;
-            //qDebug("SADNESS child missing or not colored! i=%d\n",i);
-            break;
-        } else {
-            if (i==0) {
-                red   = childAt->getColor()[0];
-                green = childAt->getColor()[1];
-                blue  = childAt->getColor()[2];
-            } else if (red != childAt->getColor()[0] || 
-                    green != childAt->getColor()[1] || blue != childAt->getColor()[2]) {
-                allChildrenMatch=false;
-                break;
-            }
+            return false;
+        }
+        if (i == 0) {
+            firstColor = childAt->getColor();
+        } else if (firstColor[0] != childAt->getColor()[0] ||
+                firstColor[1] != childAt->getColor()[1] || firstColor[2] != childAt->getColor()[2]) {
+            return false;
         }
     }
-    
-    
+    return true;
+}
+
+// will detect if children are leaves AND the same color
+// and in that case will delete the children and make this node
+// a leaf, returns TRUE if all the leaves are collapsed into a 
+// single node
+bool VoxelNode::collapseIdenticalLeaves() {
+    bool allChildrenMatch = hasIdenticalLeafChildren();
     if (allChildrenMatch) {
         //qDebug("allChildrenMatch: pruning tree\n");
+        nodeColor collapsedColor;
+        memcpy(collapsedColor, getChildAtIndex(0)->getColor(), sizeof(rgbColor));
+        collapsedColor[3]=1;    // color is set
         for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
             VoxelNode* childAt = getChildAtIndex(i);
             delete childAt; // delete all the child nodes
             setChildAtIndex(i, NULL); // set it to NULL
         }
-        nodeColor collapsedColor;
-        collapsedColor[0]=red;        
-        collapsedColor[1]=green;        
-        collapsedColor[2]=blue;        
-        collapsedColor[3]=1;    // color is set
         setColor(collapsedColor);
     }
     return allChildrenMatch;
@@ -1371,12 +1406,12 @@ ViewFrustum::location VoxelNode::inFrustum(const ViewFrustum& viewFrustum) const
 //    Since, if we know the camera position and orientation, we can know which of the corners is the "furthest" 
 //    corner. We can use we can use this corner as our "voxel position" to do our distance calculations off of.
 //    By doing this, we don't need to test each child voxel's position vs the LOD boundary
-bool VoxelNode::calculateShouldRender(const ViewFrustum* viewFrustum, int boundaryLevelAdjust) const {
+bool VoxelNode::calculateShouldRender(const ViewFrustum* viewFrustum, int boundaryLevelAdjust, float lodScale) const {
     bool shouldRender = false;
     if (isColored()) {
         float furthestDistance = furthestDistanceToCamera(*viewFrustum);
-        float boundary         = boundaryDistanceForRenderLevel(getLevel() + boundaryLevelAdjust);
-        float childBoundary    = boundaryDistanceForRenderLevel(getLevel() + 1 + boundaryLevelAdjust);
+        float boundary         = boundaryDistanceForRenderLevel(getLevel() + boundaryLevelAdjust, lodScale);
+        float childBoundary    = boundaryDistanceForRenderLevel(getLevel() + 1 + boundaryLevelAdjust, lodScale);
         bool  inBoundary       = (furthestDistance <= boundary);
         bool  inChildBoundary  = (furthestDistance <= childBoundary);
         shouldRender = (isLeaf() && inChildBoundary) || (inBoundary && !inChildBoundary);
@@ -1394,6 +1429,12 @@ float VoxelNode::furthestDistanceToCamera(const ViewFrustum& viewFrustum) const
     return distanceToVoxelCenter;
 }
 
+void VoxelNode::childrenInFrustum(const ViewFrustum& viewFrustum, ChildrenLocations& locations) const {
+    AABox box = _box; // use temporary box so we can scale it
+    box.scale(TREE_SCALE);
+    viewFrustum.childrenInFrustum(box, locations);
+}
+
 float VoxelNode::distanceToCamera(const ViewFrustum& viewFrustum) const {
     glm::vec3 center = _box.calcCenter() * (float)TREE_SCALE;
     glm::vec3 temp = viewFrustum.getPosition() - center;
@@ -1401,6 +1442,11 @@ float VoxelNode::distanceToCamera(const ViewFrustum& viewFrustum) const {
     return distanceToVoxelCenter;
 }
 
+float VoxelNode::projectedSize(const ViewFrustum& viewFrustum) const {
+    float size = getScale() * TREE_SCALE;
+    return size / std::max(size, distanceToCamera(viewFrustum));
+}
+
 float VoxelNode::distanceSquareToPoint(const glm::vec3& point) const {
     glm::vec3 temp = point - _box.calcCenter();
     float distanceSquare = glm::dot(temp, temp);
@@ -1414,24 +1460,33 @@ float VoxelNode::distanceToPoint(const glm::vec3& point) const {
 }
 
 std::vector<VoxelNodeDeleteHook*> VoxelNode::_deleteHooks;
+pthread_mutex_t VoxelNode::_deleteHooksLock = PTHREAD_MUTEX_INITIALIZER;
 
 void VoxelNode::addDeleteHook(VoxelNodeDeleteHook* hook) {
+    pthread_mutex_lock(&_deleteHooksLock);
     _deleteHooks.push_back(hook);
+    pthread_mutex_unlock(&_deleteHooksLock);
 }
 
 void VoxelNode::removeDeleteHook(VoxelNodeDeleteHook* hook) {
+    // waits for any notification in progress, so the hook isn't called once its owner goes on to delete it
+    pthread_mutex_lock(&_deleteHooksLock);
     for (int i = 0; i < _deleteHooks.size(); i++) {
         if (_deleteHooks[i] == hook) {
             _deleteHooks.erase(_deleteHooks.begin() + i);
-            return;
+            break;
         }
     }
+    pthread_mutex_unlock(&_deleteHooksLock);
 }
 
 void VoxelNode::notifyDeleteHooks() {
+    // the hooks only update their own records, they don't delete nodes or add or remove hooks while we hold the lock
+    pthread_mutex_lock(&_deleteHooksLock);
     for (int i = 0; i < _deleteHooks.size(); i++) {
         _deleteHooks[i]->voxelDeleted(this);
     }
+    pthread_mutex_unlock(&_deleteHooksLock);
 }
 
 std::vector<VoxelNodeUpdateHook*> VoxelNode::_updateHooks;
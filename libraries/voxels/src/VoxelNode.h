@@ -13,6 +13,9 @@
 //#define SIMPLE_CHILD_ARRAY
 #define SIMPLE_EXTERNAL_CHILDREN
 
+#include <pthread.h>
+
+#include <MortonKey.h>
 #include <SharedUtil.h>
 #include "AABox.h"
 #include "ViewFrustum.h"
@@ -26,7 +29,9 @@ typedef unsigned char colorPart;
 typedef unsigned char nodeColor[4];
 typedef unsigned char rgbColor[3];
 
-// Callers who want delete hook callbacks should implement this class
+// Callers who want delete hook callbacks should implement this class. Nodes are deleted on whichever thread edits
+// the tree, so voxelDeleted() can be called on another thread than the one that added the hook, but never after
+// removeDeleteHook() has returned.
 class VoxelNodeDeleteHook {
 public:
     virtual void voxelDeleted(VoxelNode* node) = 0;
@@ -43,9 +48,13 @@ class VoxelNode {
 public:
     VoxelNode(); // root node constructor
     VoxelNode(unsigned char * octalCode); // regular constructor
+    VoxelNode(MortonKey mortonKey); // constructor for nodes whose octal code fits in a key, no octal code to allocate
     ~VoxelNode();
     
     const unsigned char* getOctalCode() const { return (_octcodePointer) ? _octalCode.pointer : &_octalCode.buffer[0]; }
+    
+    /// the node's octal code as a MortonKey, INVALID_MORTON_KEY for nodes deeper than MAX_MORTON_KEY_DEPTH
+    MortonKey getMortonKey() const { return _mortonKey; }
     VoxelNode* getChildAtIndex(int childIndex) const;
     void deleteChildAtIndex(int childIndex);
     VoxelNode* removeChildAtIndex(int childIndex);
@@ -55,11 +64,13 @@ public:
     void setColorFromAverageOfChildren();
     void setRandomColor(int minimumBrightness);
     bool collapseIdenticalLeaves();
+    bool hasIdenticalLeafChildren() const; // true if collapseIdenticalLeaves() would collapse the children
 
     const AABox& getAABox() const { return _box; }
     const glm::vec3& getCorner() const { return _box.getCorner(); }
     float getScale() const { return _box.getScale(); }
-    int getLevel() const { return numberOfThreeBitSectionsInCode(getOctalCode()) + 1; }
+    int getLevel() const { return isValidMortonKey(_mortonKey) ? mortonKeyDepth(_mortonKey) + 1
+                                                               : numberOfThreeBitSectionsInCode(getOctalCode()) + 1; }
     
     float getEnclosingRadius() const;
     
@@ -69,7 +80,15 @@ public:
     float distanceToCamera(const ViewFrustum& viewFrustum) const; 
     float furthestDistanceToCamera(const ViewFrustum& viewFrustum) const;
 
-    bool calculateShouldRender(const ViewFrustum* viewFrustum, int boundaryLevelAdjust = 0) const;
+    /// the voxel's size over its distance from the camera, how much of the screen it covers, at most 1 with the camera
+    /// inside it
+    float projectedSize(const ViewFrustum& viewFrustum) const;
+
+    /// locates all eight of the children this node can have in the view, see ViewFrustum::childrenInFrustum()
+    void childrenInFrustum(const ViewFrustum& viewFrustum, ChildrenLocations& locations) const;
+
+    bool calculateShouldRender(const ViewFrustum* viewFrustum, int boundaryLevelAdjust = 0,
+                               float lodScale = DEFAULT_LOD_SCALE) const;
     
     // points are assumed to be in Voxel Coordinates (not TREE_SCALE'd)
     float distanceSquareToPoint(const glm::vec3& point) const; // when you don't need the actual distance, use this.
@@ -85,6 +104,8 @@ public:
     void markWithChangedTime();
     uint64_t getLastChanged() const { return _lastChanged; }
     void handleSubtreeChanged(VoxelTree* myTree);
+    bool needsReaverage() const { return _needsReaverage; }
+    void clearNeedsReaverage() { _needsReaverage = false; }
     
     glBufferIndex getBufferIndex() const { return _glBufferIndex; }
     bool isKnownBufferIndex() const { return !_unknownBufferIndex; }
@@ -117,6 +138,7 @@ public:
 
     static void addUpdateHook(VoxelNodeUpdateHook* hook);
     static void removeUpdateHook(VoxelNodeUpdateHook* hook);
+    static bool hasUpdateHooks() { return !_updateHooks.empty(); }
     
     static unsigned long getNodeCount() { return _voxelNodeCount; }
     static unsigned long getInternalNodeCount() { return _voxelNodeCount - _voxelNodeLeafCount; }
@@ -166,6 +188,7 @@ private:
 #endif
     void calculateAABox();
     void init(unsigned char * octalCode);
+    void initMembers();
     void notifyDeleteHooks();
     void notifyUpdateHooks();
 
@@ -177,6 +200,8 @@ private:
       unsigned char* pointer;
     } _octalCode;  
 
+    MortonKey _mortonKey; /// Client and server, the octal code as a key for nodes no deeper than 21 levels, 8 bytes
+
     uint64_t _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
 
     /// Client and server, pointers to child nodes, various encodings
@@ -236,9 +261,11 @@ private:
          _shouldRender : 1, /// Client only, should this voxel render at this time, 1 bit
          _octcodePointer : 1, /// Client and Server only, is this voxel's octal code a pointer or buffer, 1 bit
          _unknownBufferIndex : 1,
-         _childrenExternal : 1; /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _childrenExternal : 1, /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _needsReaverage : 1; /// Server only, has the subtree changed since this voxel's color was averaged, 1 bit
 
     static std::vector<VoxelNodeDeleteHook*> _deleteHooks;
+    static pthread_mutex_t _deleteHooksLock; // hooks come and go with clients while the tree deletes nodes
     static std::vector<VoxelNodeUpdateHook*> _updateHooks;
 
     static uint64_t _voxelNodeCount;
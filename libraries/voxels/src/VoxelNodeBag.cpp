@@ -6,11 +6,14 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
 #include "VoxelNodeBag.h"
 #include <OctalCode.h>
 
 VoxelNodeBag::VoxelNodeBag() : 
     _bagElements(NULL),
+    _bagPriorities(NULL),
     _elementsInUse(0),
     _sizeOfElementsArray(0) {
     VoxelNode::addDeleteHook(this);
@@ -24,10 +27,21 @@ VoxelNodeBag::~VoxelNodeBag() {
 void VoxelNodeBag::deleteAll() {
     if (_bagElements) {
         delete[] _bagElements;
+        delete[] _bagPriorities;
     }
     _bagElements = NULL;
+    _bagPriorities = NULL;
     _elementsInUse = 0;
     _sizeOfElementsArray = 0;
+    _nodePriorities.clear();
+}
+
+void VoxelNodeBag::swap(VoxelNodeBag& otherBag) {
+    std::swap(_bagElements, otherBag._bagElements);
+    std::swap(_bagPriorities, otherBag._bagPriorities);
+    std::swap(_elementsInUse, otherBag._elementsInUse);
+    std::swap(_sizeOfElementsArray, otherBag._sizeOfElementsArray);
+    _nodePriorities.swap(otherBag._nodePriorities);
 }
 
 
@@ -35,27 +49,29 @@ const int GROW_BAG_BY = 100;
 
 // put a node into the bag
 void VoxelNodeBag::insert(VoxelNode* node) {
+    insert(node, 0.0f);
+}
 
-    // Search for where we should live in the bag (sorted)
-    // Note: change this to binary search... instead of linear!
-    int insertAt = _elementsInUse;
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            return; // exit early!!
-        }
-        
-        if (_bagElements[i] > node) {
-            insertAt = i;
-            break;
-        }
+void VoxelNodeBag::insert(VoxelNode* node, float priority) {
+    if (_nodePriorities.contains(node)) {
+        return; // exit early!!
     }
-    // at this point, inserAt will be the location we want to insert at.
+    
+    // a priority that isn't a number can't be ordered, it goes with the nodes that have none
+    if (priority != priority) {
+        priority = 0.0f;
+    }
+
+    // Search for where we should live in the bag, sorted by priority and then by pointer, the highest are extracted
+    // first.
+    int insertAt = positionOf(node, priority);
     
     // If we don't have room in our bag, then grow the bag
     if (_sizeOfElementsArray < _elementsInUse + 1) {
         VoxelNode** oldBag = _bagElements;
+        float* oldPriorities = _bagPriorities;
         _bagElements = new VoxelNode * [_sizeOfElementsArray + GROW_BAG_BY];
+        _bagPriorities = new float[_sizeOfElementsArray + GROW_BAG_BY];
         _sizeOfElementsArray += GROW_BAG_BY;
         
         // If we had an old bag...
@@ -64,15 +80,21 @@ void VoxelNodeBag::insert(VoxelNode* node) {
             // insert the new node
             memcpy(_bagElements, oldBag, insertAt * sizeof(VoxelNode*));
             memcpy(&_bagElements[insertAt + 1], &oldBag[insertAt], (_elementsInUse - insertAt) * sizeof(VoxelNode*));
+            memcpy(_bagPriorities, oldPriorities, insertAt * sizeof(float));
+            memcpy(&_bagPriorities[insertAt + 1], &oldPriorities[insertAt], (_elementsInUse - insertAt) * sizeof(float));
             delete[] oldBag;
+            delete[] oldPriorities;
         }
     } else {
         // move existing elements further back in the bag array, leave a space where we need to
         // insert the new node
         memmove(&_bagElements[insertAt + 1], &_bagElements[insertAt], (_elementsInUse - insertAt) * sizeof(VoxelNode*));
+        memmove(&_bagPriorities[insertAt + 1], &_bagPriorities[insertAt], (_elementsInUse - insertAt) * sizeof(float));
     }
     _bagElements[insertAt] = node;
+    _bagPriorities[insertAt] = priority;
     _elementsInUse++;
+    _nodePriorities.insert(node, priority);
 }
  
 // pull a node out of the bag (could come in any order)
@@ -85,44 +107,48 @@ VoxelNode* VoxelNodeBag::extract() {
         
         // reduce the count
         _elementsInUse--;
+        _nodePriorities.remove(node);
 
         return node;
     }
     return NULL;
 }
 
-bool VoxelNodeBag::contains(VoxelNode* node) {
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            return true; // exit early!!
-        }
-        // if we're past where it should be, then it's not here!
-        if (_bagElements[i] > node) {
-            return false;
+int VoxelNodeBag::positionOf(VoxelNode* node, float priority) const {
+    // binary search for the first node that comes after this one in the bag
+    int low = 0;
+    int high = _elementsInUse;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (_bagPriorities[middle] < priority || (_bagPriorities[middle] == priority && _bagElements[middle] < node)) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
     }
-    // if we made it through the entire bag, it's not here!
-    return false;
+    return low;
 }
 
-void VoxelNodeBag::remove(VoxelNode* node) {
-    int foundAt = -1;
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            foundAt = i;
-            break;
-        }
-        // if we're past where it should be, then it's not here!
-        if (_bagElements[i] > node) {
-            break;
-        }
+int VoxelNodeBag::indexOf(VoxelNode* node) const {
+    QHash<VoxelNode*, float>::const_iterator nodePriority = _nodePriorities.find(node);
+    if (nodePriority == _nodePriorities.end()) {
+        return -1;
     }
+    return positionOf(node, nodePriority.value());
+}
+
+bool VoxelNodeBag::contains(VoxelNode* node) {
+    return _nodePriorities.contains(node);
+}
+
+void VoxelNodeBag::remove(VoxelNode* node) {
+    int foundAt = indexOf(node);
     // if we found it, then we need to remove it....
     if (foundAt != -1) {
-        memmove(&_bagElements[foundAt], &_bagElements[foundAt + 1], (_elementsInUse - foundAt) * sizeof(VoxelNode*));
+        memmove(&_bagElements[foundAt], &_bagElements[foundAt + 1], (_elementsInUse - foundAt - 1) * sizeof(VoxelNode*));
+        memmove(&_bagPriorities[foundAt], &_bagPriorities[foundAt + 1], (_elementsInUse - foundAt - 1) * sizeof(float));
         _elementsInUse--;
+        _nodePriorities.remove(node);
     }
 }
 
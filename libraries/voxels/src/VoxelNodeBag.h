@@ -14,6 +14,8 @@
 #ifndef __hifi__VoxelNodeBag__
 #define __hifi__VoxelNodeBag__
 
+#include <QtCore/QHash>
+
 #include "VoxelNode.h"
 
 class VoxelNodeBag : public VoxelNodeDeleteHook {
@@ -23,6 +25,11 @@ public:
     ~VoxelNodeBag();
     
     void insert(VoxelNode* node); // put a node into the bag
+    
+    /// puts a node into the bag to be extracted before the nodes of lower priority, the nodes inserted without one have
+    /// priority zero
+    void insert(VoxelNode* node, float priority);
+    
     VoxelNode* extract(); // pull a node out of the bag (could come in any order)
     bool contains(VoxelNode* node); // is this node in the bag?
     void remove(VoxelNode* node); // remove a specific item from the bag
@@ -32,16 +39,28 @@ public:
 
     void deleteAll();
 
+    /// exchanges this bag's nodes with the other bag's
+    void swap(VoxelNodeBag& otherBag);
+
     static void voxelNodeDeleteHook(VoxelNode* node, void* extraData);
 
     virtual void voxelDeleted(VoxelNode* node);
 
 private:
+    int indexOf(VoxelNode* node) const;
+    
+    /// where a node of this priority is, or would go, in the bag's order
+    int positionOf(VoxelNode* node, float priority) const;
     
     VoxelNode** _bagElements;
+    float*      _bagPriorities;
     int         _elementsInUse;
     int         _sizeOfElementsArray;
     int         _hookID;
+    
+    // the priority of each node in the bag, so that finding a node doesn't look at the whole bag, every deleted voxel
+    // is looked for in every bag
+    QHash<VoxelNode*, float> _nodePriorities;
 };
 
 #endif /* defined(__hifi__VoxelNodeBag__) */
@@ -0,0 +1,102 @@
+//
+//  VoxelPacketAcks.cpp
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The client's record of the voxel packets it has received from a voxel server
+//
+
+#include <algorithm>
+
+#include <SharedUtil.h>
+
+#include "VoxelQuery.h"
+
+#include "VoxelPacketAcks.h"
+
+// we ask for a missing packet until this long after the packets that came after it, then give up on it and have the
+// server forget what it has sent us
+const uint64_t MISSING_PACKET_TIMEOUT_USECS = 1000 * 1000;
+
+// sequence differences past this are packets arriving out of order
+const VOXEL_PACKET_SEQUENCE MAX_SEQUENCE_PROGRESS = 0x7FFF;
+
+VoxelPacketAcks::VoxelPacketAcks() :
+    _lastSequence(0),
+    _lastReceivedTime(0),
+    _numPacketsReceived(0),
+    _numPacketsAbandoned(0)
+{
+}
+
+void VoxelPacketAcks::packetReceived(VOXEL_PACKET_SEQUENCE sequence) {
+    uint64_t now = usecTimestampNow();
+    VOXEL_PACKET_SEQUENCE sequenceProgress = sequence - _lastSequence;
+
+    if (_lastReceivedTime != 0 && (sequenceProgress == 0 || sequenceProgress > MAX_SEQUENCE_PROGRESS)) {
+        // a late or resent packet, it fills a gap but says nothing about the delay or loss on the way here now
+        removeMissingPacket(sequence);
+        return;
+    }
+
+    if (_lastReceivedTime != 0) {
+        // everything between the last packet and this one is missing, keep the newest of any long run of them
+        VOXEL_PACKET_SEQUENCE firstMissing = _lastSequence + 1;
+        if (sequenceProgress - 1 > MAX_MISSING_PACKETS) {
+            firstMissing = sequence - MAX_MISSING_PACKETS;
+            _numPacketsAbandoned += sequenceProgress - 1 - MAX_MISSING_PACKETS;
+        }
+
+        for (VOXEL_PACKET_SEQUENCE missing = firstMissing; missing != sequence; missing++) {
+            MissingPacket missingPacket = { missing, now };
+            _missingPackets.push_back(missingPacket);
+        }
+
+        if (_missingPackets.size() > MAX_MISSING_PACKETS) {
+            _numPacketsAbandoned += _missingPackets.size() - MAX_MISSING_PACKETS;
+            _missingPackets.erase(_missingPackets.begin(), _missingPackets.end() - MAX_MISSING_PACKETS);
+        }
+    }
+
+    _lastSequence = sequence;
+    _lastReceivedTime = now;
+
+    // wraps along with the sequence numbers, the server only looks at how much it has grown since the last query
+    _numPacketsReceived++;
+}
+
+void VoxelPacketAcks::acknowledgeInQuery(VoxelQuery& query) {
+    if (_lastReceivedTime == 0) {
+        query.setPacketAcknowledgement(false, 0, 0, 0);
+        query.clearMissingSequences();
+        return;
+    }
+
+    // the time we sat on the last packet before this query, so that the server can take it out of the round trip
+    const uint64_t MAX_USECS_SINCE_LAST_RECEIVED = 0xFFFFFFFF;
+    uint64_t usecsSinceLastReceived = std::min(usecTimestampNow() - _lastReceivedTime, MAX_USECS_SINCE_LAST_RECEIVED);
+    query.setPacketAcknowledgement(true, _lastSequence, usecsSinceLastReceived, _numPacketsReceived);
+
+    uint64_t now = usecTimestampNow();
+    while (!_missingPackets.empty() && now - _missingPackets.front().missedTime > MISSING_PACKET_TIMEOUT_USECS) {
+        _missingPackets.erase(_missingPackets.begin());
+        _numPacketsAbandoned++;
+    }
+
+    // the oldest first, they are the closest to being given up on
+    query.clearMissingSequences();
+    for (int i = 0; i < (int) _missingPackets.size() && i < MAX_MISSING_SEQUENCES_PER_QUERY; i++) {
+        query.addMissingSequence(_missingPackets[i].sequence);
+    }
+}
+
+void VoxelPacketAcks::removeMissingPacket(VOXEL_PACKET_SEQUENCE sequence) {
+    for (std::vector<MissingPacket>::iterator missingPacket = _missingPackets.begin();
+         missingPacket != _missingPackets.end(); missingPacket++) {
+        if (missingPacket->sequence == sequence) {
+            _missingPackets.erase(missingPacket);
+            return;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+//
+//  VoxelPacketAcks.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The client's record of the voxel packets it has received from a voxel server
+//
+
+#ifndef __hifi__VoxelPacketAcks__
+#define __hifi__VoxelPacketAcks__
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include <QtCore/QUuid>
+
+#include "VoxelConstants.h"
+
+class VoxelQuery;
+
+/// The voxel packets a client has received from one voxel server. The client acknowledges them in each VoxelQuery it
+/// sends to that server, which the server uses to measure the delay and loss on the way to the client, and lists the
+/// packets missing from the sequence so that the server can send them again.
+class VoxelPacketAcks {
+public:
+    VoxelPacketAcks();
+
+    /// records the arrival of the voxel packet with this sequence number
+    void packetReceived(VOXEL_PACKET_SEQUENCE sequence);
+
+    /// fills in the query's acknowledgement of the packets received so far and the ones still missing, giving up on
+    /// those that have been missing for too long
+    void acknowledgeInQuery(VoxelQuery& query);
+
+    /// the packets given up on, their voxels never arrived and the server needs to know not to count on them
+    uint16_t getNumPacketsAbandoned() const { return _numPacketsAbandoned; }
+
+private:
+    struct MissingPacket {
+        VOXEL_PACKET_SEQUENCE sequence;
+        uint64_t missedTime;
+    };
+
+    void removeMissingPacket(VOXEL_PACKET_SEQUENCE sequence);
+
+    VOXEL_PACKET_SEQUENCE _lastSequence;
+    uint64_t _lastReceivedTime;
+    uint16_t _numPacketsReceived;
+    uint16_t _numPacketsAbandoned;
+    std::vector<MissingPacket> _missingPackets;
+};
+
+/// Map between voxel server IDs and the packets received from them
+typedef std::map<QUuid, VoxelPacketAcks> NodeToVoxelPacketAcksMap;
+
+#endif /* defined(__hifi__VoxelPacketAcks__) */
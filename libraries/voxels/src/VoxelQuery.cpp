@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <stdint.h>
@@ -15,6 +16,7 @@
 #include <SharedUtil.h>
 #include <UUID.h>
 #include "VoxelConstants.h"
+#include "VoxelTree.h"
 
 #include "VoxelQuery.h"
 
@@ -35,7 +37,17 @@ VoxelQuery::VoxelQuery(Node* owningNode) :
     _wantDelta(true),
     _wantLowResMoving(true),
     _wantOcclusionCulling(true),
-    _maxVoxelPPS(DEFAULT_MAX_VOXEL_PPS)
+    _wantProgressive(false),
+    _wantPrefetch(false),
+    _maxVoxelPPS(DEFAULT_MAX_VOXEL_PPS),
+    _hasPacketAcknowledgement(false),
+    _lastReceivedSequence(0),
+    _usecsSinceLastReceived(0),
+    _numPacketsReceived(0),
+    _missingSequences(),
+    _localVoxelsGeneration(0),
+    _screenHeight(0),
+    _lodQuality(DEFAULT_LOD_SCALE)
 {
     
 }
@@ -72,6 +84,9 @@ int VoxelQuery::getBroadcastData(unsigned char* destinationBuffer) {
     if (_wantColor)            { setAtBit(bitItems, WANT_COLOR_AT_BIT); }
     if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
     if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
+    if (_hasPacketAcknowledgement) { setAtBit(bitItems, HAS_PACKET_ACKNOWLEDGEMENT_BIT); }
+    if (_wantProgressive)      { setAtBit(bitItems, WANT_PROGRESSIVE_BIT); }
+    if (_wantPrefetch)         { setAtBit(bitItems, WANT_PREFETCH_BIT); }
 
     *destinationBuffer++ = bitItems;
 
@@ -79,6 +94,31 @@ int VoxelQuery::getBroadcastData(unsigned char* destinationBuffer) {
     memcpy(destinationBuffer, &_maxVoxelPPS, sizeof(_maxVoxelPPS));
     destinationBuffer += sizeof(_maxVoxelPPS);
     
+    // acknowledgement of the voxel packets received, only meaningful when the bit above is set
+    memcpy(destinationBuffer, &_lastReceivedSequence, sizeof(_lastReceivedSequence));
+    destinationBuffer += sizeof(_lastReceivedSequence);
+    memcpy(destinationBuffer, &_usecsSinceLastReceived, sizeof(_usecsSinceLastReceived));
+    destinationBuffer += sizeof(_usecsSinceLastReceived);
+    memcpy(destinationBuffer, &_numPacketsReceived, sizeof(_numPacketsReceived));
+    destinationBuffer += sizeof(_numPacketsReceived);
+    
+    // the packets we want sent again
+    unsigned char numMissingSequences = std::min((int) _missingSequences.size(), MAX_MISSING_SEQUENCES_PER_QUERY);
+    *destinationBuffer++ = numMissingSequences;
+    for (int i = 0; i < numMissingSequences; i++) {
+        memcpy(destinationBuffer, &_missingSequences[i], sizeof(VOXEL_PACKET_SEQUENCE));
+        destinationBuffer += sizeof(VOXEL_PACKET_SEQUENCE);
+    }
+    
+    memcpy(destinationBuffer, &_localVoxelsGeneration, sizeof(_localVoxelsGeneration));
+    destinationBuffer += sizeof(_localVoxelsGeneration);
+    
+    // level of detail
+    memcpy(destinationBuffer, &_screenHeight, sizeof(_screenHeight));
+    destinationBuffer += sizeof(_screenHeight);
+    memcpy(destinationBuffer, &_lodQuality, sizeof(_lodQuality));
+    destinationBuffer += sizeof(_lodQuality);
+    
     return destinationBuffer - bufferStart;
 }
 
@@ -116,14 +156,60 @@ int VoxelQuery::parseData(unsigned char* sourceBuffer, int numBytes) {
     _wantColor            = oneAtBit(bitItems, WANT_COLOR_AT_BIT);
     _wantDelta            = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
     _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
+    _hasPacketAcknowledgement = oneAtBit(bitItems, HAS_PACKET_ACKNOWLEDGEMENT_BIT);
+    _wantProgressive      = oneAtBit(bitItems, WANT_PROGRESSIVE_BIT);
+    _wantPrefetch         = oneAtBit(bitItems, WANT_PREFETCH_BIT);
 
     // desired Max Voxel PPS
     memcpy(&_maxVoxelPPS, sourceBuffer, sizeof(_maxVoxelPPS));
     sourceBuffer += sizeof(_maxVoxelPPS);
     
+    // acknowledgement of the voxel packets received
+    memcpy(&_lastReceivedSequence, sourceBuffer, sizeof(_lastReceivedSequence));
+    sourceBuffer += sizeof(_lastReceivedSequence);
+    memcpy(&_usecsSinceLastReceived, sourceBuffer, sizeof(_usecsSinceLastReceived));
+    sourceBuffer += sizeof(_usecsSinceLastReceived);
+    memcpy(&_numPacketsReceived, sourceBuffer, sizeof(_numPacketsReceived));
+    sourceBuffer += sizeof(_numPacketsReceived);
+    
+    // the packets the client wants sent again
+    unsigned char numMissingSequences = std::min((int) *sourceBuffer++, MAX_MISSING_SEQUENCES_PER_QUERY);
+    _missingSequences.resize(numMissingSequences);
+    for (int i = 0; i < numMissingSequences; i++) {
+        memcpy(&_missingSequences[i], sourceBuffer, sizeof(VOXEL_PACKET_SEQUENCE));
+        sourceBuffer += sizeof(VOXEL_PACKET_SEQUENCE);
+    }
+    
+    memcpy(&_localVoxelsGeneration, sourceBuffer, sizeof(_localVoxelsGeneration));
+    sourceBuffer += sizeof(_localVoxelsGeneration);
+    
+    // level of detail
+    memcpy(&_screenHeight, sourceBuffer, sizeof(_screenHeight));
+    sourceBuffer += sizeof(_screenHeight);
+    memcpy(&_lodQuality, sourceBuffer, sizeof(_lodQuality));
+    sourceBuffer += sizeof(_lodQuality);
+    
     return sourceBuffer - startPosition;
 }
 
+void VoxelQuery::setPacketAcknowledgement(bool hasPacketAcknowledgement, VOXEL_PACKET_SEQUENCE lastReceivedSequence,
+                                          uint32_t usecsSinceLastReceived, uint16_t numPacketsReceived) {
+    _hasPacketAcknowledgement = hasPacketAcknowledgement;
+    _lastReceivedSequence = lastReceivedSequence;
+    _usecsSinceLastReceived = usecsSinceLastReceived;
+    _numPacketsReceived = numPacketsReceived;
+}
+
+float VoxelQuery::getLODScale() const {
+    // a client can't ask for more than MAX_LOD_QUALITY, or for nothing at all, written so that NaN gets the least
+    float lodQuality = _lodQuality >= MIN_LOD_QUALITY ? std::min(_lodQuality, MAX_LOD_QUALITY) : MIN_LOD_QUALITY;
+    
+    // nor can a tall screen or a narrow view take the scale past the same range, since it sets how much of the tree
+    // the server walks and sends for the client
+    float lodScale = lodScaleForScreen(_cameraFov, _screenHeight) * lodQuality;
+    return lodScale >= MIN_LOD_QUALITY ? std::min(lodScale, MAX_LOD_QUALITY) : MIN_LOD_QUALITY;
+}
+
 glm::vec3 VoxelQuery::calculateCameraDirection() const {
     glm::vec3 direction = glm::vec3(_cameraOrientation * glm::vec4(IDENTITY_FRONT, 0.0f));
     return direction;
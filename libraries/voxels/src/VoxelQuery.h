@@ -24,11 +24,23 @@
 
 #include <NodeData.h>
 
+#include "VoxelConstants.h"
+
 // First bitset
 const int WANT_LOW_RES_MOVING_BIT = 0;
 const int WANT_COLOR_AT_BIT = 1;
 const int WANT_DELTA_AT_BIT = 2;
 const int WANT_OCCLUSION_CULLING_BIT = 3; // 4th bit
+const int HAS_PACKET_ACKNOWLEDGEMENT_BIT = 4;
+const int WANT_PROGRESSIVE_BIT = 5;
+const int WANT_PREFETCH_BIT = 6;
+
+const int MAX_MISSING_SEQUENCES_PER_QUERY = 16;
+const int MAX_MISSING_PACKETS = 64; // a client never asks for a packet further behind the newest it has received
+
+
+const float MIN_LOD_QUALITY = 0.125f;
+const float MAX_LOD_QUALITY = 4.0f;
 
 class VoxelQuery : public NodeData {
     Q_OBJECT
@@ -68,13 +80,54 @@ public:
     bool getWantDelta() const { return _wantDelta; }
     bool getWantLowResMoving() const { return _wantLowResMoving; }
     bool getWantOcclusionCulling() const { return _wantOcclusionCulling; }
+    
+    /// whether the client wants each scene sent coarse to fine, the whole view a level at a time, rather than each
+    /// part of it in full detail before the next
+    bool getWantProgressive() const { return _wantProgressive; }
+    
+    /// whether the client keeps the voxels outside of its view, so that it can be sent the ones it is likely to see
+    /// next, a client that removes them would only drop them again and lose its sent state
+    bool getWantPrefetch() const { return _wantPrefetch; }
     int getMaxVoxelPacketsPerSecond() const { return _maxVoxelPPS; }
     
+    // acknowledgement of the voxel packets received from the server this query is sent to
+    bool getHasPacketAcknowledgement() const { return _hasPacketAcknowledgement; }
+    VOXEL_PACKET_SEQUENCE getLastReceivedSequence() const { return _lastReceivedSequence; }
+    uint32_t getUsecsSinceLastReceived() const { return _usecsSinceLastReceived; }
+    uint16_t getNumPacketsReceived() const { return _numPacketsReceived; }
+    
+    /// sets the acknowledgement sent with the next query, hasPacketAcknowledgement is false until a packet arrives
+    void setPacketAcknowledgement(bool hasPacketAcknowledgement, VOXEL_PACKET_SEQUENCE lastReceivedSequence,
+                                  uint32_t usecsSinceLastReceived, uint16_t numPacketsReceived);
+    
+    /// the voxel packets the client is missing and wants sent again, at most MAX_MISSING_SEQUENCES_PER_QUERY
+    const std::vector<VOXEL_PACKET_SEQUENCE>& getMissingSequences() const { return _missingSequences; }
+    void clearMissingSequences() { _missingSequences.clear(); }
+    void addMissingSequence(VOXEL_PACKET_SEQUENCE sequence) { _missingSequences.push_back(sequence); }
+    
+    /// changes each time the client drops voxels it was sent or gives up on a packet, so that the server forgets what
+    /// it has delivered
+    uint16_t getLocalVoxelsGeneration() const { return _localVoxelsGeneration; }
+    void setLocalVoxelsGeneration(uint16_t localVoxelsGeneration) { _localVoxelsGeneration = localVoxelsGeneration; }
+    
+    /// the height in pixels of the client's view, zero if it doesn't say
+    uint16_t getScreenHeight() const { return _screenHeight; }
+    void setScreenHeight(uint16_t screenHeight) { _screenHeight = screenHeight; }
+    
+    /// how much finer than the default the client wants its level of detail, 2.0 for voxels half as many pixels high
+    float getLODQuality() const { return _lodQuality; }
+    void setLODQuality(float lodQuality) { _lodQuality = lodQuality; }
+    
+    /// the scale of the render level boundaries for the client's screen and quality, within the LOD quality range
+    float getLODScale() const;
+    
 public slots:
     void setWantLowResMoving(bool wantLowResMoving) { _wantLowResMoving = wantLowResMoving; }
     void setWantColor(bool wantColor) { _wantColor = wantColor; }
     void setWantDelta(bool wantDelta) { _wantDelta = wantDelta; }
     void setWantOcclusionCulling(bool wantOcclusionCulling) { _wantOcclusionCulling = wantOcclusionCulling; }
+    void setWantProgressive(bool wantProgressive) { _wantProgressive = wantProgressive; }
+    void setWantPrefetch(bool wantPrefetch) { _wantPrefetch = wantPrefetch; }
     void setMaxVoxelPacketsPerSecond(int maxVoxelPPS) { _maxVoxelPPS = maxVoxelPPS; }
     
 protected:
@@ -94,8 +147,19 @@ protected:
     bool _wantDelta;
     bool _wantLowResMoving;
     bool _wantOcclusionCulling;
+    bool _wantProgressive;
+    bool _wantPrefetch;
     int _maxVoxelPPS;
     
+    bool _hasPacketAcknowledgement;
+    VOXEL_PACKET_SEQUENCE _lastReceivedSequence;
+    uint32_t _usecsSinceLastReceived;
+    uint16_t _numPacketsReceived;
+    std::vector<VOXEL_PACKET_SEQUENCE> _missingSequences;
+    uint16_t _localVoxelsGeneration;
+    uint16_t _screenHeight;
+    float _lodQuality;
+    
 private:
     // privatize the copy constructor and assignment operator so they cannot be called
     VoxelQuery(const VoxelQuery&);
@@ -0,0 +1,77 @@
+//
+//  VoxelSentState.cpp
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The voxels a client has already been sent, so that they aren't sent to it again
+//
+
+#include <SharedUtil.h>
+
+#include "VoxelSentState.h"
+
+VoxelSentState::VoxelSentState() :
+    _sentNodes()
+{
+    VoxelNode::addDeleteHook(this);
+}
+
+VoxelSentState::~VoxelSentState() {
+    VoxelNode::removeDeleteHook(this);
+}
+
+VoxelSentState::SentNode& VoxelSentState::sentNodeFor(VoxelNode* node) {
+    QHash<VoxelNode*, SentNode>::iterator sentNode = _sentNodes.find(node);
+    if (sentNode == _sentNodes.end()) {
+        SentNode unsentNode = { 0, 0, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f };
+        sentNode = _sentNodes.insert(node, unsentNode);
+    }
+    return sentNode.value();
+}
+
+void VoxelSentState::colorSent(VoxelNode* node) {
+    sentNodeFor(node).colorSentAt = usecTimestampNow();
+}
+
+bool VoxelSentState::hasColor(VoxelNode* node) const {
+    QHash<VoxelNode*, SentNode>::const_iterator sentNode = _sentNodes.find(node);
+    return sentNode != _sentNodes.end() && sentNode.value().colorSentAt != 0
+        && !node->hasChangedSince(sentNode.value().colorSentAt - CHANGE_FUDGE);
+}
+
+void VoxelSentState::subtreeSent(VoxelNode* node, const glm::vec3& cameraPosition, float boundaryScale,
+                                 float lodMargin) {
+    SentNode& sentNode = sentNodeFor(node);
+    sentNode.subtreeSentAt = usecTimestampNow();
+    sentNode.cameraPosition = cameraPosition;
+    sentNode.lodMargin = lodMargin;
+    sentNode.boundaryScale = boundaryScale;
+}
+
+bool VoxelSentState::hasSubtree(VoxelNode* node, const glm::vec3& cameraPosition, float boundaryScale,
+                                float& lodMargin) const {
+    QHash<VoxelNode*, SentNode>::const_iterator found = _sentNodes.find(node);
+    if (found == _sentNodes.end() || found.value().subtreeSentAt == 0) {
+        return false;
+    }
+    const SentNode& sentNode = found.value();
+
+    // changes anywhere below a node mark it as changed too
+    if (node->hasChangedSince(sentNode.subtreeSentAt - CHANGE_FUDGE)) {
+        return false;
+    }
+
+    // a finer level of detail than it was sent at needs more of it
+    if (boundaryScale > sentNode.boundaryScale) {
+        return false;
+    }
+
+    // the distances that decide the level of detail change by no more than the camera moves
+    lodMargin = sentNode.lodMargin - glm::distance(cameraPosition, sentNode.cameraPosition);
+    return lodMargin >= 0.0f;
+}
+
+void VoxelSentState::voxelDeleted(VoxelNode* node) {
+    _sentNodes.remove(node);
+}
@@ -0,0 +1,66 @@
+//
+//  VoxelSentState.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  The voxels a client has already been sent, so that they aren't sent to it again
+//
+
+#ifndef __hifi__VoxelSentState__
+#define __hifi__VoxelSentState__
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+
+#include "VoxelNode.h"
+
+/// What one client has been sent of the tree. For each node it remembers when the node's color was sent, and when the
+/// whole of the node's subtree was sent down to the level of detail the camera needed then, along with how far the
+/// camera could move from there before it would need more of the subtree. Nodes that have changed since they were sent
+/// are sent again, everything else the encoder leaves out no matter how often it comes back into view.
+class VoxelSentState : public VoxelNodeDeleteHook {
+public:
+    VoxelSentState();
+    ~VoxelSentState();
+
+    /// records that the node's color was written to the client
+    void colorSent(VoxelNode* node);
+
+    /// true if the client has the node's current color
+    bool hasColor(VoxelNode* node) const;
+
+    /// records that everything in the node's subtree a camera at cameraPosition needs at the boundary scale was written
+    /// to the client, where lodMargin is how far that camera can move before its level of detail needs more of the
+    /// subtree
+    void subtreeSent(VoxelNode* node, const glm::vec3& cameraPosition, float boundaryScale, float lodMargin);
+
+    /// true if the client has everything in the node's current subtree a camera at cameraPosition needs at the boundary
+    /// scale, lodMargin is set to how much further that camera can move before it needs more
+    bool hasSubtree(VoxelNode* node, const glm::vec3& cameraPosition, float boundaryScale, float& lodMargin) const;
+
+    /// forgets everything sent, for when the client has dropped voxels or lost packets
+    void forgetAll() { _sentNodes.clear(); }
+
+    int count() const { return _sentNodes.size(); }
+
+    virtual void voxelDeleted(VoxelNode* node);
+
+private:
+    struct SentNode {
+        uint64_t colorSentAt;
+        uint64_t subtreeSentAt;
+        glm::vec3 cameraPosition;
+        float lodMargin;
+        float boundaryScale;
+    };
+
+    SentNode& sentNodeFor(VoxelNode* node);
+
+    QHash<VoxelNode*, SentNode> _sentNodes;
+};
+
+#endif /* defined(__hifi__VoxelSentState__) */
@@ -18,6 +18,7 @@
 #include <glm/gtc/noise.hpp>
 
 #include <QtCore/QDebug>
+#include <QtCore/QThread>
 #include <QImage>
 #include <QRgb>
 
@@ -33,8 +34,8 @@
 #include "VoxelTree.h"
 #include <PacketHeaders.h>
 
-float boundaryDistanceForRenderLevel(unsigned int renderLevel) {
-    return ::VOXEL_SIZE_SCALE / powf(2, renderLevel);
+float boundaryDistanceForRenderLevel(unsigned int renderLevel, float lodScale) {
+    return lodScale * ::VOXEL_SIZE_SCALE / powf(2, renderLevel);
 }
 
 float boundaryDistanceSquaredForRenderLevel(unsigned int renderLevel) {
@@ -42,6 +43,17 @@ float boundaryDistanceSquaredForRenderLevel(unsigned int renderLevel) {
     return voxelSizeScale / powf(2, (2 * renderLevel));
 }
 
+float lodScaleForScreen(float fieldOfView, int screenHeight) {
+    // written so that a NaN view, or one that wraps all the way around, gets the table too
+    if (screenHeight <= 0 || !(fieldOfView > 0.0f && fieldOfView < 180.0f)) {
+        return DEFAULT_LOD_SCALE;
+    }
+    // a voxel's projected height is its size over its distance, times the screen's pixels per unit of view tangent
+    float pixelsPerTangent = screenHeight / tanf(fieldOfView * 0.5f * PI_OVER_180);
+    float referencePixelsPerTangent = REFERENCE_LOD_SCREEN_HEIGHT / tanf(REFERENCE_LOD_FIELD_OF_VIEW * 0.5f * PI_OVER_180);
+    return pixelsPerTangent / referencePixelsPerTangent;
+}
+
 VoxelTree::VoxelTree(bool shouldReaverage) :
     voxelsCreated(0),
     voxelsColored(0),
@@ -51,7 +63,9 @@ VoxelTree::VoxelTree(bool shouldReaverage) :
     voxelsBytesReadStats(100),
     _isDirty(true),
     _shouldReaverage(shouldReaverage),
-    _stopImport(false) {
+    _stopImport(false),
+    _lazyReaverage(false),
+    _hasPendingReaverage(false) {
     rootNode = new VoxelNode();
     
     pthread_mutex_init(&_encodeSetLock, NULL);
@@ -523,39 +537,9 @@ void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelNode* node, void* extraD
     // Since we traverse the tree in code order, we know that if our code
     // matches, then we've reached  our target node.
     if (lengthOfNodeCode == args->lengthOfCode) {
-        // we've reached our target -- we might have found our node, but that node might have children.
-        // in this case, we only allow you to set the color if you explicitly asked for a destructive
-        // write.
-        if (!node->isLeaf() && args->destructive) {
-            // if it does exist, make sure it has no children
-            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-                node->deleteChildAtIndex(i);
-            }
-        } else {
-            if (!node->isLeaf()) {
-                qDebug("WARNING! operation would require deleting children, add Voxel ignored!\n ");
-            }
-        }
-
-        // If we get here, then it means, we either had a true leaf to begin with, or we were in
-        // destructive mode and we deleted all the child trees. So we can color.
-        if (node->isLeaf()) {
-            // give this node its color
-            int octalCodeBytes = bytesRequiredForCodeLength(args->lengthOfCode);
-
-            nodeColor newColor;
-            memcpy(newColor, args->codeColorBuffer + octalCodeBytes, SIZE_OF_COLOR_DATA);
-            newColor[SIZE_OF_COLOR_DATA] = 1;
-            node->setColor(newColor);
-
-            // It's possible we just reset the node to it's exact same color, in
-            // which case we don't consider this to be dirty...
-            if (node->isDirty()) {
-                // track our tree dirtiness
-                _isDirty = true;
-                // track that path has changed
-                args->pathChanged = true;
-            }
+        if (setNodeFromCodeColorBuffer(node, args->codeColorBuffer, args->lengthOfCode, args->destructive)) {
+            // track that path has changed
+            args->pathChanged = true;
         }
         return;
     }
@@ -581,6 +565,89 @@ void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelNode* node, void* extraD
     }
 }
 
+// sets the node to the color in the code color buffer, returns true if that changed the node
+bool VoxelTree::setNodeFromCodeColorBuffer(VoxelNode* node, const unsigned char* codeColorBuffer, int lengthOfCode,
+                                           bool destructive) {
+    // we've reached our target -- we might have found our node, but that node might have children.
+    // in this case, we only allow you to set the color if you explicitly asked for a destructive
+    // write.
+    if (!node->isLeaf() && destructive) {
+        // if it does exist, make sure it has no children
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            node->deleteChildAtIndex(i);
+        }
+    } else {
+        if (!node->isLeaf()) {
+            qDebug("WARNING! operation would require deleting children, add Voxel ignored!\n ");
+        }
+    }
+
+    // If we get here, then it means, we either had a true leaf to begin with, or we were in
+    // destructive mode and we deleted all the child trees. So we can color.
+    if (node->isLeaf()) {
+        // give this node its color
+        int octalCodeBytes = bytesRequiredForCodeLength(lengthOfCode);
+
+        nodeColor newColor;
+        memcpy(newColor, codeColorBuffer + octalCodeBytes, SIZE_OF_COLOR_DATA);
+        newColor[SIZE_OF_COLOR_DATA] = 1;
+        node->setColor(newColor);
+
+        // It's possible we just reset the node to it's exact same color, in
+        // which case we don't consider this to be dirty...
+        if (node->isDirty()) {
+            // track our tree dirtiness
+            _isDirty = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void VoxelTree::readCodeColorBuffersToTree(const VoxelEdit* edits, int editCount) {
+    if (editCount > 0) {
+        readCodeColorBuffersToTreeRecursion(rootNode, edits, editCount,
+                                            numberOfThreeBitSectionsInCode(edits[0].codeColorBuffer));
+    }
+}
+
+// sets the edits in the subtree of the node, returns true if that changed the subtree
+bool VoxelTree::readCodeColorBuffersToTreeRecursion(VoxelNode* node, const VoxelEdit* edits, int editCount,
+                                                    int lengthOfCode) {
+    // codes of the same length don't nest, so the node the codes are as long as is the one edit that reached it
+    if (numberOfThreeBitSectionsInCode(node->getOctalCode()) == lengthOfCode) {
+        return setNodeFromCodeColorBuffer(node, edits[0].codeColorBuffer, lengthOfCode, edits[0].destructive);
+    }
+
+    // sorted edits under the same child are next to each other, walk each of those children once for all of them
+    bool pathChanged = false;
+    int firstEdit = 0;
+    while (firstEdit < editCount) {
+        int childIndex = branchIndexWithDescendant(node->getOctalCode(), edits[firstEdit].codeColorBuffer);
+        int endEdit = firstEdit + 1;
+        while (endEdit < editCount
+               && branchIndexWithDescendant(node->getOctalCode(), edits[endEdit].codeColorBuffer) == childIndex) {
+            endEdit++;
+        }
+
+        // If the branch we need to traverse does not exist, then create it on the way down...
+        VoxelNode* childNode = node->getChildAtIndex(childIndex);
+        if (!childNode) {
+            childNode = node->addChildAtIndex(childIndex);
+        }
+        if (readCodeColorBuffersToTreeRecursion(childNode, edits + firstEdit, endEdit - firstEdit, lengthOfCode)) {
+            pathChanged = true;
+        }
+        firstEdit = endEdit;
+    }
+
+    // one round of bookkeeping for all the edits below this node
+    if (pathChanged) {
+        node->handleSubtreeChanged(this);
+    }
+    return pathChanged;
+}
+
 void VoxelTree::processRemoveVoxelBitstream(unsigned char * bitstream, int bufferSizeBytes) {
     //unsigned short int itemNumber = (*((unsigned short int*)&bitstream[sizeof(PACKET_HEADER)]));
     int atByte = sizeof(short int) + numBytesForPacketHeader(bitstream);
@@ -646,36 +713,159 @@ void VoxelTree::printTreeForDebugging(VoxelNode *startNode) {
 void VoxelTree::reaverageVoxelColors(VoxelNode* startNode) {
     // if our tree is a reaveraging tree, then we do this, otherwise we don't do anything
     if (_shouldReaverage) {
-        static int recursionCount;
-        if (startNode == rootNode) {
-            recursionCount = 0;
+        reaverageVoxelColorsRecursion(startNode, INT_MAX, NULL);
+    }
+}
+
+// reaverages the levels of the node's subtree above levelsToReaverage, when collapseLock is given the subtree is one
+// of several being reaveraged at once, and the deletes of collapsing leaves are done holding it
+void VoxelTree::reaverageVoxelColorsRecursion(VoxelNode* node, int levelsToReaverage, pthread_mutex_t* collapseLock,
+                                              int recursionCount) {
+    if (levelsToReaverage == 0) {
+        return;
+    }
+    if (recursionCount > UNREASONABLY_DEEP_RECURSION) {
+        qDebug("VoxelTree::reaverageVoxelColors()... bailing out of UNREASONABLY_DEEP_RECURSION\n");
+        return;
+    }
+
+    bool hasChildren = false;
+
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        if (node->getChildAtIndex(i)) {
+            reaverageVoxelColorsRecursion(node->getChildAtIndex(i), levelsToReaverage - 1, collapseLock,
+                                          recursionCount + 1);
+            hasChildren = true;
+        }
+    }
+
+    if (!hasChildren) {
+        return;
+    }
+
+    // collapseIdenticalLeaves() returns true if it collapses the leaves
+    // in which case we don't need to set the average color
+    if (collapseLock) {
+        if (node->hasIdenticalLeafChildren()) {
+            // deleting nodes updates the node counts and calls the delete hooks, which aren't safe to do at once
+            pthread_mutex_lock(collapseLock);
+            node->collapseIdenticalLeaves();
+            pthread_mutex_unlock(collapseLock);
         } else {
-            recursionCount++;
+            node->setColorFromAverageOfChildren();
         }
-        if (recursionCount > UNREASONABLY_DEEP_RECURSION) {
-            qDebug("VoxelTree::reaverageVoxelColors()... bailing out of UNREASONABLY_DEEP_RECURSION\n");
-            recursionCount--;
-            return;
+    } else if (!node->collapseIdenticalLeaves()) {
+        node->setColorFromAverageOfChildren();
+    }
+}
+
+void VoxelTree::setLazyReaverage(bool lazyReaverage) {
+    // colors left for later still need averaging once edits stop leaving them
+    if (!lazyReaverage) {
+        reaverageDirtyPaths();
+    }
+    _lazyReaverage = lazyReaverage;
+}
+
+void VoxelTree::reaverageDirtyPaths() {
+    if (_hasPendingReaverage) {
+        _hasPendingReaverage = false;
+        reaverageDirtyPathsRecursion(rootNode);
+    }
+}
+
+// edits mark every node on their way back up to the root, so the marked nodes are found below other marked nodes
+void VoxelTree::reaverageDirtyPathsRecursion(VoxelNode* node) {
+    if (!node->needsReaverage()) {
+        return;
+    }
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        VoxelNode* childNode = node->getChildAtIndex(i);
+        if (childNode) {
+            reaverageDirtyPathsRecursion(childNode);
         }
+    }
+    node->setColorFromAverageOfChildren();
+    node->clearNeedsReaverage();
+}
 
-        bool hasChildren = false;
+class ReaverageVoxelColorsArgs {
+public:
+    VoxelTree*              tree;
+    std::vector<VoxelNode*> subtrees;
+    int                     nextSubtree;
+    pthread_mutex_t         collapseLock;
+};
 
-        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-            if (startNode->getChildAtIndex(i)) {
-                reaverageVoxelColors(startNode->getChildAtIndex(i));
-                hasChildren = true;
-            }
+void* VoxelTree::reaverageVoxelColorsThread(void* extraData) {
+    ReaverageVoxelColorsArgs* args = (ReaverageVoxelColorsArgs*)extraData;
+    while (true) {
+        int subtree = __sync_fetch_and_add(&args->nextSubtree, 1);
+        if (subtree >= (int)args->subtrees.size()) {
+            break;
         }
+        args->tree->reaverageVoxelColorsRecursion(args->subtrees[subtree], INT_MAX, &args->collapseLock,
+                                                  PARALLEL_REAVERAGE_LEVELS);
+    }
+    return NULL;
+}
 
-        // collapseIdenticalLeaves() returns true if it collapses the leaves
-        // in which case we don't need to set the average color
-        if (hasChildren && !startNode->collapseIdenticalLeaves()) {
-            startNode->setColorFromAverageOfChildren();
+// adds the nodes levelsBelow levels below the node to the subtrees
+static void collectSubtrees(VoxelNode* node, int levelsBelow, std::vector<VoxelNode*>& subtrees) {
+    if (levelsBelow == 0) {
+        subtrees.push_back(node);
+        return;
+    }
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        VoxelNode* child = node->getChildAtIndex(i);
+        if (child) {
+            collectSubtrees(child, levelsBelow - 1, subtrees);
         }
-        recursionCount--;
     }
 }
 
+void VoxelTree::reaverageVoxelColorsInParallel(VoxelNode* startNode, int threadCount) {
+    if (!_shouldReaverage) {
+        return;
+    }
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+
+    // the update hooks render voxels as their colors change, they need the nodes one at a time
+    if (threadCount <= 1 || VoxelNode::hasUpdateHooks()) {
+        reaverageVoxelColors(startNode);
+        return;
+    }
+
+    // the subtrees below the top levels are independent, so the threads take them in turn, then the top levels are
+    // reaveraged from their results the same as they would be in a single pass
+    ReaverageVoxelColorsArgs args;
+    args.tree = this;
+    args.nextSubtree = 0;
+    collectSubtrees(startNode, PARALLEL_REAVERAGE_LEVELS, args.subtrees);
+    pthread_mutex_init(&args.collapseLock, NULL);
+
+    std::vector<pthread_t> threads;
+    for (int i = 0; i < threadCount; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, reaverageVoxelColorsThread, &args) == 0) {
+            threads.push_back(thread);
+        }
+    }
+
+    // if no thread could be started, this one does all the subtrees
+    if (threads.empty()) {
+        reaverageVoxelColorsThread(&args);
+    }
+    for (int i = 0; i < (int)threads.size(); i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&args.collapseLock);
+
+    reaverageVoxelColorsRecursion(startNode, PARALLEL_REAVERAGE_LEVELS, NULL);
+}
+
 void VoxelTree::loadVoxelsFile(const char* fileName, bool wantColorRandomizer) {
     int vCount = 0;
 
@@ -897,8 +1087,19 @@ void VoxelTree::createSphere(float radius, float xc, float yc, float zc, float v
 }
 
 // combines the ray cast arguments into a single object
-class RayArgs {
+class RayOperation : public VoxelTreeOperation {
 public:
+    RayOperation(const glm::vec3& origin, const glm::vec3& direction,
+                 VoxelNode*& node, float& distance, BoxFace& face) :
+        origin(origin),
+        direction(direction),
+        node(node),
+        distance(distance),
+        face(face),
+        found(false) { }
+
+    Result visit(VoxelNode* node);
+
     glm::vec3 origin;
     glm::vec3 direction;
     VoxelNode*& node;
@@ -907,72 +1108,86 @@ public:
     bool found;
 };
 
-bool findRayIntersectionOp(VoxelNode* node, void* extraData) {
-    RayArgs* args = static_cast<RayArgs*>(extraData);
+VoxelTreeOperation::Result RayOperation::visit(VoxelNode* node) {
     AABox box = node->getAABox();
     float distance;
     BoxFace face;
-    if (!box.findRayIntersection(args->origin, args->direction, distance, face)) {
-        return false;
+    if (!box.findRayIntersection(origin, direction, distance, face)) {
+        return SKIP_CHILDREN;
     }
     if (!node->isLeaf()) {
-        return true; // recurse on children
+        return VISIT_CHILDREN;
     }
     distance *= TREE_SCALE;
-    if (node->isColored() && (!args->found || distance < args->distance)) {
-        args->node = node;
-        args->distance = distance;
-        args->face = face;
-        args->found = true;
+    if (node->isColored() && (!found || distance < this->distance)) {
+        this->node = node;
+        this->distance = distance;
+        this->face = face;
+        found = true;
     }
-    return false;
+    return SKIP_CHILDREN;
 }
 
 bool VoxelTree::findRayIntersection(const glm::vec3& origin, const glm::vec3& direction,
                                     VoxelNode*& node, float& distance, BoxFace& face) {
-    RayArgs args = { origin / (float)TREE_SCALE, direction, node, distance, face };
-    recurseTreeWithOperation(findRayIntersectionOp, &args);
-    return args.found;
+    RayOperation operation(origin / (float)TREE_SCALE, direction, node, distance, face);
+    traverseTree(operation);
+    return operation.found;
 }
 
-class SphereArgs {
+class SphereOperation : public VoxelTreeOperation {
 public:
+    SphereOperation(const glm::vec3& center, float radius, glm::vec3& penetration) :
+        center(center),
+        radius(radius),
+        penetration(penetration),
+        found(false) { }
+
+    Result visit(VoxelNode* node);
+
     glm::vec3 center;
     float radius;
     glm::vec3& penetration;
     bool found;
 };
 
-bool findSpherePenetrationOp(VoxelNode* node, void* extraData) {
-    SphereArgs* args = static_cast<SphereArgs*>(extraData);
-
+VoxelTreeOperation::Result SphereOperation::visit(VoxelNode* node) {
     // coarse check against bounds
     const AABox& box = node->getAABox();
-    if (!box.expandedContains(args->center, args->radius)) {
-        return false;
+    if (!box.expandedContains(center, radius)) {
+        return SKIP_CHILDREN;
     }
     if (!node->isLeaf()) {
-        return true; // recurse on children
+        return VISIT_CHILDREN;
     }
     if (node->isColored()) {
         glm::vec3 nodePenetration;
-        if (box.findSpherePenetration(args->center, args->radius, nodePenetration)) {
-            args->penetration = addPenetrations(args->penetration, nodePenetration * (float)TREE_SCALE);
-            args->found = true;
+        if (box.findSpherePenetration(center, radius, nodePenetration)) {
+            penetration = addPenetrations(penetration, nodePenetration * (float)TREE_SCALE);
+            found = true;
         }
     }
-    return false;
+    return SKIP_CHILDREN;
 }
 
 bool VoxelTree::findSpherePenetration(const glm::vec3& center, float radius, glm::vec3& penetration) {
-    SphereArgs args = { center / (float)TREE_SCALE, radius / TREE_SCALE, penetration };
+    SphereOperation operation(center / (float)TREE_SCALE, radius / TREE_SCALE, penetration);
     penetration = glm::vec3(0.0f, 0.0f, 0.0f);
-    recurseTreeWithOperation(findSpherePenetrationOp, &args);
-    return args.found;
+    traverseTree(operation);
+    return operation.found;
 }
 
-class CapsuleArgs {
+class CapsuleOperation : public VoxelTreeOperation {
 public:
+    CapsuleOperation(const glm::vec3& start, const glm::vec3& end, float radius, glm::vec3& penetration) :
+        start(start),
+        end(end),
+        radius(radius),
+        penetration(penetration),
+        found(false) { }
+
+    Result visit(VoxelNode* node);
+
     glm::vec3 start;
     glm::vec3 end;
     float radius;
@@ -980,32 +1195,30 @@ public:
     bool found;
 };
 
-bool findCapsulePenetrationOp(VoxelNode* node, void* extraData) {
-    CapsuleArgs* args = static_cast<CapsuleArgs*>(extraData);
-
+VoxelTreeOperation::Result CapsuleOperation::visit(VoxelNode* node) {
     // coarse check against bounds
     const AABox& box = node->getAABox();
-    if (!box.expandedIntersectsSegment(args->start, args->end, args->radius)) {
-        return false;
+    if (!box.expandedIntersectsSegment(start, end, radius)) {
+        return SKIP_CHILDREN;
     }
     if (!node->isLeaf()) {
-        return true; // recurse on children
+        return VISIT_CHILDREN;
     }
     if (node->isColored()) {
         glm::vec3 nodePenetration;
-        if (box.findCapsulePenetration(args->start, args->end, args->radius, nodePenetration)) {
-            args->penetration = addPenetrations(args->penetration, nodePenetration * (float)TREE_SCALE);
-            args->found = true;
+        if (box.findCapsulePenetration(start, end, radius, nodePenetration)) {
+            penetration = addPenetrations(penetration, nodePenetration * (float)TREE_SCALE);
+            found = true;
         }
     }
-    return false;
+    return SKIP_CHILDREN;
 }
 
 bool VoxelTree::findCapsulePenetration(const glm::vec3& start, const glm::vec3& end, float radius, glm::vec3& penetration) {
-    CapsuleArgs args = { start / (float)TREE_SCALE, end / (float)TREE_SCALE, radius / TREE_SCALE, penetration };
+    CapsuleOperation operation(start / (float)TREE_SCALE, end / (float)TREE_SCALE, radius / TREE_SCALE, penetration);
     penetration = glm::vec3(0.0f, 0.0f, 0.0f);
-    recurseTreeWithOperation(findCapsulePenetrationOp, &args);
-    return args.found;
+    traverseTree(operation);
+    return operation.found;
 }
 
 int VoxelTree::encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer, int availableBytes, VoxelNodeBag& bag,
@@ -1057,6 +1270,8 @@ int VoxelTree::encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer,
         params.stats->traversed(node);
     }
     
+    params.subtreeIsComplete = true;
+    params.subtreeLODMargin = FLT_MAX;
     int childBytesWritten = encodeTreeBitstreamRecursion(node, outputBuffer, availableBytes, bag, params, currentEncodeLevel);
 
     // if childBytesWritten == 1 then something went wrong... that's not possible
@@ -1099,6 +1314,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
 
     // If we've reached our max Search Level, then stop searching.
     if (currentEncodeLevel >= params.maxEncodeLevel) {
+        params.subtreeIsComplete = false;
         return bytesAtThisLevel;
     }
 
@@ -1106,7 +1322,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
     if (params.jurisdictionMap) {
         // here's how it works... if we're currently above our root jurisdiction, then we proceed normally.
         // but once we're in our own jurisdiction, then we need to make sure we're not below it.
-        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node->getOctalCode(), CHECK_NODE_ONLY)) {
+        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node, CHECK_NODE_ONLY)) {
             return bytesAtThisLevel;
         }
     }
@@ -1114,13 +1330,15 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
     // caller can pass NULL as viewFrustum if they want everything
     if (params.viewFrustum) {
         float distance = node->distanceToCamera(*params.viewFrustum);
-        float boundaryDistance = boundaryDistanceForRenderLevel(node->getLevel() + params.boundaryLevelAdjust);
+        float boundaryDistance = boundaryDistanceForRenderLevel(node->getLevel() + params.boundaryLevelAdjust,
+                                                                params.lodScale);
 
         // If we're too far away for our render level, then just return
         if (distance >= boundaryDistance) {
             if (params.stats) {
                 params.stats->skippedDistance(node);
             }
+            params.subtreeLODMargin = std::min(params.subtreeLODMargin, distance - boundaryDistance);
             return bytesAtThisLevel;
         }
 
@@ -1131,6 +1349,19 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
             if (params.stats) {
                 params.stats->skippedOutOfView(node);
             }
+            params.subtreeIsComplete = false;
+            return bytesAtThisLevel;
+        }
+
+        // If the client already has everything it needs of this subtree, and none of it has changed since, then no
+        // matter how many times it has left the view and come back, there's nothing more to send
+        float sentLODMargin = 0.0f;
+        if (params.sentState && params.sentState->hasSubtree(node, params.viewFrustum->getPosition(),
+                                                             params.boundaryScale(), sentLODMargin)) {
+            if (params.stats) {
+                params.stats->skippedWasInView(node);
+            }
+            params.subtreeLODMargin = std::min(params.subtreeLODMargin, sentLODMargin);
             return bytesAtThisLevel;
         }
         
@@ -1156,6 +1387,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
             if (params.stats) {
                 params.stats->skippedWasInView(node);
             }
+            params.subtreeIsComplete = false;
             return bytesAtThisLevel;
         }
 
@@ -1166,6 +1398,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
             if (params.stats) {
                 params.stats->skippedNoChange(node);
             }
+            params.subtreeIsComplete = false;
             return bytesAtThisLevel;
         }
 
@@ -1188,6 +1421,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                     if (params.stats) {
                         params.stats->skippedOccluded(node);
                     }
+                    params.subtreeIsComplete = false;
                     return bytesAtThisLevel;
                 }
             } else {
@@ -1196,6 +1430,14 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                 delete voxelPolygon;
             }
         }
+
+        // In a coarse to fine scene, this pass encodes the nodes down to the pass level, the client needs what's below
+        // here, but it gets it in a later pass, after the parts of the view that are bigger on screen
+        if (params.deeperLevelBag && node->getLevel() > params.passLevel) {
+            params.deeperLevelBag->insert(node, node->projectedSize(*params.viewFrustum));
+            params.subtreeIsComplete = false;
+            return bytesAtThisLevel;
+        }
     }
 
     bool keepDiggingDeeper = true; // Assuming we're in view we have a great work ethic, we're always ready for more!
@@ -1221,11 +1463,30 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
     int inViewNotLeafCount = 0;
     int inViewWithColorCount = 0;
 
+    // whether the client will have everything it needs of this subtree once we're done, and how far the camera can
+    // move before it needs more, only kept when we have the client's sent state, a view to measure from, and colors
+    bool trackSentState = params.sentState && params.viewFrustum && params.includeColor;
+    bool subtreeIsComplete = true;
+    float subtreeLODMargin = FLT_MAX;
+
     VoxelNode*  sortedChildren[NUMBER_OF_CHILDREN];
     float       distancesToChildren[NUMBER_OF_CHILDREN];
     int         indexOfChildren[NUMBER_OF_CHILDREN]; // not really needed
     int         currentCount = 0;
 
+    // locate all the children in the view, and in the last view if we're only sending what's changed, in one go
+    ChildrenLocations childLocations;
+    if (params.viewFrustum) {
+        node->childrenInFrustum(*params.viewFrustum, childLocations);
+    }
+    ChildrenLocations lastChildLocations;
+    if (params.deltaViewFrustum && params.lastViewFrustum) {
+        node->childrenInFrustum(*params.lastViewFrustum, lastChildLocations);
+    }
+    float childBoundaryDistance = !params.viewFrustum ? 1 :
+                                  boundaryDistanceForRenderLevel(node->getLevel() + 1 + params.boundaryLevelAdjust,
+                                                                 params.lodScale);
+
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         VoxelNode* childNode = node->getChildAtIndex(i);
 
@@ -1234,7 +1495,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         // even if they don't in our local tree
         bool notMyJurisdiction = false;
         if (params.jurisdictionMap) {
-            notMyJurisdiction = (JurisdictionMap::WITHIN != params.jurisdictionMap->isMyJurisdiction(node->getOctalCode(), i));
+            notMyJurisdiction = (JurisdictionMap::WITHIN != params.jurisdictionMap->isMyJurisdiction(node, i));
         }
         if (params.includeExistsBits) {
             // If the child is known to exist, OR, it's not my jurisdiction, then we mark the bit as existing
@@ -1250,7 +1511,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                 //qDebug("recurseNodeWithOperationDistanceSorted() CHECKING child[%d] point=%f,%f center=%f,%f distance=%f...\n", i, point.x, point.y, center.x, center.y, distance);
                 //childNode->printDebugDetails("");
 
-                float distance = params.viewFrustum ? childNode->distanceToCamera(*params.viewFrustum) : 0;
+                float distance = params.viewFrustum ? childLocations.distances[i] : 0;
 
                 currentCount = insertIntoSortedArrays((void*)childNode, distance, i,
                                                       (void**)&sortedChildren, (float*)&distancesToChildren,
@@ -1277,24 +1538,27 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         VoxelNode* childNode = sortedChildren[i];
         int originalIndex = indexOfChildren[i];
 
-        bool childIsInView  = (childNode && (!params.viewFrustum || childNode->isInView(*params.viewFrustum)));
+        bool childIsInView  = (childNode && (!params.viewFrustum || childLocations.isInView(originalIndex)));
 
         if (!childIsInView) {
             // must check childNode here, because it could be we got here because there was no childNode
             if (params.stats && childNode) {
                 params.stats->skippedOutOfView(childNode);
             }
+            if (childNode) {
+                subtreeIsComplete = false;
+            }
         } else {
             // Before we determine consider this further, let's see if it's in our LOD scope...
             float distance = distancesToChildren[i]; // params.viewFrustum ? childNode->distanceToCamera(*params.viewFrustum) : 0;
-            float boundaryDistance = !params.viewFrustum ? 1 :
-                                     boundaryDistanceForRenderLevel(childNode->getLevel() + params.boundaryLevelAdjust);
+            float boundaryDistance = childBoundaryDistance;
 
             if (!(distance < boundaryDistance)) {
                 // don't need to check childNode here, because we can't get here with no childNode
                 if (params.stats) {
                     params.stats->skippedDistance(childNode);
                 }
+                subtreeLODMargin = std::min(subtreeLODMargin, distance - boundaryDistance);
             } else {
                 inViewCount++;
 
@@ -1341,7 +1605,8 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
 
                 bool shouldRender = !params.viewFrustum 
                                     ? true 
-                                    : childNode->calculateShouldRender(params.viewFrustum, params.boundaryLevelAdjust);
+                                    : childNode->calculateShouldRender(params.viewFrustum, params.boundaryLevelAdjust,
+                                                                      params.lodScale);
                      
                 // track some stats               
                 if (params.stats) {
@@ -1354,13 +1619,17 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                         params.stats->skippedOccluded(childNode);
                     }
                 }
+                if (childIsOccluded) {
+                    subtreeIsComplete = false;
+                }
                 
                 // track children with actual color, only if the child wasn't previously in view!
                 if (shouldRender && !childIsOccluded) {
+                    bool childColorWasSent = trackSentState && params.sentState->hasColor(childNode);
                     bool childWasInView = false;
                     
                     if (childNode && params.deltaViewFrustum && params.lastViewFrustum) {
-                        ViewFrustum::location location = childNode->inFrustum(*params.lastViewFrustum);
+                        ViewFrustum::location location = lastChildLocations.getLocation(originalIndex);
                         
                         // If we're a leaf, then either intersect or inside is considered "formerly in view"
                         if (childNode->isLeaf()) {
@@ -1373,23 +1642,36 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                     // If our child wasn't in view (or we're ignoring wasInView) then we add it to our sending items.
                     // Or if we were previously in the view, but this node has changed since it was last sent, then we do
                     // need to send it.
-                    if (!childWasInView || 
+                    // Either way, if the client already has its current color, we don't send it again.
+                    if (!childColorWasSent && (!childWasInView || 
                         (params.deltaViewFrustum && 
-                         childNode->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))){
+                         childNode->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE)))){
                         childrenColoredBits += (1 << (7 - originalIndex));
                         inViewWithColorCount++;
                     } else {
                         // otherwise just track stats of the items we discarded
                         // don't need to check childNode here, because we can't get here with no childNode
                         if (params.stats) {
-                            if (childWasInView) {
+                            if (childWasInView || childColorWasSent) {
                                 params.stats->skippedWasInView(childNode);
                             } else {
                                 params.stats->skippedNoChange(childNode);
                             }
                         }
                         
+                        // we only assume the client has it from the last view, we don't know
+                        if (!childColorWasSent) {
+                            subtreeIsComplete = false;
+                        }
                     }
+                } else if (trackSentState && !childIsOccluded && !params.sentState->hasColor(childNode)) {
+                    // not drawn from here, but it will be once the camera moves across one of its render boundaries
+                    float furthestDistance = childNode->furthestDistanceToCamera(*params.viewFrustum);
+                    int renderLevel = childNode->getLevel() + params.boundaryLevelAdjust;
+                    float boundary = boundaryDistanceForRenderLevel(renderLevel, params.lodScale);
+                    float childBoundary = boundaryDistanceForRenderLevel(renderLevel + 1, params.lodScale);
+                    subtreeLODMargin = std::min(subtreeLODMargin, std::min(fabsf(furthestDistance - boundary),
+                                                                           fabsf(furthestDistance - childBoundary)));
                 }
             }
         }
@@ -1446,6 +1728,15 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
 
         outputBuffer   += bytesAtThisLevel;
         availableBytes -= bytesAtThisLevel;
+
+        // the client has these colors now, until they change
+        if (trackSentState) {
+            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+                if (oneAtBit(childrenColoredBits, i)) {
+                    params.sentState->colorSent(node->getChildAtIndex(i));
+                }
+            }
+        }
     } else {
         bag.insert(node);
 
@@ -1454,6 +1745,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
             params.stats->didntFit(node);
         }
 
+        params.subtreeIsComplete = false;
         return 0;
     }
 
@@ -1491,8 +1783,12 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                 // remember this for reshuffling
                 recursiveSliceStarts[originalIndex] = outputBuffer;
 
+                params.subtreeIsComplete = true;
+                params.subtreeLODMargin = FLT_MAX;
                 int childTreeBytesOut = encodeTreeBitstreamRecursion(childNode, outputBuffer, availableBytes, bag,
                                                                      params, thisLevel);
+                subtreeIsComplete = subtreeIsComplete && params.subtreeIsComplete;
+                subtreeLODMargin = std::min(subtreeLODMargin, params.subtreeLODMargin);
 
                 // remember this for reshuffling
                 recursiveSliceSizes[originalIndex] = childTreeBytesOut;
@@ -1573,6 +1869,13 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
 
     } // end keepDiggingDeeper
 
+    if (trackSentState && subtreeIsComplete) {
+        params.sentState->subtreeSent(node, params.viewFrustum->getPosition(), params.boundaryScale(),
+                                      subtreeLODMargin);
+    }
+    params.subtreeIsComplete = subtreeIsComplete;
+    params.subtreeLODMargin = subtreeLODMargin;
+
     return bytesAtThisLevel;
 }
 
@@ -1792,15 +2095,20 @@ void VoxelTree::writeToSVOFile(const char* fileName, VoxelNode* node) {
     file.close();
 }
 
-unsigned long VoxelTree::getVoxelCount() {
-    unsigned long nodeCount = 0;
-    recurseTreeWithOperation(countVoxelsOperation, &nodeCount);
-    return nodeCount;
-}
+class CountVoxelsOperation : public VoxelTreeOperation {
+public:
+    CountVoxelsOperation() : nodeCount(0) { }
+    Result visit(VoxelNode* node) {
+        nodeCount++;
+        return VISIT_CHILDREN;
+    }
+    unsigned long nodeCount;
+};
 
-bool VoxelTree::countVoxelsOperation(VoxelNode* node, void* extraData) {
-    (*(unsigned long*)extraData)++;
-    return true; // keep going
+unsigned long VoxelTree::getVoxelCount() {
+    CountVoxelsOperation operation;
+    traverseTree(operation);
+    return operation.nodeCount;
 }
 
 void VoxelTree::copySubTreeIntoNewTree(VoxelNode* startNode, VoxelTree* destinationTree, bool rebaseToRoot) {
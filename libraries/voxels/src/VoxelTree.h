@@ -9,6 +9,8 @@
 #ifndef __hifi__VoxelTree__
 #define __hifi__VoxelTree__
 
+#include <cfloat>
+#include <cmath>
 #include <set>
 #include <SimpleMovingAverage.h>
 
@@ -18,6 +20,8 @@
 #include "VoxelNode.h"
 #include "VoxelNodeBag.h"
 #include "VoxelSceneStats.h"
+#include "VoxelSentState.h"
+#include "VoxelTreeTraversal.h"
 #include "VoxelEditPacketSender.h"
 
 #include <QObject>
@@ -40,10 +44,21 @@ const int NO_BOUNDARY_ADJUST     = 0;
 const int LOW_RES_MOVING_ADJUST  = 1;
 const uint64_t IGNORE_LAST_SENT  = 0;
 
+const int PARALLEL_REAVERAGE_LEVELS = 3; // levels above the subtrees reaveraged in parallel, up to 512 subtrees
+
 #define IGNORE_SCENE_STATS       NULL
 #define IGNORE_VIEW_FRUSTUM      NULL
 #define IGNORE_COVERAGE_MAP      NULL
 #define IGNORE_JURISDICTION_MAP  NULL
+#define IGNORE_SENT_STATE        NULL
+#define IGNORE_DEEPER_LEVEL_BAG  NULL
+
+/// A set of one voxel, for readCodeColorBuffersToTree()
+class VoxelEdit {
+public:
+    const unsigned char* codeColorBuffer;
+    bool destructive;
+};
 
 class EncodeBitstreamParams {
 public:
@@ -57,11 +72,23 @@ public:
     const ViewFrustum*  lastViewFrustum;
     bool                wantOcclusionCulling;
     int                 boundaryLevelAdjust;
+    float               lodScale;
     uint64_t            lastViewFrustumSent;
     bool                forceSendScene;
     VoxelSceneStats*    stats;
     CoverageMap*        map;
     JurisdictionMap*    jurisdictionMap;
+    VoxelSentState*     sentState;
+    
+    // when sending coarse to fine, nodes deeper than passLevel aren't encoded, they wait in deeperLevelBag for the
+    // next pass, the most important on screen first
+    VoxelNodeBag*       deeperLevelBag;
+    int                 passLevel;
+    
+    // whether everything the client needs of the subtree just encoded has been written, and how far the camera can
+    // move before it needs more, used to update sentState
+    bool                subtreeIsComplete;
+    float               subtreeLODMargin;
     
     EncodeBitstreamParams(
         int                 maxEncodeLevel      = INT_MAX, 
@@ -77,7 +104,11 @@ public:
         uint64_t            lastViewFrustumSent = IGNORE_LAST_SENT,
         bool                forceSendScene      = true,
         VoxelSceneStats*    stats               = IGNORE_SCENE_STATS,
-        JurisdictionMap*    jurisdictionMap     = IGNORE_JURISDICTION_MAP) :
+        JurisdictionMap*    jurisdictionMap     = IGNORE_JURISDICTION_MAP,
+        VoxelSentState*     sentState           = IGNORE_SENT_STATE,
+        float               lodScale            = DEFAULT_LOD_SCALE,
+        VoxelNodeBag*       deeperLevelBag      = IGNORE_DEEPER_LEVEL_BAG,
+        int                 passLevel           = INT_MAX) :
             maxEncodeLevel          (maxEncodeLevel),
             maxLevelReached         (0),
             viewFrustum             (viewFrustum),
@@ -88,12 +119,21 @@ public:
             lastViewFrustum         (lastViewFrustum),
             wantOcclusionCulling    (wantOcclusionCulling),
             boundaryLevelAdjust     (boundaryLevelAdjust),
+            lodScale                (lodScale),
             lastViewFrustumSent     (lastViewFrustumSent),
             forceSendScene          (forceSendScene),
             stats                   (stats),
             map                     (map),
-            jurisdictionMap         (jurisdictionMap)
+            jurisdictionMap         (jurisdictionMap),
+            sentState               (sentState),
+            deeperLevelBag          (deeperLevelBag),
+            passLevel               (passLevel),
+            subtreeIsComplete       (true),
+            subtreeLODMargin        (FLT_MAX)
     {}
+
+    /// the scale of the render level boundaries once the level adjust is applied, larger for finer detail
+    float boundaryScale() const { return ldexpf(lodScale, -boundaryLevelAdjust); }
 };
 
 class ReadBitstreamToTreeParams {
@@ -142,10 +182,19 @@ public:
     void processRemoveVoxelBitstream(unsigned char* bitstream, int bufferSizeBytes);
     void readBitstreamToTree(unsigned char* bitstream,  unsigned long int bufferSizeBytes, ReadBitstreamToTreeParams& args);
     void readCodeColorBufferToTree(unsigned char* codeColorBuffer, bool destructive = false);
+
+    /// Sets many voxels in one walk of the tree, so the nodes above them are only told their subtree changed once. The
+    /// edits' codes must all be the same length, different, and sorted with compareOctalCodes().
+    void readCodeColorBuffersToTree(const VoxelEdit* edits, int editCount);
     void deleteVoxelCodeFromTree(unsigned char* codeBuffer, bool collapseEmptyTrees = DONT_COLLAPSE);
     void printTreeForDebugging(VoxelNode* startNode);
     void reaverageVoxelColors(VoxelNode* startNode);
 
+    /// Same results as reaverageVoxelColors(), with the subtrees below the top PARALLEL_REAVERAGE_LEVELS levels
+    /// reaveraged on threadCount threads, one per core if it's 0. Falls back to reaverageVoxelColors() while there are
+    /// update hooks, which expect to be called from one thread.
+    void reaverageVoxelColorsInParallel(VoxelNode* startNode, int threadCount = 0);
+
     void deleteVoxelAt(float x, float y, float z, float s);
     VoxelNode* getVoxelAt(float x, float y, float z, float s) const;
     void createVoxel(float x, float y, float z, float s, 
@@ -159,6 +208,17 @@ public:
     void recurseTreeWithOperationDistanceSorted(RecurseVoxelTreeOperation operation, 
                                                 const glm::vec3& point, void* extraData=NULL);
 
+    /// Visits the tree with a VoxelTreeOperation, without recursing and with the operation inlined, returns false if
+    /// the operation stopped the traversal
+    template <typename Operation>
+    bool traverseTree(Operation& operation) { return traverseVoxelNode(rootNode, operation); }
+
+    /// like traverseTree(), visiting the nearer children to the point first
+    template <typename Operation>
+    bool traverseTreeDistanceSorted(Operation& operation, const glm::vec3& point) {
+        return traverseVoxelNode(rootNode, operation, &point);
+    }
+
     int encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer, int availableBytes, VoxelNodeBag& bag, 
                             EncodeBitstreamParams& params) ;
 
@@ -190,6 +250,17 @@ public:
     
     bool getShouldReaverage() const { return _shouldReaverage; }
 
+    /// In a lazy reaveraging tree edits only mark the nodes above them as needing their colors averaged again, and
+    /// reaverageDirtyPaths() averages each of those once, for any number of edits. Whatever reads the colors calls it
+    /// first.
+    void setLazyReaverage(bool lazyReaverage);
+    bool getLazyReaverage() const { return _lazyReaverage; }
+    void reaverageNeeded() { _hasPendingReaverage = true; }
+    bool hasPendingReaverage() const { return _hasPendingReaverage; }
+
+    /// averages the colors of the nodes edits marked as needing it, children before their parents
+    void reaverageDirtyPaths();
+
     void recurseNodeWithOperation(VoxelNode* node, RecurseVoxelTreeOperation operation, 
                 void* extraData, int recursionCount = 0);
             
@@ -209,11 +280,18 @@ public slots:
 private:
     void deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraData);
     void readCodeColorBufferToTreeRecursion(VoxelNode* node, void* extraData);
+    bool readCodeColorBuffersToTreeRecursion(VoxelNode* node, const VoxelEdit* edits, int editCount, int lengthOfCode);
+    bool setNodeFromCodeColorBuffer(VoxelNode* node, const unsigned char* codeColorBuffer, int lengthOfCode,
+                                    bool destructive);
 
     int encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outputBuffer, int availableBytes, VoxelNodeBag& bag, 
                                      EncodeBitstreamParams& params, int& currentEncodeLevel) const;
 
-    static bool countVoxelsOperation(VoxelNode* node, void* extraData);
+
+    void reaverageVoxelColorsRecursion(VoxelNode* node, int levelsToReaverage, pthread_mutex_t* collapseLock,
+                                       int recursionCount = 0);
+    void reaverageDirtyPathsRecursion(VoxelNode* node);
+    static void* reaverageVoxelColorsThread(void* extraData);
 
     VoxelNode* nodeForOctalCode(VoxelNode* ancestorNode, const unsigned char* needleCode, VoxelNode** parentOfFoundNode) const;
     VoxelNode* createMissingNode(VoxelNode* lastParentNode, unsigned char* deepestCodeToCreate);
@@ -223,6 +301,8 @@ private:
     unsigned long int _nodesChangedFromBitstream;
     bool _shouldReaverage;
     bool _stopImport;
+    bool _lazyReaverage;
+    bool _hasPendingReaverage;
 
     /// Octal Codes of any subtrees currently being encoded. While any of these codes is being encoded, ancestors and 
     /// descendants of them can not be deleted.
@@ -265,7 +345,16 @@ private:
     void chunkifyLeaf(VoxelNode* node);
 };
 
-float boundaryDistanceForRenderLevel(unsigned int renderLevel);
+/// the distance within which voxels of the render level are drawn, lodScale stretches it for more detail or shrinks
+/// it for less
+float boundaryDistanceForRenderLevel(unsigned int renderLevel, float lodScale = DEFAULT_LOD_SCALE);
 float boundaryDistanceSquaredForRenderLevel(unsigned int renderLevel);
 
+/// The lodScale at which voxels at their render boundaries project to the same number of pixels on a screen
+/// screenHeight pixels high with a vertical fieldOfView in degrees as the boundary table gives on the reference screen,
+/// REFERENCE_LOD_SCREEN_HEIGHT pixels high with a REFERENCE_LOD_FIELD_OF_VIEW, so that a screen with twice the pixels
+/// or half the view is sent voxels twice as far. A screenHeight of zero, a client that didn't say, gets the table, as
+/// does a fieldOfView outside of (0, 180) degrees.
+float lodScaleForScreen(float fieldOfView, int screenHeight);
+
 #endif /* defined(__hifi__VoxelTree__) */
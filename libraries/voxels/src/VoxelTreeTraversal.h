@@ -0,0 +1,139 @@
+//
+//  VoxelTreeTraversal.h
+//  hifi
+//
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Walks of a voxel tree with an explicit stack, calling an operation class that the compiler can inline
+//
+
+#ifndef __hifi__VoxelTreeTraversal__
+#define __hifi__VoxelTreeTraversal__
+
+#include <QDebug>
+
+#include "VoxelConstants.h"
+#include "VoxelNode.h"
+
+/// Base for the operations passed to traverseVoxelNode() and VoxelTree::traverseTree(). An operation defines
+///
+///     VoxelTreeOperation::Result visit(VoxelNode* node);
+///
+/// which is called for each node before its children. Operations that set WANTS_POST_ORDER also have their
+/// postVisit() called for each node after its children, unless the traversal was stopped first.
+class VoxelTreeOperation {
+public:
+    enum Result {
+        VISIT_CHILDREN, /// go on to the node's children
+        SKIP_CHILDREN,  /// go on to the node's next sibling
+        STOP_TRAVERSAL  /// end the traversal
+    };
+
+    enum { WANTS_POST_ORDER = false };
+    void postVisit(VoxelNode* node) { }
+};
+
+/// Adapts a RecurseVoxelTreeOperation function to a VoxelTreeOperation
+class VoxelFunctionOperation : public VoxelTreeOperation {
+public:
+    VoxelFunctionOperation(bool (*function)(VoxelNode* node, void* extraData), void* extraData) :
+        _function(function),
+        _extraData(extraData) { }
+
+    Result visit(VoxelNode* node) { return _function(node, _extraData) ? VISIT_CHILDREN : SKIP_CHILDREN; }
+
+private:
+    bool (*_function)(VoxelNode* node, void* extraData);
+    void* _extraData;
+};
+
+/// A node on the traversal stack, with the children it still has to visit
+class VoxelTraversalFrame {
+public:
+    /// collects the node's children in the order they're visited, nearest to the point first if there is one
+    void setNode(VoxelNode* node, const glm::vec3* sortPoint);
+
+    VoxelNode* node;
+    VoxelNode* children[NUMBER_OF_CHILDREN];
+    int childCount;
+    int nextChild;
+};
+
+inline void VoxelTraversalFrame::setNode(VoxelNode* node, const glm::vec3* sortPoint) {
+    this->node = node;
+    childCount = 0;
+    nextChild = 0;
+
+    float distances[NUMBER_OF_CHILDREN];
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        VoxelNode* child = node->getChildAtIndex(i);
+        if (!child) {
+            continue;
+        }
+        // the children are visited next, start loading them while the rest are found
+#ifdef __GNUC__
+        __builtin_prefetch(child);
+#endif
+        if (!sortPoint) {
+            children[childCount++] = child;
+            continue;
+        }
+
+        // insertion sort, there are at most eight of them
+        float distance = child->distanceSquareToPoint(*sortPoint);
+        int slot = childCount++;
+        while (slot > 0 && distances[slot - 1] > distance) {
+            children[slot] = children[slot - 1];
+            distances[slot] = distances[slot - 1];
+            slot--;
+        }
+        children[slot] = child;
+        distances[slot] = distance;
+    }
+}
+
+/// Visits the node and its descendants depth first, children in index order, or nearest to the sort point first when
+/// one is given. Returns false if the operation stopped the traversal. Like recurseNodeWithOperation() it doesn't go
+/// deeper than DANGEROUSLY_DEEP_RECURSION levels below the node. The operation may remove or add children of the node
+/// it's visiting, but not of other nodes.
+template <typename Operation>
+bool traverseVoxelNode(VoxelNode* node, Operation& operation, const glm::vec3* sortPoint = NULL) {
+    VoxelTraversalFrame stack[DANGEROUSLY_DEEP_RECURSION];
+    int depth = -1;
+
+    VoxelNode* nextNode = node;
+    while (true) {
+        if (nextNode) {
+            VoxelTreeOperation::Result result = operation.visit(nextNode);
+            if (result == VoxelTreeOperation::STOP_TRAVERSAL) {
+                return false;
+            }
+            if (result == VoxelTreeOperation::VISIT_CHILDREN && depth + 1 < DANGEROUSLY_DEEP_RECURSION) {
+                stack[++depth].setNode(nextNode, sortPoint);
+            } else {
+                if (result == VoxelTreeOperation::VISIT_CHILDREN) {
+                    qDebug() << "traverseVoxelNode() reached DANGEROUSLY_DEEP_RECURSION, not visiting children!\n";
+                }
+                if (Operation::WANTS_POST_ORDER) {
+                    operation.postVisit(nextNode);
+                }
+            }
+        }
+        if (depth < 0) {
+            return true;
+        }
+
+        VoxelTraversalFrame& frame = stack[depth];
+        if (frame.nextChild < frame.childCount) {
+            nextNode = frame.children[frame.nextChild++];
+        } else {
+            if (Operation::WANTS_POST_ORDER) {
+                operation.postVisit(frame.node);
+            }
+            depth--;
+            nextNode = NULL;
+        }
+    }
+}
+
+#endif /* defined(__hifi__VoxelTreeTraversal__) */
@@ -6,6 +6,10 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
+#include <QtCore/QThread>
+
 #include <VoxelTree.h>
 #include <SharedUtil.h>
 #include <SceneUtils.h>
@@ -138,6 +142,67 @@ void processSplitSVOFile(const char* splitSVOFile,const char* splitJurisdictionR
     printf("exiting now\n");
 }
 
+// Times setting and then erasing voxels of two sizes in an SVO, either scattered anywhere in it or in small patches
+// like brush strokes.
+void processEditBenchmark(const char* benchmarkSVOFile) {
+    printf("editBenchmark: %s\n", benchmarkSVOFile);
+
+    const int EDITS = 200000;
+    const int EDITS_PER_PATCH = 1000;
+    const int PATCH_VOXELS = 32;
+    const float USECS_PER_SECOND = 1000 * 1000;
+    unsigned char** edits = new unsigned char*[EDITS];
+
+    for (int local = 0; local < 2; local++) {
+        for (int voxelsPerSide = 512; voxelsPerSide <= 4096; voxelsPerSide *= 8) {
+            float voxelSize = 1.0f / voxelsPerSide;
+            int patchX = 0, patchY = 0, patchZ = 0;
+            for (int i = 0; i < EDITS; i++) {
+                int x, y, z;
+                if (local) {
+                    if (i % EDITS_PER_PATCH == 0) {
+                        patchX = randIntInRange(0, voxelsPerSide - PATCH_VOXELS);
+                        patchY = randIntInRange(0, voxelsPerSide - PATCH_VOXELS);
+                        patchZ = randIntInRange(0, voxelsPerSide - PATCH_VOXELS);
+                    }
+                    x = patchX + randIntInRange(0, PATCH_VOXELS - 1);
+                    y = patchY + randIntInRange(0, PATCH_VOXELS - 1);
+                    z = patchZ + randIntInRange(0, PATCH_VOXELS - 1);
+                } else {
+                    x = randIntInRange(0, voxelsPerSide - 1);
+                    y = randIntInRange(0, voxelsPerSide - 1);
+                    z = randIntInRange(0, voxelsPerSide - 1);
+                }
+                edits[i] = pointToVoxel(x * voxelSize, y * voxelSize, z * voxelSize, voxelSize,
+                                        randomColorValue(0), randomColorValue(0), randomColorValue(0));
+            }
+
+            VoxelTree benchmarkSVO;
+            benchmarkSVO.readFromSVOFile(benchmarkSVOFile);
+            uint64_t start = usecTimestampNow();
+            for (int i = 0; i < EDITS; i++) {
+                benchmarkSVO.readCodeColorBufferToTree(edits[i]);
+            }
+            uint64_t setUsecs = usecTimestampNow() - start;
+            start = usecTimestampNow();
+            for (int i = 0; i < EDITS; i++) {
+                benchmarkSVO.deleteVoxelCodeFromTree(edits[i]);
+            }
+            uint64_t eraseUsecs = usecTimestampNow() - start;
+
+            printf("%s edits, voxel size 1/%d: sets %llu usecs, %.0f/sec, erases %llu usecs, %.0f/sec\n",
+                   local ? "local" : "scattered", voxelsPerSide,
+                   (long long unsigned int)setUsecs, EDITS * USECS_PER_SECOND / (setUsecs ? setUsecs : 1),
+                   (long long unsigned int)eraseUsecs, EDITS * USECS_PER_SECOND / (eraseUsecs ? eraseUsecs : 1));
+
+            for (int i = 0; i < EDITS; i++) {
+                delete[] edits[i];
+            }
+        }
+    }
+    delete[] edits;
+}
+
 class copyAndFillArgs {
 public:
     VoxelTree* destinationTree;
@@ -203,7 +268,7 @@ void processFillSVOFile(const char* fillSVOFile) {
 
     originalSVO.readFromSVOFile(fillSVOFile);
     qDebug("Nodes after loading %lu nodes\n", originalSVO.getVoxelCount());
-    originalSVO.reaverageVoxelColors(originalSVO.rootNode);
+    originalSVO.reaverageVoxelColorsInParallel(originalSVO.rootNode);
     qDebug("Original Voxels reAveraged\n");
     qDebug("Nodes after reaveraging %lu nodes\n", originalSVO.getVoxelCount());
     
@@ -222,7 +287,7 @@ void processFillSVOFile(const char* fillSVOFile) {
     qDebug("Nodes created during filling %lu nodes\n", args.outCount);
     qDebug("Nodes after filling %lu nodes\n", filledSVO.getVoxelCount());
 
-    filledSVO.reaverageVoxelColors(filledSVO.rootNode);
+    filledSVO.reaverageVoxelColorsInParallel(filledSVO.rootNode);
     qDebug("Nodes after reaveraging %lu nodes\n", filledSVO.getVoxelCount());
 
     sprintf(outputFileName, "filled%s", fillSVOFile);
@@ -232,6 +297,100 @@ void processFillSVOFile(const char* fillSVOFile) {
     printf("exiting now\n");
 }
 
+// true if the two subtrees have the same nodes with the same colors and densities
+bool subtreesMatch(VoxelNode* nodeA, VoxelNode* nodeB) {
+    if (nodeA->isColored() != nodeB->isColored() || nodeA->getDensity() != nodeB->getDensity()
+        || memcmp(nodeA->getTrueColor(), nodeB->getTrueColor(), sizeof(rgbColor)) != 0) {
+        return false;
+    }
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        VoxelNode* childA = nodeA->getChildAtIndex(i);
+        VoxelNode* childB = nodeB->getChildAtIndex(i);
+        if ((childA == NULL) != (childB == NULL) || (childA && !subtreesMatch(childA, childB))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Times reaveraging an SVO in one pass and then on each number of threads up to the number of cores, and checks that
+// every threaded pass gives the same tree as the single pass.
+void processReaverageBenchmark(const char* benchmarkSVOFile) {
+    printf("reaverageBenchmark: %s\n", benchmarkSVOFile);
+
+    VoxelTree serialSVO(true); // reaveraging
+    serialSVO.readFromSVOFile(benchmarkSVOFile);
+    uint64_t start = usecTimestampNow();
+    serialSVO.reaverageVoxelColors(serialSVO.rootNode);
+    uint64_t serialUsecs = usecTimestampNow() - start;
+    printf("single pass: %llu usecs, %lu nodes\n", (long long unsigned int)serialUsecs, serialSVO.getVoxelCount());
+
+    int coreCount = QThread::idealThreadCount();
+    for (int threadCount = 1; threadCount <= coreCount; threadCount++) {
+        VoxelTree parallelSVO(true); // reaveraging
+        parallelSVO.readFromSVOFile(benchmarkSVOFile);
+        start = usecTimestampNow();
+        parallelSVO.reaverageVoxelColorsInParallel(parallelSVO.rootNode, threadCount);
+        uint64_t parallelUsecs = usecTimestampNow() - start;
+
+        printf("%d of %d cores: %llu usecs, speedup %.2f, %s\n", threadCount, coreCount,
+               (long long unsigned int)parallelUsecs,
+               (float)serialUsecs / std::max(parallelUsecs, (uint64_t)1),
+               subtreesMatch(serialSVO.rootNode, parallelSVO.rootNode) ? "same tree" : "DIFFERENT TREE");
+    }
+}
+
+class CountColoredVoxelsOperation : public VoxelTreeOperation {
+public:
+    CountColoredVoxelsOperation() : nodeCount(0) { }
+    Result visit(VoxelNode* node) {
+        if (node->isColored()) {
+            nodeCount++;
+        }
+        return VISIT_CHILDREN;
+    }
+    int nodeCount;
+};
+
+// Times full walks of an SVO with the recursive function pointer operations and with the traversal operations, in
+// index order and in distance order.
+void processTraversalBenchmark(const char* benchmarkSVOFile) {
+    printf("traversalBenchmark: %s\n", benchmarkSVOFile);
+
+    VoxelTree benchmarkSVO;
+    benchmarkSVO.readFromSVOFile(benchmarkSVOFile);
+    const int WALKS = 10;
+    const glm::vec3 SORT_POINT(0.5f, 0.5f, 0.5f);
+
+    for (int sorted = 0; sorted < 2; sorted++) {
+        _nodeCount = 0;
+        uint64_t start = usecTimestampNow();
+        for (int i = 0; i < WALKS; i++) {
+            if (sorted) {
+                benchmarkSVO.recurseTreeWithOperationDistanceSorted(countVoxelsOperation, SORT_POINT);
+            } else {
+                benchmarkSVO.recurseTreeWithOperation(countVoxelsOperation);
+            }
+        }
+        uint64_t recurseUsecs = usecTimestampNow() - start;
+
+        CountColoredVoxelsOperation operation;
+        start = usecTimestampNow();
+        for (int i = 0; i < WALKS; i++) {
+            if (sorted) {
+                benchmarkSVO.traverseTreeDistanceSorted(operation, SORT_POINT);
+            } else {
+                benchmarkSVO.traverseTree(operation);
+            }
+        }
+        uint64_t traverseUsecs = usecTimestampNow() - start;
+
+        printf("%s: recurse %llu usecs, traverse %llu usecs, speedup %.2f, %s\n", sorted ? "distance sorted" : "unsorted",
+               (long long unsigned int)(recurseUsecs / WALKS), (long long unsigned int)(traverseUsecs / WALKS),
+               (float)recurseUsecs / std::max(traverseUsecs, (uint64_t)1),
+               _nodeCount == operation.nodeCount ? "same count" : "DIFFERENT COUNT");
+    }
+}
 
 int old_main(int argc, const char * argv[])
 {
@@ -259,6 +418,30 @@ int old_main(int argc, const char * argv[])
         return 0;
     }
     
+    // Handles timing sets and erases of voxels in an SVO
+    const char* EDIT_BENCHMARK = "--editBenchmark";
+    const char* editBenchmarkFile = getCmdOption(argc, argv, EDIT_BENCHMARK);
+    if (editBenchmarkFile) {
+        processEditBenchmark(editBenchmarkFile);
+        return 0;
+    }
+    
+    // Handles timing single pass and threaded reaveraging of an SVO
+    const char* REAVERAGE_BENCHMARK = "--reaverageBenchmark";
+    const char* reaverageBenchmarkFile = getCmdOption(argc, argv, REAVERAGE_BENCHMARK);
+    if (reaverageBenchmarkFile) {
+        processReaverageBenchmark(reaverageBenchmarkFile);
+        return 0;
+    }
+
+    // Handles timing the recursive and the traversal walks of an SVO
+    const char* TRAVERSAL_BENCHMARK = "--traversalBenchmark";
+    const char* traversalBenchmarkFile = getCmdOption(argc, argv, TRAVERSAL_BENCHMARK);
+    if (traversalBenchmarkFile) {
+        processTraversalBenchmark(traversalBenchmarkFile);
+        return 0;
+    }
+
     const char* DONT_CREATE_FILE = "--dontCreateSceneFile";
     bool dontCreateFile = cmdOptionExists(argc, argv, DONT_CREATE_FILE);
 